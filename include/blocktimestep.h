@@ -0,0 +1,43 @@
+// blocktimestep.h
+// Hierarchical power-of-two block timesteps: every body gets its own step dt / 2^level.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace SolarSim {
+
+class BodySystem;
+
+// Finest level allowed, 2^12 sub-steps per outer step (0.15 s at the default 600 s)
+constexpr int kMaxStepLevel = 12;
+constexpr int kStepLevels = kMaxStepLevel + 1;
+
+// What the block integrator did during the last outer step, shown on the HUD
+struct TimestepStats {
+    size_t bodiesAtLevel[kStepLevels] = {}; // level each body ended the step on
+    size_t substeps = 0;                    // distinct sync points visited
+    size_t forceEvaluations = 0;            // single-body force evaluations, summed over substeps
+};
+
+// Kick-drift-kick leapfrog where each body only gets kicked (and only has its force
+// recomputed) at the end of its own step. Every body drifts to each sync point so the
+// active ones see up-to-date positions; drifting is O(N) while forces are O(N * active).
+//
+// Levels come from the acceleration / jerk criterion dt_i = eta * |a| / |da/dt|, with the
+// jerk estimated from the last two force evaluations. A body may always move to a finer
+// level, but only to a coarser one when the current time is aligned to that coarser step,
+// so all bodies line up again at the end of every outer step.
+class BlockTimestepper {
+public:
+    // Advances every body by dtMax (the coarsest step) and fills timestepStats
+    void step(BodySystem& bodies, double dtMax);
+
+private:
+    std::vector<uint32_t> active;
+    std::vector<double> previousAx;
+    std::vector<double> previousAy;
+};
+
+} // namespace SolarSim
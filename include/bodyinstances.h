@@ -0,0 +1,135 @@
+// bodyinstances.h
+// Turns a snapshot into what the body renderer draws: view culling, a tessellation level
+// per body from its size on screen, and sub-pixel bodies merged into one point per pixel.
+// No GL in here.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace SolarSim {
+
+struct RenderSnapshot;
+class SnapshotInterpolator;
+class ThreadPool;
+
+// Per-body data streamed to the GPU every frame (32 bytes).
+// Positions are split into a high and low float so the camera subtraction
+// in the vertex shader keeps close to double precision.
+struct BodyInstance {
+    float posHigh[2];
+    float posLow[2];
+    float radius;
+    float color[3];
+};
+
+// value ~= high + low, with low holding what didn't fit in high's 24 bits
+inline void splitDouble(double value, float& high, float& low) {
+    high = static_cast<float>(value);
+    low = static_cast<float>(value - static_cast<double>(high));
+}
+
+// Circle tessellations, coarsest first. A body gets the coarsest one whose rim strays
+// less than ~0.15 px from the true circle (sagitta r * (1 - cos(pi / segments))).
+inline constexpr int kBodyLodLevels = 6;
+inline constexpr int kBodyLodSegments[kBodyLodLevels] = {8, 16, 32, 64, 128, 360};
+// Largest on-screen radius, in pixels, each level is used up to (the last one has no limit)
+inline constexpr double kBodyLodMaxRadius[kBodyLodLevels - 1] = {2.0, 8.0, 32.0, 128.0, 512.0};
+
+// Bodies whose on-screen radius is below this many pixels are drawn as points
+inline constexpr double kPointRadiusPixels = 0.5;
+
+// World to screen mapping, the same one the body vertex shader uses:
+// ndc = (world - cam) * scale on both axes, then the framebuffer's pixels
+struct BodyView {
+    double camX = 0.0;
+    double camY = 0.0;
+    double scale = 1.0;
+    int width = 1;  // framebuffer pixels
+    int height = 1;
+};
+
+// One pixel's worth of sub-pixel bodies, in framebuffer pixels from the top-left corner
+struct PointSprite {
+    float x;
+    float y;
+    float color[4]; // average color of the bodies in the pixel, alpha grows with their count
+};
+
+struct BodyDrawStats {
+    size_t bodies = 0;
+    size_t culled = 0;    // entirely outside the view
+    size_t instanced = 0; // drawn as circles
+    size_t splatted = 0;  // drawn as part of a point
+    size_t points = 0;    // distinct pixels those landed on
+};
+
+// Built in passes that each split across `pool`: slices of the bodies are culled and
+// classified, their sub-pixel bodies binned by screen tile, then each tile summed into its
+// pixels. A tile's pixels stay in cache while it's summed, where scattering a million bodies
+// straight into the framebuffer-sized grid missed on nearly every one. The result is the
+// same for any number of threads.
+class BodyDrawList {
+public:
+    // Rebuilds the list for the snapshot blended `blend` of the way from the previous one
+    void build(const RenderSnapshot& snapshot, const SnapshotInterpolator& interpolator, double blend,
+               const BodyView& view, ThreadPool& pool);
+
+    // Visible circles grouped by level: level l is instances[lodBegin[l], lodBegin[l + 1])
+    std::vector<BodyInstance> instances;
+    size_t lodBegin[kBodyLodLevels + 1] = {};
+
+    std::vector<PointSprite> points;
+    BodyDrawStats stats;
+
+private:
+    struct Visible {
+        double x;
+        double y;
+        uint32_t body;
+        uint8_t lod;
+    };
+
+    // A sub-pixel body on its way to its pixel
+    struct Splat {
+        uint32_t pixel;
+        float r;
+        float g;
+        float b;
+    };
+
+    // Running sums of the sub-pixel bodies landing on one pixel
+    struct PixelSum {
+        float r;
+        float g;
+        float b;
+        uint32_t count;
+    };
+
+    // What one slice of the bodies turned into
+    struct Slice {
+        std::vector<Visible> visible;
+        std::vector<Splat> splats; // the first splatCount are this build's, the rest is capacity
+        size_t splatCount;
+        std::vector<uint32_t> tileCount; // splats per tile, then where the next one of them goes
+        size_t lodCount[kBodyLodLevels];
+        size_t lodCursor[kBodyLodLevels]; // where this slice's circles of each level start
+        size_t culled;
+    };
+
+    // Scratch kept between frames
+    std::vector<Slice> slices;
+    std::vector<Splat> binned;        // every slice's splats, grouped by tile
+    std::vector<size_t> tileBegin;    // tile t's splats are binned[tileBegin[t], tileBegin[t + 1])
+    std::vector<uint32_t> touched;    // per tile, from tileBegin[t]: the pixels it hit, first hit first
+    std::vector<PointSprite> tilePoints; // per tile, from tileBegin[t]: their points
+    std::vector<size_t> pointBegin;   // tile t's points start at points[pointBegin[t]]
+    std::vector<PixelSum> pixels;     // framebuffer-sized, all zero between builds
+    int gridWidth = 0;
+    int gridHeight = 0;
+    int tilesX = 0;
+    int tilesY = 0;
+};
+
+} // namespace SolarSim
@@ -0,0 +1,23 @@
+// bodyrenderer.h
+// Instanced body rendering: shared circle meshes at a few tessellations, one instanced draw per
+// tessellation in use, plus one point draw for everything smaller than a pixel.
+#pragma once
+
+#include "bodyinstances.h"
+
+namespace SolarSim {
+
+struct RenderSnapshot;
+class SnapshotInterpolator;
+
+// Builds the shared circle meshes and the instance / point buffers (needs a current GL context)
+void initBodyRenderer();
+void shutdownBodyRenderer();
+
+// Draws the bodies of the snapshot that are in view, positions blended `blend` of the way
+// from the previous snapshot to this one. The camera / screenScale transform of the
+// circles happens in the vertex shader. Returns what was drawn how, for the HUD.
+const BodyDrawStats& renderBodies(const RenderSnapshot& snapshot, const SnapshotInterpolator& interpolator,
+                                  double blend);
+
+} // namespace SolarSim
@@ -0,0 +1,143 @@
+// bodysystem.h
+// Structure-of-arrays storage for every simulated body.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "nametable.h"
+
+namespace SolarSim {
+
+class Mass;
+
+// Everything about a body that the physics never reads
+struct BodyInfo {
+    InternedName name;
+
+    float r = 1.0f;
+    float g = 1.0f;
+    float b = 1.0f;
+};
+
+// Stable name for a body. Indices into a BodySystem shift whenever a body is removed;
+// a handle keeps pointing at the same body until that body is gone, and after that it
+// never resolves again, even once its slot is reused (the generation moves on).
+struct BodyHandle {
+    static constexpr uint32_t kNoSlot = 0xFFFFFFFFu;
+
+    uint32_t slot = kNoSlot;
+    uint32_t generation = 0;
+
+    bool isNull() const { return slot == kNoSlot; }
+    bool operator==(const BodyHandle& other) const { return slot == other.slot && generation == other.generation; }
+    bool operator!=(const BodyHandle& other) const { return !(*this == other); }
+};
+
+// One body inside a BodySystem. The members alias the columns, so code written
+// against the old Mass objects (m.x, m.vx, m.mass...) reads the same.
+struct MassRef {
+    double& x;
+    double& y;
+    double& vx;
+    double& vy;
+    double& ax;
+    double& ay;
+    float& mass;
+    float& radius;
+    BodyInfo& info;
+};
+
+class BodySystem {
+public:
+    // Hot physics state, one entry per body. Loops that only need positions
+    // and masses walk these directly instead of dragging whole bodies through the cache.
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> vx;
+    std::vector<double> vy;
+    std::vector<double> ax;
+    std::vector<double> ay;
+    std::vector<float> mass;
+    std::vector<float> radius;
+
+    // Block timestep level per body (step = dt / 2^level), kUnsetStepLevel until
+    // the block integrator has looked at the body
+    std::vector<uint8_t> stepLevel;
+    static constexpr uint8_t kUnsetStepLevel = 0xFF;
+
+    // Cold data (names, colors), same indexing as the columns
+    std::vector<BodyInfo> info;
+
+    // Handle slot each body owns, same indexing as the columns
+    std::vector<uint32_t> slotOf;
+
+    size_t size() const { return x.size(); }
+    bool empty() const { return x.empty(); }
+
+    // Appends a copy of m and returns its index
+    size_t add(const Mass& m);
+
+    BodyHandle handle(size_t i) const { return BodyHandle{slotOf[i], slots[slotOf[i]].generation}; }
+
+    // Current index of the body behind h; false once it has been removed (or h is null)
+    bool find(BodyHandle h, size_t& index) const;
+
+    // Bumped whenever bodies are added, removed or reordered, so anything holding
+    // per-index data from earlier (last frame's positions, say) knows it no longer lines up
+    uint64_t layoutVersion() const { return layout; }
+
+    // Copies body i back out into a standalone Mass
+    Mass get(size_t i) const;
+
+    MassRef operator[](size_t i);
+
+    // Drops every body whose mass went to zero (merged away). Each one is replaced by
+    // the current last body, so removal costs one body's worth of copying and the order
+    // of the rest is not kept; handles follow the bodies that moved.
+    void removeDead();
+
+    void reserve(size_t n);
+    void clear();
+
+    // Grows or shrinks every column to n bodies; new ones are all zeros (white, unnamed)
+    // and get filled in column by column, e.g. by the scene loader
+    void resize(size_t n);
+
+    // Semi-implicit Euler, split the same way as Mass::calcVelocity / Mass::calcNewPos.
+    // The ranged versions only touch bodies [begin, end) so they can be split across threads.
+    void calcVelocities(double dt) { calcVelocities(dt, 0, size()); }
+    void calcNewPositions(double dt) { calcNewPositions(dt, 0, size()); }
+    void calcVelocities(double dt, size_t begin, size_t end);
+    void calcNewPositions(double dt, size_t begin, size_t end);
+
+private:
+    struct Slot {
+        uint32_t index = 0;      // where the body lives in the columns while the slot is in use
+        uint32_t generation = 0; // bumped on release, retiring every handle to the old body
+    };
+
+    uint32_t acquireSlot(uint32_t index);
+    void releaseSlot(uint32_t slot);
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+    uint64_t layout = 0;
+};
+
+// Indexable view over a BodySystem for code that still thinks in terms of a list of masses
+class MassView {
+public:
+    explicit MassView(BodySystem& system) : system(&system) {}
+
+    size_t size() const { return system->size(); }
+    bool empty() const { return system->empty(); }
+    MassRef operator[](size_t i) const { return (*system)[i]; }
+
+private:
+    BodySystem* system;
+};
+
+} // namespace SolarSim
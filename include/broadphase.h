@@ -0,0 +1,66 @@
+// broadphase.h
+// Sweep-and-prune broad phase producing candidate pairs for the exact collision test.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace SolarSim {
+
+class BodySystem;
+
+// Collision work done in the last step, shown on the HUD
+struct CollisionStats {
+    size_t bodies = 0;
+    size_t candidatePairs = 0; // pairs handed to checkCollision
+    size_t collisions = 0;     // pairs that actually touched
+    size_t swept = 0;          // of those, how many met part-way through the step (time of impact)
+    size_t islands = 0;        // groups of touching bodies resolved independently (see contactislands.h)
+    size_t largestIsland = 0;  // contacts in the biggest one
+};
+
+using BodyPair = std::pair<uint32_t, uint32_t>;
+
+// Where the collision step gets its candidate pairs. Both give exactly the same pairs in
+// the same order, so switching never changes a result, only how long finding them takes.
+enum class BroadPhase {
+    SweepAndPrune, // sort along x and sweep (the default)
+    AabbTree,      // overlap queries against the spatial index (see spatialindex.h)
+};
+
+const char* broadPhaseName(BroadPhase phase);
+
+// Accepts "sweep" and "tree". Returns false for anything else.
+bool broadPhaseFromName(const char* name, BroadPhase& phase);
+
+// Sorts bodies by the left edge of their bounding box along x and sweeps once,
+// pairing every body with the ones whose box starts before its own ends.
+// Works on each body's own radius, so a Sun-sized body next to thousands of
+// Moon-sized ones just produces a few extra candidates instead of breaking a grid.
+class SweepAndPrune {
+public:
+    // Fills `pairs` with every (i, j), i < j, whose bounding boxes overlap, sorted by i then j
+    // (the same order the old all-pairs loop visited them in).
+    void findCandidates(const BodySystem& bodies, std::vector<BodyPair>& pairs);
+
+    // Same, but each box covers the body's whole path over the last step, from
+    // (startX[i], startY[i]) to where it is now, so pairs that passed through each
+    // other between steps are still candidates
+    void findCandidates(const BodySystem& bodies, const double* startX, const double* startY,
+                        std::vector<BodyPair>& pairs);
+
+private:
+    // Body order from last frame. Bodies barely move between steps,
+    // so an insertion sort over it is close to linear.
+    std::vector<uint32_t> order;
+    std::vector<double> minX;
+    std::vector<double> maxX;
+    std::vector<double> minY;
+    std::vector<double> maxY;
+
+    void sortOrder(size_t n);
+};
+
+} // namespace SolarSim
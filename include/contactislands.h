@@ -0,0 +1,55 @@
+// contactislands.h
+// Groups the pairs that touched during a step into islands: sets of bodies linked by a
+// chain of contacts. No body is in two islands, so islands can be resolved in parallel.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "broadphase.h"
+
+namespace SolarSim {
+
+class BodySystem;
+
+// A candidate pair that touched. t is the fraction of the step at which they met
+// (sweptCollisionTime), or negative when they were already overlapping at the start
+// and only get the end-of-step test.
+struct Contact {
+    double t;
+    uint32_t i;
+    uint32_t j;
+};
+
+class ContactIslands {
+public:
+    // Runs the narrow phase on every candidate pair (split across the thread pool) and
+    // groups the ones that touch. Within an island the overlapping pairs come first, then
+    // the ones with a time of impact, each part in the candidates' own i < j order.
+    // The grouping depends only on the pairs, never on the thread count.
+    void build(const BodySystem& bodies, const double* startX, const double* startY,
+               const std::vector<BodyPair>& candidates);
+
+    size_t islandCount() const { return islandBegin.size() - 1; }
+
+    // Island k is contacts[islandBegin[k], islandBegin[k + 1])
+    std::vector<Contact> contacts;
+    std::vector<uint32_t> islandBegin = {0};
+
+    size_t sweptContacts = 0; // contacts with a time of impact, over every island
+    size_t largestIsland = 0; // most contacts in one island
+
+private:
+    uint32_t findRoot(uint32_t body);
+
+    // Scratch kept between steps
+    std::vector<double> pairTime;   // per candidate: time of impact, -1 overlapping, or no contact
+    std::vector<Contact> touching;  // contacts in candidate order
+    std::vector<uint32_t> parent;   // union-find over bodies, only valid for bodies in a contact
+    std::vector<uint32_t> islandOf; // per root body, its island
+    std::vector<uint32_t> keyOf;    // per touching contact, its island * 2 + 1 if it has a time of impact
+    std::vector<uint32_t> keyStart; // counting sort offsets per key
+};
+
+} // namespace SolarSim
@@ -0,0 +1,35 @@
+// fft.h
+// Small in-place radix-2 complex FFT, enough for the particle-mesh gravity solver.
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace SolarSim {
+
+using Complex = std::complex<double>;
+
+class FFT {
+public:
+    // Precomputes twiddles and the bit-reversal permutation for power-of-two length n
+    void resize(size_t n);
+    size_t size() const { return length; }
+
+    // Unnormalised in both directions: inverse(forward(x)) == size() * x
+    void forward(Complex* data) const { transform(data, false); }
+    void inverse(Complex* data) const { transform(data, true); }
+
+private:
+    void transform(Complex* data, bool inverse) const;
+
+    size_t length = 0;
+    std::vector<Complex> twiddles;    // e^(-2 pi i k / length) for k < length / 2
+    std::vector<uint32_t> bitReverse; // where each index goes before the butterflies
+};
+
+// Transposes an n x n row-major matrix in place, tile by tile (split across the thread pool)
+void transposeSquare(Complex* data, size_t n);
+
+} // namespace SolarSim
@@ -1,7 +1,9 @@
 // globals.h
-// Shared state for the SolarSim application.
+// Shared state for the interactive SolarSim application (window, camera, input, HUD).
+// Physics state lives in simglobals.h.
 #pragma once
 
+#include <cstdint>
 #include <random>
 #include <string>
 #include <vector>
@@ -9,12 +11,12 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
-namespace SolarSim {
+#include "physicsthread.h"
+#include "simglobals.h"
 
-class Mass;
+namespace SolarSim {
 
-// Simulation configuration
-extern double timeStepMult;
+// Camera configuration
 extern double zoomFactor;
 extern double camX;
 extern double camY;
@@ -24,6 +26,9 @@ extern double screenScale;
 extern bool isLeftMouseButtonDown;
 extern bool isRightMouseButtonDown;
 extern bool isMiddleMouseButtonDown;
+extern bool isSolverKeyDown;
+extern bool isSaveKeyDown;
+extern bool isTraceKeyDown;
 extern int massType;
 extern double startxpos;
 extern double startypos;
@@ -31,20 +36,26 @@ extern double lastMouseX;
 extern double lastMouseY;
 extern bool isCameraFollowMass;
 extern bool clickedExistingMass;
-extern int selectedMassIndex;
+extern double requestedSimSpeed; // last speed sent to the physics thread (Shift+scroll)
 
 // GLFW / OpenGL objects
 extern GLFWwindow* window;
 extern unsigned int shaderProgram;
 extern unsigned int textShaderProgram;
-extern unsigned int textVAO;
-extern unsigned int textVBO;
 extern GLint textScreenUniform;
 extern GLint textColorUniform;
+extern unsigned int bodyVAO;
+extern unsigned int bodyMeshVBO;
+extern unsigned int bodyInstanceVBO;
+extern GLint bodyCamHighUniform;
+extern GLint bodyCamLowUniform;
+extern GLint bodyScaleUniform;
+extern unsigned int pointShaderProgram;
+extern GLint pointScreenUniform;
+extern unsigned int pointVAO;
+extern unsigned int pointVBO;
 
 // Text rendering state
-extern int textVertexCount;
-extern std::vector<float> textVertices;
 extern bool showTextOverlay;
 extern std::string overlayText;
 extern float overlayScale;
@@ -52,14 +63,25 @@ extern float overlayMargin;
 extern float timeOverlayScale;
 extern float timeOverlayMargin;
 extern std::string timeOverlayText;
-extern std::vector<unsigned char> textScratchBuffer;
-inline constexpr size_t kEasyFontBytesPerChar = 288;
 
-// Simulation collections
-extern std::vector<Mass> massesVector;
+// Simulation runs here; the render loop only reads its snapshots
+extern PhysicsThread physicsThread;
+
+// The latest snapshot's bodies, refreshed as each one arrives, for clicks and the HUD
+extern SpatialIndex pickIndex;
+
+// The render thread's own workers for building the body draw list; threadPool belongs to
+// the physics thread. A quarter of the hardware threads by default (--render-threads N).
+extern ThreadPool renderPool;
+
+// Where F6 writes the profiler's Chrome trace (--trace FILE)
+extern std::string tracePath;
+
+// Names handed out to user-spawned masses
 extern std::vector<std::string> celestialBodies;
 
 // Utilities
+extern uint32_t randomSeed; // what randomGenerator was seeded with
 extern std::mt19937 randomGenerator;
 
 } // namespace SolarSim
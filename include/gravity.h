@@ -0,0 +1,91 @@
+// gravity.h
+// Gravitational force solvers: exact direct summation, a Barnes-Hut quadtree and a
+// particle mesh.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace SolarSim {
+
+class BodySystem;
+
+enum class ForceSolver {
+    Direct,     // exact O(N²) pairwise sum
+    BarnesHut,  // O(N log N) quadtree approximation
+    ParticleMesh, // O(N + G² log G) FFT on a G x G grid, see particlemesh.h
+};
+
+// One square cell of the quadtree. Leaves hold a (usually single) list of bodies,
+// internal nodes hold the total mass and centre of mass of everything below them.
+struct QuadNode {
+    double cx = 0.0;
+    double cy = 0.0;
+    double halfSize = 0.0;
+
+    double mass = 0.0;
+    double comX = 0.0;
+    double comY = 0.0;
+
+    int children[4] = {-1, -1, -1, -1};
+    int firstBody = -1; // head of the body list for leaves, -1 otherwise
+    int depth = 0;
+
+    bool isLeaf() const {
+        return children[0] < 0 && children[1] < 0 && children[2] < 0 && children[3] < 0;
+    }
+};
+
+class QuadTree {
+public:
+    // Rebuilds the tree from scratch around the current positions.
+    // Node storage is kept between calls so rebuilding every frame doesn't hit the allocator.
+    void build(const BodySystem& bodies);
+
+    // Acceleration on body `self` (at px, py) from every other body in the tree.
+    // A cell is only approximated by its centre of mass when size / distance < theta
+    // and the point isn't inside the cell.
+    void accelerationAt(const BodySystem& bodies, int self, double px, double py,
+                        double theta, double& outAx, double& outAy) const;
+
+    std::vector<QuadNode> nodes;
+    std::vector<int> nextBody; // linked list of bodies sharing a leaf
+
+private:
+    void insert(const BodySystem& bodies, int body);
+    int childFor(int node, double x, double y);
+};
+
+// Fills the ax/ay columns with the exact sum of the pull of every other mass,
+// using the widest SIMD kernel allowed by the simdLevel global.
+void computeAccelerationsDirect(BodySystem& bodies);
+
+// Fills the ax/ay columns using a Barnes-Hut quadtree.
+// theta = 0 opens every cell and reproduces the direct sum up to summation order
+// (relative difference below 1e-12); 0.5 is the usual speed/accuracy tradeoff.
+void computeAccelerationsBarnesHut(BodySystem& bodies, double theta);
+
+// Fills the ax/ay columns from a gridSize x gridSize particle mesh (a power of two).
+// Long-range pulls come out within a fraction of a percent. Without shortRange, bodies
+// closer than a few cells pull on each other more weakly than they should; with it
+// (P³M) those pairs are summed directly.
+void computeAccelerationsParticleMesh(BodySystem& bodies, size_t gridSize, bool shortRange);
+
+// Uses whichever solver is selected by the forceSolver global.
+void computeAccelerations(BodySystem& bodies);
+
+// Same, but only refreshes ax/ay for the bodies listed in `targets`
+// (every body still pulls on them). Used by the block timestep integrator.
+void computeAccelerations(BodySystem& bodies, const std::vector<uint32_t>& targets);
+
+const char* forceSolverName(ForceSolver solver);
+
+// Accepts "direct", "barnes-hut" and "particle-mesh". Returns false for anything else.
+bool forceSolverFromName(const char* name, ForceSolver& solver);
+
+// Kinetic plus gravitational potential energy of the whole system, summed exactly
+// over every pair. O(N²), meant for checking integrators rather than every frame.
+double totalEnergy(const BodySystem& bodies);
+
+} // namespace SolarSim
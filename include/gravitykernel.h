@@ -0,0 +1,30 @@
+// gravitykernel.h
+// Vectorised direct-sum acceleration kernel with runtime instruction set selection.
+#pragma once
+
+#include <cstddef>
+
+namespace SolarSim {
+
+enum class SimdLevel {
+    Scalar,
+    SSE2,   // 2 sources per instruction
+    AVX2,   // 4 sources per instruction
+    AVX512, // 8 sources per instruction
+};
+
+// Best level the running CPU supports (checked once, then cached)
+SimdLevel detectSimdLevel();
+const char* simdLevelName(SimdLevel level);
+
+// Sums the pull of all n sources on every target in [begin, end) and writes it to ax/ay.
+// A target never pulls on itself (zero separation contributes nothing).
+//
+// The vector paths use rsqrt plus two Newton steps instead of sqrt and divides,
+// which keeps every per-pair term within ~1e-13 relative of the scalar formula in
+// Mass::calcAcceleration. Separations must stay inside float range (1e-19 m .. 1e19 m)
+// because the initial rsqrt estimate is taken in single precision.
+void accumulateAccelerations(const double* x, const double* y, const float* mass, size_t n,
+                             size_t begin, size_t end, double* ax, double* ay, SimdLevel level);
+
+} // namespace SolarSim
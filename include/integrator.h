@@ -0,0 +1,33 @@
+// integrator.h
+// Time integration schemes for advancing positions and velocities by one step.
+#pragma once
+
+namespace SolarSim {
+
+class BodySystem;
+
+// Every scheme is a sequence of drifts (x += v * c dt) and kicks (v += a * d dt),
+// with a force evaluation before each kick. The leapfrog and Yoshida schemes are
+// symplectic, so orbital energy errors stay bounded instead of drifting.
+enum class Integrator {
+    SemiImplicitEuler, // kick, drift. 1st order, 1 force eval per step (the original scheme)
+    Leapfrog,          // drift/2, kick, drift/2. Velocity Verlet, 2nd order, 1 force eval
+    Yoshida4,          // three leapfrogs with Yoshida's weights. 4th order, 3 force evals
+    BlockLeapfrog,     // kick-drift-kick leapfrog with a power-of-two step per body (blocktimestep.h).
+                       // Quiet bodies take the full dt, close encounters sub-step on their own
+};
+
+// Advances positions and velocities by dt with the given scheme, evaluating forces
+// (and leaving the last evaluation in ax/ay) with whichever solver forceSolver selects.
+void integrate(BodySystem& bodies, double dt, Integrator scheme);
+
+// Force evaluations per step, the main thing a scheme costs.
+// For BlockLeapfrog this is the minimum; see timestepStats for what a step really took.
+int integratorForceEvals(Integrator scheme);
+
+const char* integratorName(Integrator scheme);
+
+// Accepts "euler", "leapfrog" / "verlet", "yoshida4" and "block". Returns false for anything else.
+bool integratorFromName(const char* name, Integrator& scheme);
+
+} // namespace SolarSim
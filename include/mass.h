@@ -1,13 +1,15 @@
 // mass.h
-// Definition of the Mass class encapsulating renderable celestial bodies.
+// Definition of the Mass class describing a single celestial body, plus the
+// collision routines that operate on a BodySystem. No GL in here: drawing lives in bodyrenderer.h.
 #pragma once
 
+#include <cstddef>
 #include <string>
 
-#include <glad/glad.h>
-
 namespace SolarSim {
 
+class BodySystem;
+
 class Mass {
 public:
     // BTW this is almost never used, but it could be fun if I could
@@ -27,22 +29,27 @@ public:
     float g = 1.0f;
     float b = 1.0f;
 
-    unsigned int VAO = 0;
-    unsigned int VBO = 0;
-
-    // Number of segments approximating the planet disc (360 sided polygon).
-    int numOfVertices = 360;
-
-    void init();
-    void updateVertices();
-    void draw(unsigned int shaderProgram);
     void calcAcceleration(double otherMass, double otherX, double otherY);
     void calcVelocity();
     void calcNewPos();
 };
 
-bool checkCollision(const Mass& m1, const Mass& m2);
-void resolveCollision(Mass& m1, Mass& m2);
-void mergeMasses(Mass& m1, Mass& m2);
+// Collision tests between bodies i and j of a BodySystem
+bool checkCollision(const BodySystem& bodies, size_t i, size_t j);
+void resolveCollision(BodySystem& bodies, size_t i, size_t j);
+void mergeMasses(BodySystem& bodies, size_t i, size_t j);
+
+// Swept versions for pairs that met part-way through the last step of length dt.
+// Each body is taken to have moved in a straight line from (startX, startY) to where
+// it is now. sweptCollisionTime returns the fraction of the step at which the two
+// circles first touch, or -1 if they never do or already overlapped at the start
+// (those are left to checkCollision).
+double sweptCollisionTime(const BodySystem& bodies, const double* startX, const double* startY, size_t i, size_t j);
+
+// Rewind the pair to time t, bounce or merge there, then carry on to the end of the step
+void resolveCollisionAt(BodySystem& bodies, const double* startX, const double* startY, size_t i, size_t j,
+                        double t, double dt);
+void mergeMassesAt(BodySystem& bodies, const double* startX, const double* startY, size_t i, size_t j,
+                   double t, double dt);
 
 } // namespace SolarSim
@@ -0,0 +1,43 @@
+// nametable.h
+// Process-wide string interning for body names.
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace SolarSim {
+
+// A body name stored once in the name table; copying one copies a pointer.
+// Thousands of catalogue bodies called "Asteroid" all share one string,
+// and a BodyInfo stays small enough to pack tightly.
+class InternedName {
+public:
+    InternedName() = default;
+    InternedName(std::string_view text) { *this = text; }
+    InternedName& operator=(std::string_view text);
+
+    const std::string& str() const;
+    operator const std::string&() const { return str(); }
+
+    bool empty() const { return str().empty(); }
+    size_t size() const { return str().size(); }
+    const char* data() const { return str().data(); }
+
+    // Interned strings are unique, so equal text means equal pointers
+    bool operator==(const InternedName& other) const { return text == other.text; }
+    bool operator!=(const InternedName& other) const { return text != other.text; }
+
+private:
+    friend InternedName internName(std::string_view text);
+
+    const std::string* text = nullptr; // nullptr is the empty name
+};
+
+// Safe to call from any thread. Strings are never freed, so handles stay valid forever.
+InternedName internName(std::string_view text);
+
+// Distinct names interned so far
+size_t internedNameCount();
+
+} // namespace SolarSim
@@ -0,0 +1,84 @@
+// particlemesh.h
+// Particle-mesh gravity: bodies are spread onto a square grid, the grid is convolved
+// with the point-mass pull by FFT and every body reads its acceleration back off the grid.
+// O(N + G² log G) for a G x G grid, so it beats the tree code on large, roughly uniform
+// clouds. On its own the mesh softens the pull between bodies closer than a few cells;
+// with the short-range part switched on (P³M) the mesh only carries the smooth,
+// long-range share of every pull and pairs within kMeshCutoffCells are summed directly.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "fft.h"
+
+namespace SolarSim {
+
+class BodySystem;
+
+// Grid sizes accepted by ParticleMesh (powers of two)
+inline constexpr size_t kMinMeshGrid = 16;
+inline constexpr size_t kMaxMeshGrid = 2048;
+
+// Force split for the short-range correction, in mesh cells: the mesh carries
+// erf-smoothed pulls with scale kMeshSplitCells, direct sums cover the rest out to the cutoff
+inline constexpr double kMeshSplitCells = 1.25;
+inline constexpr double kMeshCutoffCells = 4.5 * kMeshSplitCells;
+
+class ParticleMesh {
+public:
+    // Fills ax / ay for every body from a gridSize x gridSize mesh fitted around them,
+    // plus the direct short-range part when shortRange is set
+    void computeAccelerations(BodySystem& bodies, size_t gridSize, bool shortRange);
+
+    // Same, but only refreshes the bodies listed in `targets` (all of them still
+    // contribute to the mesh)
+    void computeAccelerations(BodySystem& bodies, const std::vector<uint32_t>& targets, size_t gridSize,
+                              bool shortRange);
+
+    // Edge of one cell in metres, from the last solve
+    double cellSize() const { return cell; }
+
+private:
+    // Cloud-in-cell deposit, then ax + i ay = (mass grid) * (pull of a unit mass),
+    // a convolution over a grid zero-padded to twice the size so nothing wraps around
+    void solve(const BodySystem& bodies, size_t gridSize, bool shortRange);
+
+    // Spectrum of the complex kernel (-dx - i dy) / r³, in cells, on the padded grid,
+    // times the long-range share when shortRange is set
+    void prepareKernel(size_t gridSize, bool shortRange);
+
+    // Buckets the bodies into square cells one cutoff wide for the short-range sums
+    void buildNeighbourCells(const BodySystem& bodies);
+
+    // Cloud-in-cell read back of the solved field for body i, plus its short-range pulls
+    void accelerationAt(const BodySystem& bodies, size_t i, double& outAx, double& outAy) const;
+
+    size_t grid = 0;   // mesh edge in cells
+    size_t padded = 0; // 2 * grid, the FFT length
+    double originX = 0.0;
+    double originY = 0.0;
+    double cell = 1.0;
+    double fieldScale = 0.0; // G / cell² and the inverse FFT's 1 / padded²
+    bool kernelShortRange = false;
+    bool withShortRange = false;
+
+    FFT fft;
+    std::vector<Complex> kernel; // transposed spectrum, like `field` between the passes
+    std::vector<Complex> field;  // padded x padded: mass, then its spectrum, then the accelerations
+
+    // Short-range share of a pull against squared distance in cells, out to the cutoff
+    std::vector<double> shortRangeShare;
+
+    // Neighbour cells, bodies sorted by cell (index order within one)
+    double neighbourCell = 1.0;
+    size_t neighbourWidth = 0;
+    size_t neighbourHeight = 0;
+    std::vector<uint32_t> cellOfBody;
+    std::vector<uint32_t> cellStart; // bodies of cell c are cellBodies[cellStart[c], cellStart[c + 1])
+    std::vector<uint32_t> cellBodies;
+    std::vector<uint32_t> cellCursor; // scratch for the sort
+};
+
+} // namespace SolarSim
@@ -0,0 +1,168 @@
+// physicsthread.h
+// Runs the simulation on its own thread and hands immutable snapshots to the renderer.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "blocktimestep.h"
+#include "bodysystem.h"
+#include "broadphase.h"
+#include "gravity.h"
+#include "integrator.h"
+#include "mass.h"
+#include "stepscheduler.h"
+#include "trajectory.h"
+#include "triplebuffer.h"
+
+namespace SolarSim {
+
+// Everything the render thread needs for one frame, copied out after a complete step
+struct RenderSnapshot {
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<float> radius;
+    std::vector<float> r;
+    std::vector<float> g;
+    std::vector<float> b;
+    std::vector<uint32_t> slot; // each body's handle slot, so a SpatialIndex can follow it
+
+    long long frame = 0;
+    double simSeconds = 0.0;
+    CollisionStats collisions;
+    ForceSolver forceSolver = ForceSolver::Direct;
+    Integrator integrator = Integrator::SemiImplicitEuler;
+    TimestepStats timesteps;
+    ScheduleStats schedule;
+    bool recordingTrajectory = false;
+    TrajectoryStats trajectory;
+
+    // Bumped by BodySystem whenever the bodies were added, removed or reordered
+    uint64_t layoutVersion = 0;
+
+    // Selected body, picked on the physics thread. selectionSerial changes
+    // every time a new pick lands so the HUD knows to refresh. selectedIndex is
+    // where the selected body sits in this snapshot, -1 once it is gone.
+    BodyHandle selected;
+    int selectedIndex = -1;
+    uint64_t selectionSerial = 0;
+    std::string selectedName;
+    float selectedMass = 0.0f;
+    float selectedRadius = 0.0f;
+
+    std::chrono::steady_clock::time_point publishTime;
+
+    size_t size() const { return x.size(); }
+};
+
+// Something the UI wants done to the simulation
+struct SimCommand {
+    enum class Type {
+        SpawnMass,      // add `mass`
+        SelectAt,       // select whatever body covers world point (x, y)
+        SetForceSolver, // switch to `solver`
+        SaveCheckpoint, // write a snapshot through the checkpointer right away
+        SetSimSpeed,    // aim for `speed` sim-seconds per wall-second
+    };
+
+    Type type = Type::SpawnMass;
+    Mass mass;
+    double x = 0.0;
+    double y = 0.0;
+    ForceSolver solver = ForceSolver::Direct;
+    double speed = 0.0;
+};
+
+// Carries out one command against `bodies`, exactly as the physics thread does between
+// steps (session replays go through here too). SelectAt points `selected` at the body
+// under the point; returns true if it hit one.
+bool applyCommand(BodySystem& bodies, const SimCommand& command, BodyHandle& selected);
+
+// Multi-producer command inbox, drained once per physics tick. Commands are rare
+// (a few per second at most) so a short mutex-protected swap is plenty.
+class CommandQueue {
+public:
+    void push(const SimCommand& command);
+    void drain(std::vector<SimCommand>& out);
+
+private:
+    std::mutex lock;
+    std::vector<SimCommand> pending;
+};
+
+class PhysicsThread {
+public:
+    ~PhysicsThread();
+
+    // Starts advancing `bodies` in ticksPerSecond ticks per wall-clock second. Each tick
+    // runs as many steps of the scheduled size as simSpeed asks for and fit in
+    // stepBudget seconds, then publishes one snapshot.
+    void start(BodySystem& bodies, double ticksPerSecond, double stepBudget);
+    void stop();
+
+    void post(const SimCommand& command) { commands.push(command); }
+
+    // Render side: picks up the newest snapshot if there is one, returns true if it changed
+    bool update() { return snapshots.update(); }
+    const RenderSnapshot& latest() const { return snapshots.readBuffer(); }
+
+    // Wall time between snapshots
+    double tickInterval() const { return 1.0 / ticksPerSecond; }
+
+private:
+    void run();
+    void applyCommands();
+    void publish();
+
+    BodySystem* bodies = nullptr;
+    double ticksPerSecond = 60.0;
+    StepScheduler scheduler;
+
+    std::thread thread;
+    std::atomic<bool> running{false};
+
+    CommandQueue commands;
+    std::vector<SimCommand> drained;
+    TripleBuffer<RenderSnapshot> snapshots;
+
+    // Selection lives with the bodies it points into. A handle rather than an index,
+    // so it stays on the same body when others are removed and clears when it merges away.
+    BodyHandle selected;
+    uint64_t selectionSerial = 0;
+};
+
+// Render-side helper that remembers the positions from the snapshot before the
+// latest one, so frames drawn between physics ticks can blend the two.
+class SnapshotInterpolator {
+public:
+    // Call after PhysicsThread::update(); `changed` is what update() returned
+    void advance(const RenderSnapshot& latest, bool changed);
+
+    // 0 = previous snapshot, 1 = latest, for the current wall time
+    double blend(const RenderSnapshot& latest, double tickInterval) const;
+
+    // Body i's position blended between the previous and latest snapshot.
+    // Falls back to the latest position when bodies were added, removed or reordered in between.
+    void position(const RenderSnapshot& latest, size_t i, double blend, double& x, double& y) const;
+
+    // Same for bodies [begin, end), written to x[0 .. end - begin) and y
+    void positions(const RenderSnapshot& latest, size_t begin, size_t end, double blend, double* x, double* y) const;
+
+private:
+    // Positions of the last two snapshots seen (the latest one is kept because the
+    // triple buffer recycles its storage as soon as a newer snapshot is picked up)
+    std::vector<double> previousX;
+    std::vector<double> previousY;
+    std::vector<double> currentX;
+    std::vector<double> currentY;
+    uint64_t previousLayout = 0;
+    uint64_t currentLayout = 0;
+};
+
+} // namespace SolarSim
@@ -0,0 +1,123 @@
+// profiler.h
+// Scoped per-phase timers with rolling min/avg/p99 and Chrome trace export.
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace SolarSim {
+
+// Everything the main loop and the physics step are split into. Phases nest freely
+// (Gravity runs inside Integrate inside Step), each one is timed on its own.
+enum class ProfilePhase {
+    Step,       // physics thread: one whole stepSimulation
+    Integrate,  // drifts and kicks, including the force evaluations they trigger
+    Gravity,    // one force evaluation (computeAccelerations)
+    Collisions, // broad phase plus checkCollision / resolveCollision
+    RemoveDead, // erasing merged-away bodies
+    Index,      // bringing a spatial index up to date with a step or a new snapshot
+    Publish,    // copying the render snapshot out
+    Output,     // staging checkpoints and trajectory frames
+    Frame,      // render thread: one whole pass of the main loop
+    Bodies,     // culling, packing, uploading and drawing the bodies
+    Text,       // HUD text meshes and their draws
+    Swap,       // glfwSwapBuffers
+    Count,
+};
+
+constexpr size_t kProfilePhaseCount = static_cast<size_t>(ProfilePhase::Count);
+
+const char* profilePhaseName(ProfilePhase phase);
+
+// Over the last Profiler::kHistory samples of one phase
+struct ProfileStats {
+    size_t samples = 0;
+    double minMs = 0.0;
+    double avgMs = 0.0;
+    double p99Ms = 0.0;
+};
+
+// Collects phase timings from any thread. Recording is one short lock per finished
+// scope (a few dozen per frame), so it never shows up next to what it measures.
+class Profiler {
+public:
+    // Samples per phase the HUD statistics are taken over (a few seconds at 60 Hz)
+    static constexpr size_t kHistory = 240;
+    // Trace events kept for export, oldest overwritten first
+    static constexpr size_t kTraceEvents = 1 << 16;
+
+    using Clock = std::chrono::steady_clock;
+
+    Profiler();
+
+    void record(ProfilePhase phase, Clock::time_point start, Clock::time_point end);
+
+    // Label for the calling thread in exported traces
+    void nameThread(const std::string& name);
+
+    ProfileStats stats(ProfilePhase phase) const;
+
+    // Writes the retained events as Chrome trace_event JSON (chrome://tracing, Perfetto).
+    // Returns the number of events written. Throws std::runtime_error if the file can't be written.
+    size_t writeChromeTrace(const std::string& path) const;
+
+    void clear();
+
+private:
+    struct History {
+        float ms[kHistory] = {};
+        size_t next = 0;
+        size_t count = 0;
+    };
+
+    struct TraceEvent {
+        int64_t startNs;
+        int64_t durationNs;
+        uint16_t thread;
+        ProfilePhase phase;
+    };
+
+    // Small id for the calling thread, registering it on first use (lock held)
+    uint16_t threadIndex();
+
+    mutable std::mutex lock;
+    Clock::time_point origin;
+    History history[kProfilePhaseCount];
+    std::vector<TraceEvent> trace; // ring buffer once it reaches kTraceEvents
+    size_t traceNext = 0;
+    std::vector<std::string> threadNames;
+};
+
+// Times the enclosing scope into the global profiler (simglobals.h)
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfilePhase phase) : phase(phase), start(Profiler::Clock::now()) {}
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    ProfilePhase phase;
+    Profiler::Clock::time_point start;
+};
+
+// Built with -DSOLARSIM_PROFILE (the makefile default, PROFILE=0 turns it off) the macro
+// drops a ProfileScope into the current scope. Without it the macro is empty, so a
+// profiled build and an unprofiled one differ by nothing but the timers.
+#ifdef SOLARSIM_PROFILE
+inline constexpr bool kProfilerEnabled = true;
+#define SOLARSIM_PROFILE_CONCAT_INNER(a, b) a##b
+#define SOLARSIM_PROFILE_CONCAT(a, b) SOLARSIM_PROFILE_CONCAT_INNER(a, b)
+#define SOLARSIM_PROFILE_SCOPE(phase) \
+    ::SolarSim::ProfileScope SOLARSIM_PROFILE_CONCAT(profileScope, __LINE__)(phase)
+#else
+inline constexpr bool kProfilerEnabled = false;
+#define SOLARSIM_PROFILE_SCOPE(phase) ((void)0)
+#endif
+
+} // namespace SolarSim
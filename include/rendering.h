@@ -7,6 +7,7 @@
 namespace SolarSim {
 
 void initTextRenderer();
+void shutdownTextRenderer();
 void updateOverlayText(const std::string& text);
 void clearOverlayText();
 void renderOverlayText();
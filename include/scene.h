@@ -0,0 +1,19 @@
+// scene.h
+// Initial conditions shared by the interactive app and the headless runner.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace SolarSim {
+
+class BodySystem;
+
+// The Earth-Moon system the app has always started with (the Sun is built but left out)
+void loadDefaultScene(BodySystem& bodies);
+
+// Scatters `count` moon-sized bodies on roughly circular orbits around the origin.
+// Deterministic for a given seed, handy for stress runs.
+void addRandomBodies(BodySystem& bodies, size_t count, uint32_t seed);
+
+} // namespace SolarSim
@@ -0,0 +1,45 @@
+// sceneloader.h
+// Bulk loading of initial conditions from CSV or JSON catalogues.
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace SolarSim {
+
+class BodySystem;
+
+// What a load did, for printing
+struct SceneLoadStats {
+    size_t bodies = 0;
+    size_t bytes = 0;
+    size_t chunks = 0;         // pieces the file was parsed in
+    size_t distinctNames = 0;  // interned names after the load (process-wide)
+    double seconds = 0.0;
+
+    double megabytesPerSecond() const { return seconds > 0.0 ? bytes / seconds / 1e6 : 0.0; }
+};
+
+// Appends every body in `path` to `bodies`. The format is picked from the first
+// non-blank character: '[' or '{' is JSON, anything else CSV.
+//
+// CSV: a header row naming the columns (any order, unknown ones ignored), then one body
+// per line. name, mass, radius, x and y are required; vx, vy default to 0 and r, g, b to 1.
+// Lines starting with # are comments. Names may be "quoted" ("" for a quote inside).
+// A row with fewer or more fields than the header is an error, and so is a mass or radius
+// that isn't positive or any number that isn't finite (nan, inf).
+//
+//     name,mass,radius,x,y,vx,vy,r,g,b
+//     Earth,5.972e24,6.371e6,0,0,0,0,0,0,1
+//
+// JSON: an array of flat objects with the same keys (color may also be given as
+// "color": [r, g, b]), either at the top level or under the "bodies" key of a top-level
+// object (its other keys are ignored).
+//
+// The file is mapped rather than read, split into chunks and parsed on the thread pool
+// straight into the body columns. Fields are parsed in place with std::from_chars and names
+// go through the name table, so nothing is allocated per field.
+// Throws std::runtime_error naming the file and line of the first problem.
+SceneLoadStats loadSceneFile(const std::string& path, BodySystem& bodies);
+
+} // namespace SolarSim
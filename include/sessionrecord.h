@@ -0,0 +1,89 @@
+// sessionrecord.h
+// Input recording: every command the UI sends the physics thread, stamped with the sim
+// frame it was applied on, plus the settings the session started with. Replaying one
+// (solarsim-batch --replay) runs the same steps with the same commands headless.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gravity.h"
+#include "integrator.h"
+#include "physicsthread.h"
+#include "simulation.h"
+
+namespace SolarSim {
+
+// Plain text, one record per line, so a recorded slowdown can be read and trimmed by hand:
+//
+//   solarsim-session 1
+//   seed 1234                      RNG seed the app's mass spawns drew from
+//   dt 600                         and the rest of the starting setup, one key per line
+//   speed 36000
+//   ...
+//   frame 120 spawn x y vx vy mass radius r g b name...
+//   frame 300 select x y
+//   frame 410 solver barnes-hut
+//   frame 500 checkpoint
+//   frame 640 speed 72000
+//   end 2048                       frame the session stopped on (missing if it crashed)
+//
+// Numbers are written with enough digits to read back bit for bit.
+struct SessionSettings {
+    uint32_t seed = 0;
+    double dt = 600.0;        // the largest step the scheduler takes
+    double speed = 36000.0;   // requested sim-seconds per wall-second at the start
+    double tickRate = 60.0;   // physics ticks per wall-second; with dt and speed, fixes the step size
+    Integrator integrator = Integrator::SemiImplicitEuler;
+    ForceSolver solver = ForceSolver::Direct;
+    CollisionMode collisions = CollisionMode::Bounce;
+    double theta = 0.5;
+    size_t meshGrid = 256;
+    bool meshShortRange = true;
+    std::string scenePath; // both empty for the default scene
+    std::string loadPath;
+    std::string pinName;   // empty for none
+};
+
+struct RecordedCommand {
+    long long frame = 0; // applied just before the step that starts on this frame
+    SimCommand command;
+};
+
+struct Session {
+    SessionSettings settings;
+    std::vector<RecordedCommand> commands; // in the order they were applied
+    long long endFrame = -1;               // -1 when the log has no end line
+};
+
+// Throws std::runtime_error when the file can't be read or a line doesn't parse
+Session loadSession(const std::string& path);
+
+// Written from the physics thread as commands are applied. start() before the physics
+// thread starts and stop() after it has been joined; nothing else needs a lock.
+class SessionRecorder {
+public:
+    ~SessionRecorder() { stop(-1); }
+
+    // Throws std::runtime_error if the file can't be created
+    void start(const std::string& path, const SessionSettings& settings);
+
+    // Writes the end line (unless endFrame is negative) and closes the file
+    void stop(long long endFrame);
+
+    bool enabled() const { return out.is_open(); }
+    size_t recorded() const { return count; }
+
+    // Every line is flushed straight away, so a session that ends in a crash or a
+    // killed process still replays up to its last command
+    void record(long long frame, const SimCommand& command);
+
+private:
+    std::ofstream out;
+    size_t count = 0;
+};
+
+} // namespace SolarSim
@@ -4,20 +4,32 @@
 
 namespace SolarSim::Shaders {
 
-// Please for all that is holy: DO NOT TOUCH THESE
+// Instanced bodies: aCorner is the shared unit circle, everything else is per body.
+// The camera offset is applied as (high - high) + (low - low) so positions far from
+// the origin keep their precision after the subtraction.
 inline constexpr char vertexShader[] = R"(#version 330 core
-layout (location = 0) in vec3 aPos;
+layout (location = 0) in vec2 aCorner;
+layout (location = 1) in vec2 aPosHigh;
+layout (location = 2) in vec2 aPosLow;
+layout (location = 3) in float aRadius;
+layout (location = 4) in vec3 aColor;
+uniform vec2 uCamHigh;
+uniform vec2 uCamLow;
+uniform float uScale;
+out vec3 vColor;
 void main()
 {
-   gl_Position = vec4(aPos.x, aPos.y, aPos.z, 1.0);
+    vec2 rel = (aPosHigh - uCamHigh) + (aPosLow - uCamLow);
+    gl_Position = vec4((rel + aCorner * aRadius) * uScale, 0.0, 1.0);
+    vColor = aColor;
 })";
 
 inline constexpr char fragmentShader[] = R"(#version 330 core
+in vec3 vColor;
 out vec4 FragColor;
-uniform vec3 uColor; // RGB color passed from CPU
 void main()
 {
-    FragColor = vec4(uColor, 1.0);
+    FragColor = vec4(vColor, 1.0);
 })";
 
 inline constexpr char textVertexShader[] = R"(#version 330 core
@@ -38,4 +50,27 @@ void main()
     FragColor = vec4(uTextColor, 1.0);
 })";
 
+// Sub-pixel bodies, already merged one point per pixel on the CPU (bodyinstances.h).
+// Positions are framebuffer pixels like the text; alpha carries how many bodies share the pixel.
+inline constexpr char pointVertexShader[] = R"(#version 330 core
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec4 aColor;
+uniform vec2 uScreenSize;
+out vec4 vColor;
+void main()
+{
+    vec2 ndc = ((aPos + 0.5) / uScreenSize) * 2.0 - 1.0;
+    ndc.y = -ndc.y;
+    gl_Position = vec4(ndc, 0.0, 1.0);
+    vColor = aColor;
+})";
+
+inline constexpr char pointFragmentShader[] = R"(#version 330 core
+in vec4 vColor;
+out vec4 FragColor;
+void main()
+{
+    FragColor = vColor;
+})";
+
 } // namespace SolarSim::Shaders
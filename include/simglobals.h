@@ -0,0 +1,64 @@
+// simglobals.h
+// Simulation state shared by the interactive app and the headless tools.
+// Nothing here may depend on GLFW or OpenGL.
+#pragma once
+
+#include "blocktimestep.h"
+#include "bodysystem.h"
+#include "broadphase.h"
+#include "gravity.h"
+#include "gravitykernel.h"
+#include "integrator.h"
+#include "profiler.h"
+#include "sessionrecord.h"
+#include "simulation.h"
+#include "snapshot.h"
+#include "spatialindex.h"
+#include "threadpool.h"
+#include "trajectory.h"
+
+namespace SolarSim {
+
+// Simulation configuration
+extern double timeStepMult;          // step size; the most the app's scheduler will step by
+extern double simSpeed;              // sim-seconds per wall-second the app's scheduler aims for
+extern ForceSolver forceSolver;
+extern Integrator integrator;
+extern double barnesHutTheta;
+extern size_t particleMeshGrid;       // cells along each side of the particle-mesh grid
+extern bool particleMeshShortRange;   // add the direct short-range pulls (P³M)
+extern SimdLevel simdLevel;
+extern CollisionMode collisionMode;
+extern BroadPhase broadPhase;
+extern BodyHandle pinnedBody; // held in place every step while it resolves, null for none
+
+// Simulation clock
+extern long long simFrame;   // steps taken so far
+extern double simSeconds;    // simulated seconds elapsed
+extern CollisionStats collisionStats; // broad phase work in the last step
+extern TimestepStats timestepStats;   // block timestep levels in the last step
+
+// Simulation collections
+extern BodySystem bodies;       // Owns every body, physics state stored column by column
+extern MassView massesVector;   // Index-style view over bodies
+
+// Every body's bounding box, refreshed at the end of each step for picks and range
+// queries between steps (and mid-step for the collision candidates with BroadPhase::AabbTree)
+extern SpatialIndex spatialIndex;
+
+// Shared by every parallel stage of the simulation step
+extern ThreadPool threadPool;
+
+// Background snapshot writer, idle until someone calls start() on it
+extern Checkpointer checkpointer;
+
+// Background trajectory recorder, likewise idle until started
+extern TrajectoryWriter trajectoryWriter;
+
+// Input recorder, idle unless the app was started with --record
+extern SessionRecorder sessionRecorder;
+
+// Phase timings from every thread (only filled in builds with SOLARSIM_PROFILE)
+extern Profiler profiler;
+
+} // namespace SolarSim
@@ -0,0 +1,41 @@
+// simulation.h
+// One physics step of the whole system, independent of any window or renderer.
+#pragma once
+
+#include <string_view>
+
+#include "gravity.h"
+#include "integrator.h"
+
+namespace SolarSim {
+
+class BodySystem;
+
+// What happens when two bodies touch
+enum class CollisionMode {
+    Bounce, // elastic collision (the default)
+    Merge,  // the pair becomes one body with their combined mass, momentum and volume
+};
+
+const char* collisionModeName(CollisionMode mode);
+
+// Accepts "bounce" and "merge". Returns false for anything else.
+bool collisionModeFromName(const char* name, CollisionMode& mode);
+
+// A step specialised for one integrator / force solver / collision mode / pinning
+// combination (Simulation<> in simulation.cpp), with no per-body or per-pair dispatch left.
+using StepFunction = void (*)(BodySystem& bodies, double dt);
+
+// Every supported combination is compiled in; this just picks the matching one
+StepFunction selectStep(Integrator scheme, ForceSolver solver, CollisionMode mode, bool pinned);
+
+// Advances every body by dt seconds: gravity, integration, collisions and
+// removal of merged-away bodies. Also ticks simFrame / simSeconds.
+// Runs the selectStep() specialisation for the current integrator, forceSolver,
+// collisionMode and pinnedBody globals.
+void stepSimulation(BodySystem& bodies, double dt);
+
+// Points pinnedBody at the first body called `name`. Returns false if there is none.
+bool pinBodyByName(const BodySystem& bodies, std::string_view name);
+
+} // namespace SolarSim
@@ -0,0 +1,188 @@
+// simulationpolicies.h
+// Compile-time building blocks of a simulation step: force solvers, integration schemes,
+// collision responses and body pinning. Simulation<> in simulation.cpp stitches one of each
+// together, so the hot loops are compiled for exactly that combination.
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#include "blocktimestep.h"
+#include "bodysystem.h"
+#include "gravity.h"
+#include "mass.h"
+#include "profiler.h"
+#include "simglobals.h"
+
+namespace SolarSim {
+
+// --- Force solvers: fill ax / ay for every body ---
+
+struct DirectForces {
+    static void compute(BodySystem& bodies) {
+        SOLARSIM_PROFILE_SCOPE(ProfilePhase::Gravity);
+        computeAccelerationsDirect(bodies);
+    }
+};
+
+struct BarnesHutForces {
+    static void compute(BodySystem& bodies) {
+        SOLARSIM_PROFILE_SCOPE(ProfilePhase::Gravity);
+        computeAccelerationsBarnesHut(bodies, barnesHutTheta);
+    }
+};
+
+struct ParticleMeshForces {
+    static void compute(BodySystem& bodies) {
+        SOLARSIM_PROFILE_SCOPE(ProfilePhase::Gravity);
+        computeAccelerationsParticleMesh(bodies, particleMeshGrid, particleMeshShortRange);
+    }
+};
+
+// Whatever the forceSolver global says at the time of the call
+struct SelectedForces {
+    static void compute(BodySystem& bodies) { computeAccelerations(bodies); }
+};
+
+// --- Pinning: a pinned body never moves (the Earth-Moon "pin Earth" setup) ---
+
+struct NoPin {
+    bool skips(size_t) const { return false; }
+    void hold(BodySystem&) const {}
+};
+
+// Skipped by every drift and kick, and put back where it started (at rest) at the end
+// of the step in case a collision or the block integrator moved it anyway
+struct PinnedBody {
+    size_t index = 0;
+    double x = 0.0;
+    double y = 0.0;
+
+    bool skips(size_t i) const { return i == index; }
+
+    void hold(BodySystem& bodies) const {
+        bodies.x[index] = x;
+        bodies.y[index] = y;
+        bodies.vx[index] = 0.0;
+        bodies.vy[index] = 0.0;
+    }
+};
+
+// --- Collision responses, applied to every touching pair ---
+// resolve() handles a pair found overlapping at the end of the step, resolveAt() one
+// that met `t` of the way through it (see sweptCollisionTime in mass.h)
+
+struct BounceCollisions {
+    static void resolve(BodySystem& bodies, size_t i, size_t j) { resolveCollision(bodies, i, j); }
+
+    static void resolveAt(BodySystem& bodies, const double* startX, const double* startY, size_t i, size_t j,
+                          double t, double dt) {
+        resolveCollisionAt(bodies, startX, startY, i, j, t, dt);
+    }
+};
+
+struct MergeCollisions {
+    static void resolve(BodySystem& bodies, size_t i, size_t j) {
+        // One of them may already have been merged into a third body earlier this step
+        if (bodies.mass[i] <= 0 || bodies.mass[j] <= 0) return;
+        mergeMasses(bodies, i, j);
+    }
+
+    static void resolveAt(BodySystem& bodies, const double* startX, const double* startY, size_t i, size_t j,
+                          double t, double dt) {
+        if (bodies.mass[i] <= 0 || bodies.mass[j] <= 0) return;
+        mergeMassesAt(bodies, startX, startY, i, j, t, dt);
+    }
+};
+
+// --- Integration schemes (see Integrator in integrator.h) ---
+
+// Bodies per chunk when a drift or kick is split across the thread pool
+inline constexpr size_t kIntegrateGrain = 4096;
+
+template <class Pin>
+void driftBodies(BodySystem& bodies, double dt, const Pin& pin) {
+    threadPool.parallelFor(0, bodies.size(), kIntegrateGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (pin.skips(i)) continue;
+            bodies.x[i] += bodies.vx[i] * dt;
+            bodies.y[i] += bodies.vy[i] * dt;
+        }
+    });
+}
+
+template <class Forces, class Pin>
+void kickBodies(BodySystem& bodies, double dt, const Pin& pin) {
+    Forces::compute(bodies);
+    threadPool.parallelFor(0, bodies.size(), kIntegrateGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (pin.skips(i)) continue;
+            bodies.vx[i] += bodies.ax[i] * dt;
+            bodies.vy[i] += bodies.ay[i] * dt;
+        }
+    });
+}
+
+struct EulerScheme {
+    template <class Forces, class Pin>
+    static void integrate(BodySystem& bodies, double dt, const Pin& pin) {
+        // Same order as the old per-mass calcVelocity then calcNewPos
+        Forces::compute(bodies);
+        threadPool.parallelFor(0, bodies.size(), kIntegrateGrain, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                if (pin.skips(i)) continue;
+                bodies.vx[i] += bodies.ax[i] * dt;
+                bodies.vy[i] += bodies.ay[i] * dt;
+                bodies.x[i] += bodies.vx[i] * dt;
+                bodies.y[i] += bodies.vy[i] * dt;
+            }
+        });
+    }
+};
+
+struct LeapfrogScheme {
+    template <class Forces, class Pin>
+    static void integrate(BodySystem& bodies, double dt, const Pin& pin) {
+        driftBodies(bodies, dt * 0.5, pin);
+        kickBodies<Forces>(bodies, dt, pin);
+        driftBodies(bodies, dt * 0.5, pin);
+    }
+};
+
+struct Yoshida4Scheme {
+    template <class Forces, class Pin>
+    static void integrate(BodySystem& bodies, double dt, const Pin& pin) {
+        // Yoshida's 4th order weights: w1 forward, w0 backward, w1 forward again
+        static const double cubeRootTwo = std::cbrt(2.0);
+        static const double w1 = 1.0 / (2.0 - cubeRootTwo);
+        static const double w0 = -cubeRootTwo / (2.0 - cubeRootTwo);
+
+        // Written out so the touching half-drifts of neighbouring leapfrogs merge:
+        // 4 drifts and 3 kicks instead of 6 and 3
+        driftBodies(bodies, dt * w1 * 0.5, pin);
+        kickBodies<Forces>(bodies, dt * w1, pin);
+        driftBodies(bodies, dt * (w0 + w1) * 0.5, pin);
+        kickBodies<Forces>(bodies, dt * w0, pin);
+        driftBodies(bodies, dt * (w0 + w1) * 0.5, pin);
+        kickBodies<Forces>(bodies, dt * w1, pin);
+        driftBodies(bodies, dt * w1 * 0.5, pin);
+    }
+};
+
+// Keeps its scratch lists between steps
+inline BlockTimestepper& blockTimestepper() {
+    static BlockTimestepper stepper;
+    return stepper;
+}
+
+// The block stepper picks its own force evaluations (only the bodies due a kick), always
+// through the forceSolver global, and moves every body; a pin is restored afterwards
+struct BlockScheme {
+    template <class Forces, class Pin>
+    static void integrate(BodySystem& bodies, double dt, const Pin& pin) {
+        blockTimestepper().step(bodies, dt);
+        pin.hold(bodies);
+    }
+};
+
+} // namespace SolarSim
@@ -0,0 +1,158 @@
+// snapshot.h
+// Versioned binary snapshots of a BodySystem: streamed out column by column,
+// opened again with mmap so the columns are read in place without copying.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "bodysystem.h"
+
+namespace SolarSim {
+
+// File layout (version 1), everything little-endian:
+//
+//   SnapshotHeader            fixed 160 bytes
+//   column 0 .. column 13     each starts on a 64-byte boundary, zero padding in between
+//
+// Columns are the BodySystem columns in body order. Names are stored as
+// bodyCount + 1 uint64 offsets into one blob of characters (no terminators).
+enum class SnapshotColumn : uint32_t {
+    X, Y, VX, VY, AX, AY,   // double
+    Mass, Radius,           // float
+    R, G, B,                // float
+    StepLevel,              // uint8
+    NameOffsets,            // uint64, bodyCount + 1 entries
+    NameChars,              // char
+    Count
+};
+
+constexpr size_t kSnapshotColumnCount = static_cast<size_t>(SnapshotColumn::Count);
+constexpr uint32_t kSnapshotVersion = 1;
+constexpr size_t kSnapshotAlignment = 64;
+
+struct SnapshotHeader {
+    char magic[8];                 // "SOLARSNP"
+    uint32_t version;
+    uint32_t headerBytes;          // sizeof(SnapshotHeader), lets later versions grow it
+    uint64_t bodyCount;
+    int64_t simFrame;
+    double simSeconds;
+    uint64_t columnOffset[kSnapshotColumnCount]; // from the start of the file
+    uint64_t fileBytes;
+};
+static_assert(sizeof(SnapshotHeader) == 160, "snapshot header layout changed");
+
+// Streams `bodies` to `path`, one column at a time through a small buffer, so the only
+// extra memory is the buffer no matter how many bodies there are. Throws std::runtime_error.
+void writeSnapshot(const std::string& path, const BodySystem& bodies, long long frame, double seconds);
+
+// Read-only view of a snapshot file. Opening maps the file and checks the header;
+// the column pointers point straight into the mapping.
+class MappedSnapshot {
+public:
+    MappedSnapshot() = default;
+    explicit MappedSnapshot(const std::string& path) { open(path); }
+    ~MappedSnapshot();
+
+    MappedSnapshot(const MappedSnapshot&) = delete;
+    MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+    MappedSnapshot(MappedSnapshot&& other) noexcept;
+    MappedSnapshot& operator=(MappedSnapshot&& other) noexcept;
+
+    // Throws std::runtime_error if the file can't be mapped or isn't a valid snapshot
+    void open(const std::string& path);
+    void close();
+
+    size_t size() const { return header ? static_cast<size_t>(header->bodyCount) : 0; }
+    long long frame() const { return header ? header->simFrame : 0; }
+    double seconds() const { return header ? header->simSeconds : 0.0; }
+
+    const double* x() const { return column<double>(SnapshotColumn::X); }
+    const double* y() const { return column<double>(SnapshotColumn::Y); }
+    const double* vx() const { return column<double>(SnapshotColumn::VX); }
+    const double* vy() const { return column<double>(SnapshotColumn::VY); }
+    const double* ax() const { return column<double>(SnapshotColumn::AX); }
+    const double* ay() const { return column<double>(SnapshotColumn::AY); }
+    const float* mass() const { return column<float>(SnapshotColumn::Mass); }
+    const float* radius() const { return column<float>(SnapshotColumn::Radius); }
+    const float* r() const { return column<float>(SnapshotColumn::R); }
+    const float* g() const { return column<float>(SnapshotColumn::G); }
+    const float* b() const { return column<float>(SnapshotColumn::B); }
+    const uint8_t* stepLevel() const { return column<uint8_t>(SnapshotColumn::StepLevel); }
+
+    // Throws std::runtime_error if the name's offsets point outside the name column
+    std::string_view name(size_t i) const;
+
+    // Copies everything into `bodies` (replacing what was there) so it can be simulated.
+    // Walks every name offset and step level first and throws std::runtime_error, leaving
+    // `bodies` alone, if any of them couldn't have been written by writeSnapshot.
+    void copyTo(BodySystem& bodies) const;
+
+private:
+    template <typename T>
+    const T* column(SnapshotColumn c) const {
+        return reinterpret_cast<const T*>(base + header->columnOffset[static_cast<size_t>(c)]);
+    }
+
+    [[noreturn]] void corrupt(const std::string& why) const;
+
+    std::string path; // for error messages
+    const unsigned char* base = nullptr;
+    size_t mappedBytes = 0;
+    const SnapshotHeader* header = nullptr;
+};
+
+// Writes snapshots on a background thread. The caller only pays for copying the
+// columns into a staging BodySystem (whose storage is reused), the disk I/O happens
+// elsewhere. Each write goes to path + ".tmp" first and is renamed over `path` once
+// complete, so a crash mid-write never leaves a truncated checkpoint behind.
+class Checkpointer {
+public:
+    ~Checkpointer();
+
+    // intervalSeconds is wall-clock time between automatic checkpoints, <= 0 turns them off
+    void start(const std::string& path, double intervalSeconds);
+    void stop();
+
+    bool enabled() const { return !path.empty(); }
+
+    // Call once per step: takes a checkpoint if the interval has passed
+    void maybeCheckpoint(const BodySystem& bodies, long long frame, double seconds);
+
+    // Takes a checkpoint now unless one is still being written (then it's skipped, not queued)
+    bool checkpoint(const BodySystem& bodies, long long frame, double seconds);
+
+    size_t written() const { return writtenCount.load(); }
+    double lastWriteSeconds() const { return lastWriteTime.load(); }
+
+private:
+    void run();
+
+    std::string path;
+    double interval = 0.0;
+    std::chrono::steady_clock::time_point lastCheckpoint;
+
+    std::thread thread;
+    std::mutex lock;
+    std::condition_variable wake;
+    bool pending = false;   // staged holds a checkpoint the thread hasn't picked up yet
+    bool busy = false;      // staged is in use until the write finishes
+    bool stopping = false;
+
+    BodySystem staged;
+    long long stagedFrame = 0;
+    double stagedSeconds = 0.0;
+
+    std::atomic<size_t> writtenCount{0};
+    std::atomic<double> lastWriteTime{0.0};
+};
+
+} // namespace SolarSim
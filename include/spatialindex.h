@@ -0,0 +1,124 @@
+// spatialindex.h
+// Dynamic bounding-box tree over bodies (or any circles), kept up to date incrementally:
+// every leaf's box is padded by a margin and the motion expected before the next update,
+// so an update only re-inserts the few bodies that left theirs. Answers point picks,
+// box / radius range queries and k-nearest neighbours in O(log N) plus the size of the
+// answer, and every overlapping pair in one pass over the tree.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "broadphase.h"
+
+namespace SolarSim {
+
+class BodySystem;
+
+struct SpatialIndexStats {
+    size_t leaves = 0;
+    size_t reinserted = 0; // leaves the last update added, moved or dropped
+    int height = 0;        // of the root, 0 for a single leaf
+};
+
+// Queries answer with circle indices as of the last update. Nothing here locks; one
+// thread updates and queries an index at a time.
+class SpatialIndex {
+public:
+    // Fits the tree to `bodies` as they are now. Boxes are padded by lookAhead seconds
+    // of each body's velocity, so a body only moves in the tree every few steps.
+    void update(const BodySystem& bodies, double lookAhead);
+
+    // Same, but each body's box covers its path from (startX[i], startY[i]) to where
+    // it is now, the way the swept collision test needs
+    void update(const BodySystem& bodies, const double* startX, const double* startY, double lookAhead);
+
+    // Plain circles, e.g. a render snapshot's columns. keys[i] names circle i across
+    // updates (a body's handle slot): a key that comes back is the same circle moved, a
+    // key that doesn't is dropped. Boxes are padded by the motion since the last update.
+    void update(size_t count, const double* x, const double* y, const float* radius, const uint32_t* keys);
+
+    void clear();
+
+    // Whether the last update was against `bodies` with the same bodies in the same
+    // order. Positions aren't compared; anything that moves bodies updates the index after.
+    bool matches(const BodySystem& bodies) const;
+
+    // For when the bodies have moved without an update: matches() says no until the next one
+    void markStale() { fromBodies = false; }
+
+    // The circle covering (x, y) whose centre is nearest, lowest index on a tie; -1 for none
+    int pick(double x, double y) const;
+
+    // Every circle overlapping the box, in index order
+    void queryBox(double minX, double minY, double maxX, double maxY, std::vector<uint32_t>& out) const;
+
+    // Every circle reaching within `range` of (x, y), in index order
+    void queryRadius(double x, double y, double range, std::vector<uint32_t>& out) const;
+
+    // The k circles whose centres are nearest (x, y), nearest first, lowest index on a tie
+    void nearest(double x, double y, size_t k, std::vector<uint32_t>& out) const;
+
+    // Every (i, j), i < j, whose unpadded boxes overlap, sorted by i then j: the same
+    // pairs SweepAndPrune::findCandidates gives for the same boxes. Uses the thread pool.
+    void findPairs(std::vector<BodyPair>& pairs) const;
+
+    const SpatialIndexStats& stats() const { return current; }
+
+private:
+    static constexpr int32_t kNull = -1;
+
+    struct Box {
+        double minX, minY, maxX, maxY;
+    };
+
+    struct Node {
+        Box box;   // leaves: padded
+        Box tight; // leaves: the circle, or its path, itself
+        double x, y;
+        float radius;
+        uint32_t index; // leaves: circle index as of the last update
+        uint32_t seen;  // leaves: update stamp, anything not seen in an update is dropped
+        int32_t parent; // next free node while on the free list
+        int32_t left;   // kNull for leaves
+        int32_t right;
+        int32_t height; // 0 for leaves, -1 while free
+    };
+
+    // Every overload comes down to this; keys, start and velocity columns may be null
+    void refit(size_t count, const double* x, const double* y, const float* radius, const uint32_t* keys,
+               const double* startX, const double* startY, const double* vx, const double* vy, double lookAhead);
+
+    int32_t allocateNode();
+    void freeNode(int32_t node);
+    void insertLeaf(int32_t leaf);
+    void removeLeaf(int32_t leaf);
+    int32_t balance(int32_t node);
+
+    // Fixes heights and boxes from `node` up to the root, rebalancing on the way
+    void refitUpwards(int32_t node);
+
+    // Throws away every inner node and builds the tree over the leaves again top down,
+    // cheaper than re-inserting when most of them have moved
+    void rebuild();
+    int32_t buildRange(int32_t* first, int32_t* last);
+
+    // Calls visit(leaf) for every leaf whose padded box overlaps `box`
+    template <class Visit>
+    void visitOverlapping(const Box& box, std::vector<int32_t>& stack, Visit&& visit) const;
+
+    std::vector<Node> nodes;
+    int32_t root = kNull;
+    int32_t freeList = kNull;
+    std::vector<int32_t> leafOfKey;   // kNull where no leaf has the key
+    std::vector<int32_t> leafOfIndex; // from the last update
+    std::vector<int32_t> moved;       // scratch: leaves whose box changed this update
+    uint32_t stamp = 0;
+    uint64_t layout = 0;
+    bool fromBodies = false; // last updated from a BodySystem that hasn't moved since
+
+    SpatialIndexStats current;
+};
+
+} // namespace SolarSim
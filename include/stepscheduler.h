@@ -0,0 +1,67 @@
+// stepscheduler.h
+// Decides how many physics steps the interactive app runs per tick: enough to keep up
+// with a requested sim speed (sim-seconds per wall-second), as long as they fit in a
+// wall-clock budget. Every step in a tick has the same size, capped for accuracy.
+#pragma once
+
+namespace SolarSim {
+
+// Physics ticks (snapshots) per wall-second in the interactive app
+inline constexpr double kPhysicsTickRate = 60.0;
+
+// Range the UI lets the requested speed move in, sim-seconds per wall-second
+inline constexpr double kMinSimSpeed = 1.0;
+inline constexpr double kMaxSimSpeed = 1e9;
+
+// Step size for a requested speed: a single step per tick while that stays under maxDt,
+// maxDt (and as many steps as that takes) beyond. Depends on nothing but its arguments,
+// so a replay can work out the same step sizes the live run used.
+double scheduledStepDt(double simSpeed, double maxDt, double ticksPerSecond);
+
+struct ScheduleStats {
+    double requestedSpeed = 0.0; // sim-seconds per wall-second asked for
+    double achievedSpeed = 0.0;  // actually advanced, over the last half second or so
+    double stepDt = 0.0;         // size of each step last tick
+    double stepCost = 0.0;       // wall seconds per step, smoothed
+    int stepsLastTick = 0;
+    bool budgetLimited = false;  // the last tick ran out of budget before catching up
+};
+
+// Per tick: beginTick(), then step while wantsStep() says so, calling stepDone() after
+// each, then endTick(). Sim time the budget couldn't cover is dropped rather than owed,
+// so a slow patch doesn't turn into a burst of steps later.
+class StepScheduler {
+public:
+    // Wall-clock seconds per tick that steps may use
+    void setBudget(double seconds) { budget = seconds; }
+    double stepBudget() const { return budget; }
+
+    void beginTick(double simSpeed, double maxDt, double ticksPerSecond);
+
+    // `elapsed` is how long this tick's steps have taken so far. The first step of a
+    // tick always runs; after that only while another one is owed and should fit.
+    bool wantsStep(double elapsed) const;
+    double stepDt() const { return dt; }
+
+    void stepDone(double wallSeconds);
+
+    // `tickWallSeconds` is the wall time since the previous endTick()
+    void endTick(double tickWallSeconds);
+
+    const ScheduleStats& stats() const { return current; }
+
+private:
+    double budget = 0.0125;
+    double dt = 0.0;
+    double owed = 0.0;         // sim seconds requested but not stepped yet
+    double costEstimate = 0.0; // smoothed wall seconds per step, 0 until the first one
+    int steps = 0;
+
+    // Sim and wall time since the achieved speed was last measured
+    double windowSim = 0.0;
+    double windowWall = 0.0;
+
+    ScheduleStats current;
+};
+
+} // namespace SolarSim
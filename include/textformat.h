@@ -0,0 +1,25 @@
+// textformat.h
+// Number formatting for per-frame HUD strings, appended in place without streams.
+#pragma once
+
+#include <string>
+
+namespace SolarSim {
+
+// All of these append to `out`. Nothing allocates once `out` has grown to its usual
+// size, so a HUD string that is cleared and rebuilt every frame costs no heap traffic.
+void appendInt(std::string& out, long long value);
+
+// Zero padded to at least `width` digits ("07")
+void appendPadded(std::string& out, long long value, int width);
+
+// Fixed point with `decimals` digits after the point ("0.25")
+void appendFixed(std::string& out, double value, int decimals);
+
+// Shortest of fixed / scientific with `precision` significant digits, like a stream's default
+void appendGeneral(std::string& out, double value, int precision);
+
+// Simulated time as "12d 03h 04m 05s"
+void appendSimTime(std::string& out, double seconds);
+
+} // namespace SolarSim
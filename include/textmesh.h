@@ -0,0 +1,50 @@
+// textmesh.h
+// Turns HUD strings into triangle lists with stb_easy_font. No GL in here.
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace SolarSim {
+
+// Scratch stb_easy_font needs per character (worst case quads per glyph * 4 vertices * 16 bytes)
+inline constexpr size_t kEasyFontBytesPerChar = 288;
+
+// Pixels stb_easy_font moves down for every '\n', before scaling
+inline constexpr float kEasyFontLineHeight = 12.0f;
+
+// Fills `vertices` with x, y pairs, two triangles per glyph quad, scaled by `scale`
+// and then moved by the offset. `scratch` is only reused between calls so nothing
+// gets allocated once it has grown. Returns the number of vertices, 0 for empty text.
+int buildTextMesh(const std::string& text, float scale, float offsetX, float offsetY,
+                  std::vector<unsigned char>& scratch, std::vector<float>& vertices);
+
+// Width of the text in unscaled pixels
+float textWidth(const std::string& text);
+
+// Remembers the mesh of every recently drawn line, keyed by its text and scale, so a HUD
+// line that reads the same as it did before (or flips back to an earlier value) never
+// goes through stb_easy_font again.
+class TextLayoutCache {
+public:
+    // Triangles for one line of text with its top-left corner at the origin, scaled.
+    // The reference stays valid until the next call.
+    const std::vector<float>& layout(std::string_view line, float scale);
+
+    size_t size() const { return entries.size(); }
+
+private:
+    // Everything is dropped once this many lines pile up (a ticking clock adds one a second)
+    static constexpr size_t kMaxEntries = 512;
+
+    // Key is the scale's bytes followed by the text
+    std::unordered_map<std::string, std::vector<float>> entries;
+    std::string key;
+    std::string text;
+    std::vector<unsigned char> scratch;
+};
+
+} // namespace SolarSim
@@ -0,0 +1,73 @@
+// threadpool.h
+// Persistent work-stealing thread pool used to spread the simulation step across cores.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SolarSim {
+
+class ThreadPool {
+public:
+    // 0 threads means one per hardware thread. The calling thread always counts as one of them.
+    explicit ThreadPool(unsigned threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Stops the current workers and starts threadCount - 1 new ones
+    void resize(unsigned threadCount);
+    unsigned size() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    // Splits [begin, end) into chunks of at most `grain` items and runs fn(chunkBegin, chunkEnd)
+    // on every thread until all chunks are done. Each thread starts on its own contiguous slice
+    // and steals from the back of the others once it runs dry.
+    //
+    // Chunks are always the same no matter how many threads there are, so as long as fn
+    // only writes to its own range the results are identical for any thread count.
+    // Not reentrant: fn must not call parallelFor itself.
+    void parallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& fn);
+
+private:
+    // Range of chunk indices owned by one thread. The owner takes from the head,
+    // thieves take from the tail.
+    struct alignas(64) ChunkQueue {
+        std::mutex lock;
+        size_t head = 0;
+        size_t tail = 0;
+    };
+
+    struct Job {
+        const std::function<void(size_t, size_t)>* fn = nullptr;
+        size_t begin = 0;
+        size_t end = 0;
+        size_t grain = 1;
+    };
+
+    void start(unsigned threadCount);
+    void stop();
+    void workerLoop(unsigned index);
+    bool popChunk(unsigned index, size_t& chunk);
+    void runChunk(size_t chunk);
+
+    std::vector<std::thread> workers;
+    std::unique_ptr<ChunkQueue[]> queues; // one per thread, queue 0 belongs to the caller
+    Job job;
+
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    uint64_t generation = 0;
+    bool stopping = false;
+
+    std::atomic<size_t> chunksRemaining{0};
+};
+
+} // namespace SolarSim
@@ -0,0 +1,159 @@
+// trajectory.h
+// Compressed trajectory stream: every body's position and velocity at a fixed step cadence,
+// quantized, delta-encoded against the previous frame and written by a background thread.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SolarSim {
+
+class BodySystem;
+
+// File layout, everything little-endian:
+//
+//   TrajectoryHeader
+//   frame*  where each frame is
+//     uint8  kind (TrajectoryFrameKind)
+//     int64  simFrame, double simSeconds
+//     uint64 bodyCount, uint64 payloadBytes
+//     payload: per body, zigzag varints of the quantized x, y, vx, vy. Keyframes store the
+//              values themselves, delta frames the change since the previous frame.
+//              Keyframes put the body's handle slot and generation (plain varints) in
+//              front of its values; delta frames have the same bodies in the same order.
+//
+// Quantization happens before the delta, so decoding reproduces the quantized values
+// exactly and the error never accumulates along the stream. Body indices shift when
+// bodies merge, the slot / generation pair names the same body for as long as it exists.
+enum class TrajectoryFrameKind : uint8_t {
+    Key = 1,
+    Delta = 2,
+};
+
+struct TrajectoryHeader {
+    char magic[8];              // "SOLARTRJ"
+    uint32_t version;
+    uint32_t keyframeInterval;  // a keyframe at least this often (and whenever bodies come, go or move)
+    double positionQuantum;     // metres per step of the stored integers
+    double velocityQuantum;     // metres per second per step
+};
+static_assert(sizeof(TrajectoryHeader) == 32, "trajectory header layout changed");
+
+constexpr uint32_t kTrajectoryVersion = 2;
+
+struct TrajectoryOptions {
+    int everySteps = 1;               // record one frame per this many simulation steps
+    double positionQuantum = 1.0;     // 1 m
+    double velocityQuantum = 1e-4;    // 0.1 mm/s
+    uint32_t keyframeInterval = 256;
+    size_t bufferCount = 4;           // raw frames allowed in flight before new ones are dropped
+};
+
+// Writer-side numbers, safe to read from any thread
+struct TrajectoryStats {
+    size_t framesWritten = 0;
+    size_t framesDropped = 0;      // the I/O thread was behind and every buffer was full
+    size_t lastFrameBytes = 0;
+    double averageFrameBytes = 0.0;
+    double writerMBPerSecond = 0.0; // encoded bytes per second of encode + write time
+    bool failed = false;            // a write failed and recording stopped; nothing after it is counted
+};
+
+class TrajectoryWriter {
+public:
+    ~TrajectoryWriter();
+
+    // Throws std::runtime_error if the file can't be created or its header written
+    void start(const std::string& path, const TrajectoryOptions& options);
+    void stop();
+
+    bool enabled() const { return file != nullptr; }
+
+    // Call once per step. Copies the positions and velocities into a free buffer if a frame
+    // is due; never waits for the disk (if nothing is free the frame is dropped and counted).
+    void record(const BodySystem& bodies, long long frame, double seconds);
+
+    TrajectoryStats stats() const;
+
+private:
+    struct RawFrame {
+        long long frame = 0;
+        double seconds = 0.0;
+        uint64_t layout = 0; // BodySystem::layoutVersion() when it was taken
+        std::vector<double> x, y, vx, vy;
+        std::vector<uint32_t> slot, generation;
+    };
+
+    void run();
+    void encode(const RawFrame& raw);
+
+    std::FILE* file = nullptr;
+    TrajectoryOptions options;
+    long long stepsSeen = 0;
+
+    std::thread thread;
+    mutable std::mutex lock;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::vector<RawFrame> buffers;
+    std::vector<size_t> freeBuffers;   // indices into buffers, owned by the sim side
+    std::vector<size_t> queuedBuffers; // filled, waiting for the I/O thread (in order)
+
+    // I/O thread only
+    std::vector<int64_t> previous;     // quantized x, y, vx, vy of the last frame written
+    uint64_t previousLayout = 0;
+    std::vector<uint8_t> encoded;
+    uint32_t framesSinceKey = 0;
+    bool writeFailed = false;
+    double busySeconds = 0.0;
+    size_t totalBytes = 0;
+
+    TrajectoryStats current;           // guarded by lock
+};
+
+// One decoded frame
+struct TrajectoryFrame {
+    long long frame = 0;
+    double seconds = 0.0;
+    bool keyframe = false;
+    std::vector<double> x, y, vx, vy;
+    std::vector<uint32_t> slot, generation; // each body's handle, see BodySystem::handle
+
+    size_t size() const { return x.size(); }
+};
+
+// Sequential reader. Throws std::runtime_error on a bad or truncated file.
+class TrajectoryReader {
+public:
+    explicit TrajectoryReader(const std::string& path);
+    ~TrajectoryReader();
+
+    TrajectoryReader(const TrajectoryReader&) = delete;
+    TrajectoryReader& operator=(const TrajectoryReader&) = delete;
+
+    const TrajectoryHeader& header() const { return fileHeader; }
+
+    // Decodes the next frame into `out`, returns false at the end of the file
+    bool next(TrajectoryFrame& out);
+
+    // Bytes the last frame took on disk, header included
+    size_t lastFrameBytes() const { return frameBytes; }
+
+private:
+    std::FILE* file = nullptr;
+    std::string path;
+    TrajectoryHeader fileHeader{};
+    std::vector<int64_t> previous;
+    std::vector<uint32_t> keySlot, keyGeneration; // from the last keyframe
+    std::vector<uint8_t> payload;
+    size_t frameBytes = 0;
+};
+
+} // namespace SolarSim
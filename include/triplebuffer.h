@@ -0,0 +1,46 @@
+// triplebuffer.h
+// Lock-free single-producer / single-consumer triple buffer.
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace SolarSim {
+
+// Three copies of T: the writer fills one, the reader holds one, and the third sits
+// in the middle holding the newest finished copy. Publishing and picking up are a
+// single atomic exchange each, so neither side ever waits on the other.
+template <typename T>
+class TripleBuffer {
+public:
+    // Writer side: the copy to fill next
+    T& writeBuffer() { return slots[backIndex]; }
+
+    // Writer side: hand the filled copy over and take the old middle one to fill next
+    void publish() {
+        uint8_t previous = middle.exchange(static_cast<uint8_t>(backIndex | kFreshBit), std::memory_order_acq_rel);
+        backIndex = previous & kIndexMask;
+    }
+
+    // Reader side: switch to the newest published copy if there is one. Returns true if it switched.
+    bool update() {
+        if ((middle.load(std::memory_order_relaxed) & kFreshBit) == 0) return false;
+        uint8_t previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+        frontIndex = previous & kIndexMask;
+        return true;
+    }
+
+    // Reader side: the copy picked up by the last update(). Stays valid until the next update().
+    const T& readBuffer() const { return slots[frontIndex]; }
+
+private:
+    static constexpr uint8_t kIndexMask = 0x3;
+    static constexpr uint8_t kFreshBit = 0x4;
+
+    T slots[3];
+    uint8_t backIndex = 0;              // only touched by the writer
+    uint8_t frontIndex = 1;             // only touched by the reader
+    std::atomic<uint8_t> middle{2};     // index of the spare copy, plus kFreshBit once published
+};
+
+} // namespace SolarSim
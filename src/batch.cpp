@@ -0,0 +1,543 @@
+// Headless runner: advances a scene as fast as the CPU allows and reports throughput.
+// Links only against libsolarsim_core, so it runs on machines without a display.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gravity.h"
+#include "gravitykernel.h"
+#include "integrator.h"
+#include "particlemesh.h"
+#include "physicsthread.h"
+#include "profiler.h"
+#include "scene.h"
+#include "sceneloader.h"
+#include "sessionrecord.h"
+#include "simglobals.h"
+#include "simulation.h"
+#include "snapshot.h"
+#include "stepscheduler.h"
+#include "trajectory.h"
+
+using namespace SolarSim;
+
+namespace {
+
+// Bodies above which the O(N²) energy check is skipped
+constexpr size_t kMaxEnergyBodies = 20000;
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "  --steps N          advance N steps (default 10000)\n"
+              << "  --seconds T        advance until T simulated seconds have passed\n"
+              << "  --dt S             step size in simulated seconds (default " << timeStepMult << ")\n"
+              << "  --threads N        worker threads, 0 = one per core (default 0)\n"
+              << "  --solver NAME      direct | barnes-hut | particle-mesh (default direct)\n"
+              << "  --theta X          Barnes-Hut opening angle (default " << barnesHutTheta << ")\n"
+              << "  --mesh-grid N      particle-mesh cells per side, a power of two (default " << particleMeshGrid << ")\n"
+              << "  --mesh-only        particle-mesh without the direct short-range correction (plain PM, not P3M)\n"
+              << "  --random N         add N random moon-sized bodies to the default scene\n"
+              << "  --seed S           seed for --random (default 1)\n"
+              << "  --integrator NAME  euler | leapfrog | yoshida4 | block (default euler)\n"
+              << "  --collisions MODE  bounce | merge (default bounce)\n"
+              << "  --broadphase NAME  sweep | tree: where collision candidates come from (default sweep,\n"
+              << "                     both find the same pairs)\n"
+              << "  --pin NAME         hold the body called NAME in place (e.g. Earth in the default scene)\n"
+              << "  --load FILE        start from a snapshot instead of the default scene\n"
+              << "  --scene FILE       start from a CSV / JSON body catalogue instead of the default scene\n"
+              << "  --save FILE        write a snapshot when the run finishes\n"
+              << "  --checkpoint FILE  write snapshots to FILE in the background while running\n"
+              << "  --checkpoint-every S\n"
+              << "                     wall-clock seconds between checkpoints (default 60)\n"
+              << "  --trajectory FILE  record positions and velocities to FILE (read it with solarsim-trajdump)\n"
+              << "  --trajectory-every N\n"
+              << "                     record every Nth step (default 1)\n"
+              << "  --trajectory-quantum M\n"
+              << "                     position resolution in metres (default 1, velocity gets M * 1e-4 m/s)\n"
+              << "  --replay FILE      re-run a session recorded with SolarSim --record: its starting setup,\n"
+              << "                     and every command on the frame it was first applied\n"
+              << "  --trace FILE       print per-phase timings and write them as a Chrome trace when done\n"
+              << "                     (needs a PROFILE=1 build, the default)\n"
+              << "  --compare-integrators\n"
+              << "                     run every integrator at dt, 4dt, 16dt and 64dt for --seconds\n"
+              << "                     (default 30 days) and report energy error against speed\n"
+              << "  --compare-solvers  time one force evaluation with each solver and mesh size and report\n"
+              << "                     its error against the exact direct sum\n";
+}
+
+// Snapshot or catalogue to start from, both empty for the default scene
+std::string loadPath;
+std::string scenePath;
+
+// Body to pin after every reset, empty for none
+std::string pinName;
+
+void resetScene(size_t randomBodies, uint32_t seed) {
+    bodies.clear();
+    simFrame = 0;
+    simSeconds = 0.0;
+    collisionStats = CollisionStats{};
+
+    if (loadPath.empty() && !scenePath.empty()) {
+        SceneLoadStats loaded = loadSceneFile(scenePath, bodies);
+        std::cout << "Loaded " << loaded.bodies << " bodies from " << scenePath << " in "
+                  << loaded.seconds * 1000.0 << " ms (" << loaded.megabytesPerSecond() << " MB/s, "
+                  << loaded.chunks << " chunks, " << loaded.distinctNames << " distinct names)\n";
+    } else if (loadPath.empty()) {
+        loadDefaultScene(bodies);
+    } else {
+        auto start = std::chrono::steady_clock::now();
+        MappedSnapshot snapshot(loadPath);
+        double mapMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        snapshot.copyTo(bodies);
+        double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        simFrame = snapshot.frame();
+        simSeconds = snapshot.seconds();
+        std::cout << "Loaded " << snapshot.size() << " bodies from " << loadPath
+                  << " (mapped in " << mapMs << " ms, copied in " << loadMs << " ms)\n";
+    }
+
+    addRandomBodies(bodies, randomBodies, seed);
+
+    if (!pinName.empty() && !pinBodyByName(bodies, pinName)) {
+        throw std::runtime_error("No body called " + pinName + " to pin");
+    }
+}
+
+// Runs one scheme until `seconds` have passed and reports how far the total energy wandered.
+// Energy checks are O(N²), so they are sampled and kept out of the timed part.
+void compareRun(Integrator scheme, double dt, double seconds, size_t randomBodies, uint32_t seed) {
+    resetScene(randomBodies, seed);
+    integrator = scheme;
+
+    const long long steps = static_cast<long long>(std::ceil(seconds / dt));
+    const long long sampleEvery = std::max(1LL, steps / 256);
+    const double startEnergy = totalEnergy(bodies);
+    double maxError = 0.0;
+    double wallSeconds = 0.0;
+
+    for (long long s = 0; s < steps; ++s) {
+        auto start = std::chrono::steady_clock::now();
+        stepSimulation(bodies, dt);
+        wallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if ((s + 1) % sampleEvery == 0 || s + 1 == steps) {
+            double error = std::abs((totalEnergy(bodies) - startEnergy) / startEnergy);
+            maxError = std::max(maxError, error);
+        }
+    }
+    if (wallSeconds <= 0.0) wallSeconds = 1e-9;
+
+    std::cout << std::left << std::setw(22) << integratorName(scheme) << std::right
+              << std::setw(10) << std::setprecision(6) << dt
+              << std::setw(10) << steps
+              << std::setw(16) << std::setprecision(4) << simSeconds / wallSeconds
+              << std::setw(14) << std::setprecision(3) << std::scientific << maxError
+              << std::defaultfloat << std::setprecision(6) << '\n';
+}
+
+int compareIntegrators(double dt, double seconds, size_t randomBodies, uint32_t seed) {
+    if (seconds <= 0.0) seconds = 30.0 * 86400.0;
+
+    std::cout << "Comparing integrators over " << seconds << " sim seconds, "
+              << forceSolverName(forceSolver) << " solver\n"
+              << std::left << std::setw(22) << "Integrator" << std::right
+              << std::setw(10) << "dt"
+              << std::setw(10) << "steps"
+              << std::setw(16) << "sim-s/wall-s"
+              << std::setw(14) << "max |dE/E|" << '\n';
+
+    const Integrator schemes[] = {Integrator::SemiImplicitEuler, Integrator::Leapfrog, Integrator::Yoshida4,
+                                  Integrator::BlockLeapfrog};
+    for (Integrator scheme : schemes) {
+        for (double mult : {1.0, 4.0, 16.0, 64.0}) {
+            compareRun(scheme, dt * mult, seconds, randomBodies, seed);
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+// Median and 99th percentile of |a - exact| / |exact| over every body
+void accelerationError(const std::vector<double>& exactX, const std::vector<double>& exactY, double& median,
+                       double& p99) {
+    std::vector<double> errors(bodies.size());
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        const double exact = std::hypot(exactX[i], exactY[i]);
+        const double diff = std::hypot(bodies.ax[i] - exactX[i], bodies.ay[i] - exactY[i]);
+        errors[i] = exact > 0.0 ? diff / exact : 0.0;
+    }
+    const size_t mid = errors.size() / 2;
+    const size_t rank = (errors.size() * 99 + 99) / 100 - 1;
+    std::nth_element(errors.begin(), errors.begin() + mid, errors.end());
+    median = errors[mid];
+    std::nth_element(errors.begin(), errors.begin() + rank, errors.end());
+    p99 = errors[rank];
+}
+
+struct SolverResult {
+    double bestMs = 0.0;
+    double median = 0.0;
+    double p99 = 0.0;
+};
+
+// Best of three timed evaluations, and the error of the last one
+template <class Solve>
+SolverResult timeSolver(const std::vector<double>& exactX, const std::vector<double>& exactY, Solve solve) {
+    SolverResult result;
+    for (int run = 0; run < 3; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        solve();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        result.bestMs = run == 0 ? ms : std::min(result.bestMs, ms);
+    }
+    accelerationError(exactX, exactY, result.median, result.p99);
+    return result;
+}
+
+void printSolverRow(const char* name, const std::string& resolution, const SolverResult& result) {
+    std::cout << std::left << std::setw(16) << name << std::setw(24) << resolution << std::right
+              << std::setw(12) << std::setprecision(4) << result.bestMs
+              << std::setw(14) << std::setprecision(3) << std::scientific << result.median
+              << std::setw(14) << result.p99 << std::defaultfloat << std::setprecision(6) << '\n';
+}
+
+// One force evaluation of the starting scene per solver, against the exact direct sum:
+// how the mesh size trades time for accuracy, with Barnes-Hut for scale
+int compareSolvers(size_t randomBodies, uint32_t seed) {
+    resetScene(randomBodies, seed);
+    if (bodies.size() < 2) {
+        std::cerr << "Need at least two bodies to compare solvers\n";
+        return EXIT_FAILURE;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    computeAccelerationsDirect(bodies);
+    const double directMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    const std::vector<double> exactX = bodies.ax;
+    const std::vector<double> exactY = bodies.ay;
+
+    std::cout << "Comparing force solvers on " << bodies.size() << " bodies, direct sum took " << directMs
+              << " ms\n"
+              << std::left << std::setw(16) << "Solver" << std::setw(24) << "Resolution" << std::right
+              << std::setw(12) << "ms" << std::setw(14) << "median err" << std::setw(14) << "p99 err" << '\n';
+
+    SolverResult tree = timeSolver(exactX, exactY, [] { computeAccelerationsBarnesHut(bodies, barnesHutTheta); });
+    std::ostringstream theta;
+    theta << "theta " << barnesHutTheta;
+    printSolverRow("Barnes-Hut", theta.str(), tree);
+
+    ParticleMesh mesh;
+    for (bool shortRange : {false, true}) {
+        for (size_t grid = 64; grid <= 1024; grid *= 2) {
+            SolverResult result =
+                timeSolver(exactX, exactY, [&] { mesh.computeAccelerations(bodies, grid, shortRange); });
+            std::ostringstream resolution;
+            resolution << grid << "^2, " << std::setprecision(3) << mesh.cellSize() << " m";
+            printSolverRow(shortRange ? "P3M" : "Particle-mesh", resolution.str(), result);
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    long long steps = 10000;
+    double targetSeconds = -1.0;
+    double dt = timeStepMult;
+    size_t randomBodies = 0;
+    uint32_t seed = 1;
+    bool compare = false;
+    bool compareForces = false;
+    std::string savePath;
+    std::string checkpointPath;
+    double checkpointEvery = 60.0;
+    std::string trajectoryPath;
+    TrajectoryOptions trajectoryOptions;
+    std::string tracePath;
+    std::string replayPath;
+    Session replay;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (std::strcmp(arg, "--steps") == 0 && hasValue) {
+            steps = std::atoll(argv[++i]);
+        } else if (std::strcmp(arg, "--seconds") == 0 && hasValue) {
+            targetSeconds = std::atof(argv[++i]);
+        } else if (std::strcmp(arg, "--dt") == 0 && hasValue) {
+            dt = std::atof(argv[++i]);
+        } else if (std::strcmp(arg, "--threads") == 0 && hasValue) {
+            threadPool.resize(static_cast<unsigned>(std::max(0, std::atoi(argv[++i]))));
+        } else if (std::strcmp(arg, "--solver") == 0 && hasValue) {
+            if (!forceSolverFromName(argv[++i], forceSolver)) {
+                std::cerr << "Unknown solver: " << argv[i] << '\n';
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(arg, "--integrator") == 0 && hasValue) {
+            if (!integratorFromName(argv[++i], integrator)) {
+                std::cerr << "Unknown integrator: " << argv[i] << '\n';
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(arg, "--collisions") == 0 && hasValue) {
+            if (!collisionModeFromName(argv[++i], collisionMode)) {
+                std::cerr << "Unknown collision mode: " << argv[i] << '\n';
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(arg, "--broadphase") == 0 && hasValue) {
+            if (!broadPhaseFromName(argv[++i], broadPhase)) {
+                std::cerr << "Unknown broad phase: " << argv[i] << '\n';
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(arg, "--pin") == 0 && hasValue) {
+            pinName = argv[++i];
+        } else if (std::strcmp(arg, "--load") == 0 && hasValue) {
+            loadPath = argv[++i];
+        } else if (std::strcmp(arg, "--scene") == 0 && hasValue) {
+            scenePath = argv[++i];
+        } else if (std::strcmp(arg, "--save") == 0 && hasValue) {
+            savePath = argv[++i];
+        } else if (std::strcmp(arg, "--checkpoint") == 0 && hasValue) {
+            checkpointPath = argv[++i];
+        } else if (std::strcmp(arg, "--checkpoint-every") == 0 && hasValue) {
+            checkpointEvery = std::atof(argv[++i]);
+        } else if (std::strcmp(arg, "--trajectory") == 0 && hasValue) {
+            trajectoryPath = argv[++i];
+        } else if (std::strcmp(arg, "--trajectory-every") == 0 && hasValue) {
+            trajectoryOptions.everySteps = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(arg, "--trajectory-quantum") == 0 && hasValue) {
+            trajectoryOptions.positionQuantum = std::atof(argv[++i]);
+            trajectoryOptions.velocityQuantum = trajectoryOptions.positionQuantum * 1e-4;
+        } else if (std::strcmp(arg, "--replay") == 0 && hasValue) {
+            replayPath = argv[++i];
+        } else if (std::strcmp(arg, "--trace") == 0 && hasValue) {
+            tracePath = argv[++i];
+        } else if (std::strcmp(arg, "--compare-integrators") == 0) {
+            compare = true;
+        } else if (std::strcmp(arg, "--compare-solvers") == 0) {
+            compareForces = true;
+        } else if (std::strcmp(arg, "--theta") == 0 && hasValue) {
+            barnesHutTheta = std::atof(argv[++i]);
+        } else if (std::strcmp(arg, "--mesh-only") == 0) {
+            particleMeshShortRange = false;
+        } else if (std::strcmp(arg, "--mesh-grid") == 0 && hasValue) {
+            particleMeshGrid = static_cast<size_t>(std::atoll(argv[++i]));
+        } else if (std::strcmp(arg, "--random") == 0 && hasValue) {
+            randomBodies = static_cast<size_t>(std::atoll(argv[++i]));
+        } else if (std::strcmp(arg, "--seed") == 0 && hasValue) {
+            seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // A replay starts from whatever the recorded session started from
+    if (!replayPath.empty()) {
+        try {
+            replay = loadSession(replayPath);
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to load session: " << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+        const SessionSettings& settings = replay.settings;
+        dt = settings.dt;
+        simSpeed = settings.speed;
+        integrator = settings.integrator;
+        forceSolver = settings.solver;
+        collisionMode = settings.collisions;
+        barnesHutTheta = settings.theta;
+        particleMeshGrid = settings.meshGrid;
+        particleMeshShortRange = settings.meshShortRange;
+        scenePath = settings.scenePath;
+        loadPath = settings.loadPath;
+        pinName = settings.pinName;
+        randomBodies = 0;
+        targetSeconds = -1.0;
+    }
+
+    if (dt <= 0.0) {
+        std::cerr << "--dt must be positive\n";
+        return EXIT_FAILURE;
+    }
+    if (particleMeshGrid < kMinMeshGrid || particleMeshGrid > kMaxMeshGrid ||
+        (particleMeshGrid & (particleMeshGrid - 1)) != 0) {
+        std::cerr << "--mesh-grid must be a power of two from " << kMinMeshGrid << " to " << kMaxMeshGrid << '\n';
+        return EXIT_FAILURE;
+    }
+
+    try {
+        if (compare) {
+            return compareIntegrators(dt, targetSeconds, randomBodies, seed);
+        }
+        if (compareForces) {
+            return compareSolvers(randomBodies, seed);
+        }
+        resetScene(randomBodies, seed);
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to load scene: " << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    // Runs to the frame the session ended on, or its last command if it never got to write one
+    if (!replayPath.empty()) {
+        long long endFrame = replay.endFrame;
+        if (endFrame < 0) endFrame = replay.commands.empty() ? simFrame : replay.commands.back().frame + 1;
+        steps = std::max(0LL, endFrame - simFrame);
+        std::cout << "Replaying " << replay.commands.size() << " commands from " << replayPath << " up to frame "
+                  << endFrame << " (recorded with seed " << replay.settings.seed << ")\n";
+    }
+
+    // The energy sum is O(N²), skip it for scenes where it would take longer than the run,
+    // and for replays, where spawned masses change it anyway
+    const bool trackEnergy = bodies.size() <= kMaxEnergyBodies && replayPath.empty();
+    const double startEnergy = trackEnergy ? totalEnergy(bodies) : 0.0;
+    const long long startFrame = simFrame;
+    const double startSeconds = simSeconds;
+
+    if (!checkpointPath.empty()) {
+        checkpointer.start(checkpointPath, checkpointEvery);
+    }
+    if (!trajectoryPath.empty()) {
+        if (trajectoryOptions.positionQuantum <= 0.0) {
+            std::cerr << "--trajectory-quantum must be positive\n";
+            return EXIT_FAILURE;
+        }
+        try {
+            trajectoryWriter.start(trajectoryPath, trajectoryOptions);
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to start trajectory output: " << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::cout << "Bodies:  " << bodies.size() << '\n'
+              << "Solver:  " << forceSolverName(forceSolver) << '\n'
+              << "Integrator: " << integratorName(integrator) << '\n'
+              << "Collisions: " << collisionModeName(collisionMode) << (pinnedBody.isNull() ? "" : ", one body pinned")
+              << '\n'
+              << "Broad phase: " << broadPhaseName(broadPhase) << '\n'
+              << "Kernel:  " << simdLevelName(simdLevel) << '\n'
+              << "Threads: " << threadPool.size() << '\n';
+
+    if (kProfilerEnabled) profiler.nameThread("Main");
+    auto start = std::chrono::steady_clock::now();
+
+    size_t totalCollisions = 0;
+    size_t totalSwept = 0;
+    size_t nextCommand = 0;
+    BodyHandle replaySelected;
+    auto advance = [&] {
+        while (nextCommand < replay.commands.size() && replay.commands[nextCommand].frame <= simFrame) {
+            applyCommand(bodies, replay.commands[nextCommand].command, replaySelected);
+            nextCommand++;
+        }
+        // The step size the live run's scheduler picked for the speed it was at
+        const double stepDt = replayPath.empty() ? dt : scheduledStepDt(simSpeed, dt, replay.settings.tickRate);
+        stepSimulation(bodies, stepDt);
+        totalCollisions += collisionStats.collisions;
+        totalSwept += collisionStats.swept;
+        checkpointer.maybeCheckpoint(bodies, simFrame, simSeconds);
+        trajectoryWriter.record(bodies, simFrame, simSeconds);
+    };
+
+    if (targetSeconds >= 0.0) {
+        while (simSeconds - startSeconds < targetSeconds) advance();
+    } else {
+        for (long long s = 0; s < steps; ++s) advance();
+    }
+
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (wallSeconds <= 0.0) wallSeconds = 1e-9;
+
+    std::cout << "Steps:   " << simFrame - startFrame << '\n'
+              << "Sim time: " << simSeconds - startSeconds << " s\n"
+              << "Wall time: " << wallSeconds << " s\n"
+              << "Steps/sec: " << (simFrame - startFrame) / wallSeconds << '\n'
+              << "Sim-seconds per wall-second: " << (simSeconds - startSeconds) / wallSeconds << '\n';
+    if (trackEnergy) {
+        std::cout << "Energy drift: " << std::abs((totalEnergy(bodies) - startEnergy) / startEnergy) << '\n';
+    }
+    std::cout << "Bodies left: " << bodies.size() << '\n'
+              << "Last step collision pairs: " << collisionStats.candidatePairs << " tested, "
+              << collisionStats.collisions << " hit in "
+              << collisionStats.islands << " islands (largest " << collisionStats.largestIsland << " pairs)\n"
+              << "Collisions: " << totalCollisions << " (" << totalSwept << " caught mid-step)\n";
+
+    if (integrator == Integrator::BlockLeapfrog) {
+        std::cout << "Last step levels:";
+        for (int level = 0; level < kStepLevels; ++level) {
+            if (timestepStats.bodiesAtLevel[level] == 0) continue;
+            std::cout << ' ' << level << ':' << timestepStats.bodiesAtLevel[level];
+        }
+        std::cout << " (" << timestepStats.substeps << " substeps, "
+                  << timestepStats.forceEvaluations << " body force evaluations)\n";
+    }
+
+    if (trajectoryWriter.enabled()) {
+        trajectoryWriter.stop(); // drains whatever is still queued
+        TrajectoryStats trajectory = trajectoryWriter.stats();
+        std::cout << "Trajectory frames: " << trajectory.framesWritten << " written, "
+                  << trajectory.framesDropped << " dropped\n"
+                  << "Trajectory bytes/frame: " << trajectory.averageFrameBytes << " (last "
+                  << trajectory.lastFrameBytes << ")\n"
+                  << "Trajectory writer: " << trajectory.writerMBPerSecond << " MB/s\n";
+        if (trajectory.failed) std::cout << "Trajectory recording stopped after a failed write\n";
+    }
+
+    checkpointer.stop();
+    if (checkpointer.written() > 0) {
+        std::cout << "Checkpoints written: " << checkpointer.written()
+                  << " (last took " << checkpointer.lastWriteSeconds() * 1000.0 << " ms)\n";
+    }
+
+    if (!tracePath.empty()) {
+        if (!kProfilerEnabled) {
+            std::cerr << "--trace: the profiler was compiled out (built with PROFILE=0)\n";
+        } else {
+            std::cout << "Phase ms over the last " << Profiler::kHistory << " samples (min / avg / p99):\n"
+                      << std::fixed << std::setprecision(3);
+            for (size_t p = 0; p < kProfilePhaseCount; ++p) {
+                ProfilePhase phase = static_cast<ProfilePhase>(p);
+                ProfileStats stats = profiler.stats(phase);
+                if (stats.samples == 0) continue;
+                std::cout << "  " << std::left << std::setw(12) << profilePhaseName(phase) << std::right
+                          << std::setw(10) << stats.minMs << std::setw(10) << stats.avgMs
+                          << std::setw(10) << stats.p99Ms << '\n';
+            }
+            std::cout << std::defaultfloat << std::setprecision(6);
+            try {
+                size_t events = profiler.writeChromeTrace(tracePath);
+                std::cout << "Wrote " << events << " trace events to " << tracePath << '\n';
+            } catch (const std::exception& e) {
+                std::cerr << "Trace export failed: " << e.what() << '\n';
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    if (!savePath.empty()) {
+        try {
+            auto saveStart = std::chrono::steady_clock::now();
+            writeSnapshot(savePath, bodies, simFrame, simSeconds);
+            std::cout << "Saved " << bodies.size() << " bodies to " << savePath << " in "
+                      << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - saveStart).count()
+                      << " ms\n";
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to save snapshot: " << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,869 @@
+// Microbenchmarks for the hot kernels, each timed on its own over a range of body counts.
+// Every case is repeated until its mean settles (or its time budget runs out) and the
+// results go to stdout as one JSON document, so runs can be diffed between commits.
+// Progress goes to stderr. Links only against libsolarsim_core.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bodyinstances.h"
+#include "bodysystem.h"
+#include "broadphase.h"
+#include "gravity.h"
+#include "gravitykernel.h"
+#include "mass.h"
+#include "physicsthread.h"
+#include "simglobals.h"
+#include "spatialindex.h"
+#include "textformat.h"
+
+#ifdef SOLARSIM_BENCH_TEXT
+#include "textmesh.h"
+#endif
+
+using namespace SolarSim;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::vector<size_t> sizes = {256, 1024, 4096, 16384, 65536};
+    std::string filter;          // only run kernels whose name contains this
+    double minSampleSeconds = 0.01;
+    double maxCaseSeconds = 2.0; // give up on stability after this much timing per case
+    double targetRse = 0.01;     // relative standard error of the mean to stop at
+    int minSamples = 5;
+    int maxSamples = 100;
+};
+
+// O(N²) kernels stop here so a full run stays in the minutes
+constexpr size_t kMaxPairwiseBodies = 8192;
+
+// --verify: body counts with every remainder the vector tails can leave, and the per-pair
+// error bound gravitykernel.h documents for the vector paths
+const size_t kVerifySizes[] = {1, 2, 3, 5, 8, 17, 255, 1001, 4099};
+constexpr double kKernelTolerance = 1e-13;
+// --verify: what gravity.h promises for Barnes-Hut at theta = 0 against the direct sum
+constexpr double kBarnesHutTolerance = 1e-12;
+
+struct Result {
+    std::string kernel;
+    size_t n = 0;
+    double items = 0.0; // work units per call (pairs, bodies, merges...), for ns_per_item
+    const char* unit = "";
+    int samples = 0;
+    long long iterations = 0; // calls per sample
+    double meanNs = 0.0;
+    double medianNs = 0.0;
+    double minNs = 0.0;
+    double stddevNs = 0.0;
+    double rse = 0.0;
+    bool stable = false;
+};
+
+// One timed case. `run` is the code under test. Kernels that change their input in a way
+// that changes the next call's work (merges, collision pushes) also get a `reset`, which
+// puts the input back untimed before every call; those calls are timed one by one.
+struct Kernel {
+    std::function<void()> run;
+    std::function<void()> reset;
+};
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Runs `iterations` calls and returns the seconds spent inside run()
+double timeSample(const Kernel& kernel, long long iterations) {
+    if (!kernel.reset) {
+        auto start = Clock::now();
+        for (long long k = 0; k < iterations; ++k) kernel.run();
+        return secondsSince(start);
+    }
+
+    double total = 0.0;
+    for (long long k = 0; k < iterations; ++k) {
+        kernel.reset();
+        auto start = Clock::now();
+        kernel.run();
+        total += secondsSince(start);
+    }
+    return total;
+}
+
+Result measure(const Options& options, const std::string& name, size_t n, double items, const char* unit,
+               const Kernel& kernel) {
+    Result result;
+    result.kernel = name;
+    result.n = n;
+    result.items = items;
+    result.unit = unit;
+
+    // Warm caches and lazily grown scratch, then double the batch until one sample is long
+    // enough for the clock to resolve it
+    timeSample(kernel, 1);
+    long long iterations = 1;
+    while (timeSample(kernel, iterations) < options.minSampleSeconds && iterations < (1LL << 30)) {
+        iterations *= 2;
+    }
+
+    std::vector<double> perCall;
+    double sum = 0.0;
+    double sumSquares = 0.0;
+    auto caseStart = Clock::now();
+
+    while (static_cast<int>(perCall.size()) < options.maxSamples) {
+        double ns = timeSample(kernel, iterations) * 1e9 / static_cast<double>(iterations);
+        perCall.push_back(ns);
+        sum += ns;
+        sumSquares += ns * ns;
+
+        const double k = static_cast<double>(perCall.size());
+        const double mean = sum / k;
+        const double variance = k > 1.0 ? std::max(0.0, (sumSquares - k * mean * mean) / (k - 1.0)) : 0.0;
+        result.meanNs = mean;
+        result.stddevNs = std::sqrt(variance);
+        result.rse = mean > 0.0 ? result.stddevNs / std::sqrt(k) / mean : 0.0;
+
+        if (static_cast<int>(perCall.size()) >= options.minSamples) {
+            if (result.rse <= options.targetRse) break;
+            if (secondsSince(caseStart) > options.maxCaseSeconds) break;
+        }
+    }
+
+    std::sort(perCall.begin(), perCall.end());
+    const size_t k = perCall.size();
+    result.samples = static_cast<int>(k);
+    result.iterations = iterations;
+    result.minNs = perCall.front();
+    result.medianNs = k % 2 ? perCall[k / 2] : 0.5 * (perCall[k / 2 - 1] + perCall[k / 2]);
+    result.stable = result.rse <= options.targetRse;
+    return result;
+}
+
+// Moon-sized bodies scattered over a square sized so each one overlaps about half a
+// neighbour on average, moving at up to 1 km/s in random directions. Dense enough that
+// the collision kernels have real work, sparse enough that gravity stays well behaved.
+void makeBenchBodies(BodySystem& bodies, size_t n, uint32_t seed) {
+    constexpr double kRadius = 1.7374e6;
+    constexpr float kMass = 7.34767309e22f;
+    const double side = 2.0 * kRadius * std::sqrt(M_PI * static_cast<double>(n) / 0.5);
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> position(-0.5 * side, 0.5 * side);
+    std::uniform_real_distribution<double> velocity(-1000.0, 1000.0);
+    std::uniform_real_distribution<float> color(0.3f, 1.0f);
+
+    bodies.clear();
+    bodies.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        Mass m;
+        m.mass = kMass;
+        m.radius = static_cast<float>(kRadius);
+        m.x = position(rng);
+        m.y = position(rng);
+        m.vx = velocity(rng);
+        m.vy = velocity(rng);
+        m.r = color(rng);
+        m.g = color(rng);
+        m.b = color(rng);
+        bodies.add(m);
+    }
+}
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "  --sizes A,B,...    body counts to run every kernel at (default 256,1024,4096,16384,65536;\n"
+              << "                     pairwise kernels stop at " << kMaxPairwiseBodies << ")\n"
+              << "  --filter TEXT      only run kernels whose name contains TEXT\n"
+              << "  --threads N        worker threads for the kernels that use the pool (default 1)\n"
+              << "  --min-time S       shortest timed sample in seconds (default 0.01)\n"
+              << "  --max-time S       timing budget per case before giving up on stability (default 2)\n"
+              << "  --rse X            stop once the mean's relative standard error is below X (default 0.01)\n"
+              << "  --quick            sizes 256,4096, max-time 0.5, rse 0.03\n"
+              << "  --out FILE         write the JSON to FILE instead of stdout\n"
+              << "  --verify           instead of timing, check the direct kernel at every SIMD level against\n"
+              << "                     the scalar Mass::calcAcceleration sum, and Barnes-Hut at theta 0 against\n"
+              << "                     the direct sum; exits non-zero on a mismatch\n";
+}
+
+bool parseSizes(const char* text, std::vector<size_t>& sizes) {
+    sizes.clear();
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        long long value = std::atoll(item.c_str());
+        if (value <= 0) return false;
+        sizes.push_back(static_cast<size_t>(value));
+    }
+    return !sizes.empty();
+}
+
+class Suite {
+public:
+    explicit Suite(const Options& options) : options(options) {}
+
+    bool wants(const std::string& name) const {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    }
+
+    void add(const std::string& name, size_t n, double items, const char* unit, const Kernel& kernel) {
+        std::cerr << std::left << std::setw(28) << name << std::right << std::setw(8) << n << std::flush;
+        Result result = measure(options, name, n, items, unit, kernel);
+        std::cerr << std::setw(14) << std::fixed << std::setprecision(1) << result.medianNs << " ns"
+                  << std::setw(10) << std::setprecision(3) << result.medianNs / std::max(1.0, result.items)
+                  << " ns/" << unit << "  (" << result.samples << " x " << result.iterations
+                  << ", rse " << std::setprecision(2) << result.rse * 100.0 << "%"
+                  << (result.stable ? "" : ", unstable") << ")\n"
+                  << std::defaultfloat;
+        results.push_back(result);
+    }
+
+    void writeJson(std::ostream& out) const {
+        out << "{\n"
+            << "  \"schema\": 1,\n"
+            << "  \"simd\": \"" << simdLevelName(detectSimdLevel()) << "\",\n"
+            << "  \"threads\": " << threadPool.size() << ",\n"
+            << "  \"compiler\": \"" << __VERSION__ << "\",\n"
+            << "  \"target_rse\": " << options.targetRse << ",\n"
+            << "  \"results\": [\n";
+        out << std::setprecision(6);
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            out << "    {\"kernel\": \"" << r.kernel << "\", \"n\": " << r.n
+                << ", \"items\": " << r.items << ", \"unit\": \"" << r.unit << "\""
+                << ", \"samples\": " << r.samples << ", \"iterations\": " << r.iterations
+                << ", \"median_ns\": " << r.medianNs << ", \"mean_ns\": " << r.meanNs
+                << ", \"min_ns\": " << r.minNs << ", \"stddev_ns\": " << r.stddevNs
+                << ", \"ns_per_item\": " << r.medianNs / std::max(1.0, r.items)
+                << ", \"rse\": " << r.rse << ", \"stable\": " << (r.stable ? "true" : "false") << "}"
+                << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        out << "  ]\n}\n";
+    }
+
+private:
+    const Options& options;
+    std::vector<Result> results;
+};
+
+// The original per-Mass loop: every body asks every other body for its pull one pair at a time
+void benchMassLoop(Suite& suite, const BodySystem& base, size_t n) {
+    if (!suite.wants("accel_mass_loop") || n > kMaxPairwiseBodies) return;
+
+    std::vector<Mass> masses;
+    masses.reserve(n);
+    for (size_t i = 0; i < n; ++i) masses.push_back(base.get(i));
+    std::vector<double> sumAx(n), sumAy(n);
+
+    Kernel kernel;
+    kernel.run = [&] {
+        for (size_t i = 0; i < n; ++i) {
+            double ax = 0.0, ay = 0.0;
+            for (size_t j = 0; j < n; ++j) {
+                if (i == j) continue;
+                masses[i].calcAcceleration(masses[j].mass, masses[j].x, masses[j].y);
+                ax += masses[i].ax;
+                ay += masses[i].ay;
+            }
+            sumAx[i] = ax;
+            sumAy[i] = ay;
+        }
+    };
+    suite.add("accel_mass_loop", n, static_cast<double>(n) * (n - 1), "pair", kernel);
+}
+
+const char* simdKernelSuffix(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Scalar: return "scalar";
+        case SimdLevel::SSE2: return "sse2";
+        case SimdLevel::AVX2: return "avx2";
+        case SimdLevel::AVX512: return "avx512";
+    }
+    return "unknown";
+}
+
+// The SoA direct-sum kernel at every instruction set this CPU can run, on one thread
+void benchDirectKernel(Suite& suite, const BodySystem& base, size_t n) {
+    if (n > kMaxPairwiseBodies) return;
+
+    std::vector<double> ax(n), ay(n);
+    const SimdLevel levels[] = {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512};
+    for (SimdLevel level : levels) {
+        if (static_cast<int>(level) > static_cast<int>(detectSimdLevel())) break;
+
+        const std::string name = std::string("accel_direct_") + simdKernelSuffix(level);
+        if (!suite.wants(name)) continue;
+
+        Kernel kernel;
+        kernel.run = [&, level] {
+            accumulateAccelerations(base.x.data(), base.y.data(), base.mass.data(), n, 0, n, ax.data(), ay.data(),
+                                    level);
+        };
+        suite.add(name, n, static_cast<double>(n) * (n - 1), "pair", kernel);
+    }
+}
+
+// Worst error of the direct kernel at `level` over every body of `bodies`, against the
+// per-Mass scalar sum. Each body's error is taken relative to the sum of the magnitudes
+// of the pulls on it: the per-pair bound carried over to the whole sum, and unlike the
+// net pull it doesn't shrink towards zero when pulls cancel.
+double directKernelError(const BodySystem& bodies, SimdLevel level) {
+    const size_t n = bodies.size();
+    std::vector<Mass> masses;
+    masses.reserve(n);
+    for (size_t i = 0; i < n; ++i) masses.push_back(bodies.get(i));
+
+    std::vector<double> ax(n), ay(n);
+    accumulateAccelerations(bodies.x.data(), bodies.y.data(), bodies.mass.data(), n, 0, n, ax.data(), ay.data(),
+                            level);
+
+    double worst = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        double sumAx = 0.0, sumAy = 0.0, scale = 0.0;
+        for (size_t j = 0; j < n; ++j) {
+            if (i == j) continue;
+            masses[i].calcAcceleration(masses[j].mass, masses[j].x, masses[j].y);
+            sumAx += masses[i].ax;
+            sumAy += masses[i].ay;
+            scale += std::hypot(masses[i].ax, masses[i].ay);
+        }
+        if (!std::isfinite(ax[i]) || !std::isfinite(ay[i])) return INFINITY;
+        if (scale > 0.0) worst = std::max(worst, std::hypot(ax[i] - sumAx, ay[i] - sumAy) / scale);
+    }
+    return worst;
+}
+
+// --verify: bench bodies with masses spread over six orders of magnitude
+void makeVerifyBodies(BodySystem& bodies, size_t n) {
+    makeBenchBodies(bodies, n, static_cast<uint32_t>(n));
+    std::mt19937 rng(static_cast<uint32_t>(n) + 1);
+    std::uniform_real_distribution<double> exponent(-3.0, 3.0);
+    for (float& mass : bodies.mass) mass *= static_cast<float>(std::pow(10.0, exponent(rng)));
+}
+
+// --verify: the direct kernel at every SIMD level this CPU runs.
+// Returns how many (level, size) cases failed.
+int verifyDirectKernel() {
+    const SimdLevel levels[] = {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512};
+    int failures = 0;
+    BodySystem bodies;
+
+    for (size_t n : kVerifySizes) {
+        makeVerifyBodies(bodies, n);
+
+        for (SimdLevel level : levels) {
+            const std::string name = std::string("accel_direct_") + simdKernelSuffix(level);
+            std::cerr << std::left << std::setw(28) << name << std::right << std::setw(8) << n;
+            if (static_cast<int>(level) > static_cast<int>(detectSimdLevel())) {
+                std::cerr << "  skipped, this CPU can't run it\n";
+                continue;
+            }
+
+            const double error = directKernelError(bodies, level);
+            const bool ok = error <= kKernelTolerance;
+            if (!ok) failures++;
+            std::cerr << std::setw(14) << std::scientific << std::setprecision(2) << error << " relative  "
+                      << (ok ? "ok" : "FAILED") << '\n'
+                      << std::defaultfloat;
+        }
+    }
+    return failures;
+}
+
+// Worst relative difference between Barnes-Hut at theta = 0 and computeAccelerations with the
+// direct solver, per body against the direct sum's net pull
+double barnesHutError(const BodySystem& bodies) {
+    BodySystem direct = bodies;
+    BodySystem tree = bodies;
+    const ForceSolver previous = forceSolver;
+    forceSolver = ForceSolver::Direct;
+    computeAccelerations(direct);
+    forceSolver = previous;
+    computeAccelerationsBarnesHut(tree, 0.0);
+
+    double worst = 0.0;
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        if (!std::isfinite(tree.ax[i]) || !std::isfinite(tree.ay[i])) return INFINITY;
+        const double scale = std::hypot(direct.ax[i], direct.ay[i]);
+        const double error = std::hypot(tree.ax[i] - direct.ax[i], tree.ay[i] - direct.ay[i]);
+        if (scale > 0.0) worst = std::max(worst, error / scale);
+    }
+    return worst;
+}
+
+// --verify: Barnes-Hut with every cell opened, on the same bodies as verifyDirectKernel.
+// Returns how many sizes failed.
+int verifyBarnesHut() {
+    int failures = 0;
+    BodySystem bodies;
+
+    for (size_t n : kVerifySizes) {
+        makeVerifyBodies(bodies, n);
+
+        std::cerr << std::left << std::setw(28) << "accel_barnes_hut_theta0" << std::right << std::setw(8) << n;
+        const double error = barnesHutError(bodies);
+        const bool ok = error <= kBarnesHutTolerance;
+        if (!ok) failures++;
+        std::cerr << std::setw(14) << std::scientific << std::setprecision(2) << error << " relative  "
+                  << (ok ? "ok" : "FAILED") << '\n'
+                  << std::defaultfloat;
+    }
+    return failures;
+}
+
+void benchBarnesHut(Suite& suite, BodySystem& bodies, size_t n) {
+    if (!suite.wants("accel_barnes_hut")) return;
+
+    Kernel kernel;
+    kernel.run = [&] { computeAccelerationsBarnesHut(bodies, barnesHutTheta); };
+    suite.add("accel_barnes_hut", n, static_cast<double>(n), "body", kernel);
+}
+
+// Default grid, with and without the short-range pass
+void benchParticleMesh(Suite& suite, BodySystem& bodies, size_t n) {
+    for (bool shortRange : {false, true}) {
+        const char* name = shortRange ? "accel_p3m" : "accel_particle_mesh";
+        if (!suite.wants(name)) continue;
+
+        Kernel kernel;
+        kernel.run = [&, shortRange] { computeAccelerationsParticleMesh(bodies, particleMeshGrid, shortRange); };
+        suite.add(name, n, static_cast<double>(n), "body", kernel);
+    }
+}
+
+// One semi-implicit Euler pass with the accelerations already in place, both the
+// SoA columns and the original Mass::calcVelocity / calcNewPos
+void benchIntegration(Suite& suite, BodySystem& bodies, size_t n) {
+    if (suite.wants("integrate_columns")) {
+        Kernel kernel;
+        kernel.run = [&] {
+            bodies.calcVelocities(timeStepMult);
+            bodies.calcNewPositions(timeStepMult);
+        };
+        suite.add("integrate_columns", n, static_cast<double>(n), "body", kernel);
+    }
+
+    if (suite.wants("integrate_mass_loop")) {
+        std::vector<Mass> masses;
+        masses.reserve(n);
+        for (size_t i = 0; i < n; ++i) masses.push_back(bodies.get(i));
+
+        Kernel kernel;
+        kernel.run = [&] {
+            for (Mass& m : masses) {
+                m.calcVelocity();
+                m.calcNewPos();
+            }
+        };
+        suite.add("integrate_mass_loop", n, static_cast<double>(n), "body", kernel);
+    }
+}
+
+void benchCollisions(Suite& suite, const BodySystem& base, size_t n) {
+    SweepAndPrune sweep;
+    std::vector<BodyPair> pairs;
+    sweep.findCandidates(base, pairs);
+
+    if (suite.wants("collision_broadphase")) {
+        Kernel kernel;
+        kernel.run = [&] { sweep.findCandidates(base, pairs); };
+        suite.add("collision_broadphase", n, static_cast<double>(n), "body", kernel);
+    }
+
+    // The same pairs out of the spatial index (BroadPhase::AabbTree)
+    if (suite.wants("collision_broadphase_tree")) {
+        SpatialIndex index;
+        std::vector<BodyPair> treePairs;
+        index.update(base, 0.0);
+        Kernel kernel;
+        kernel.run = [&] { index.findPairs(treePairs); };
+        suite.add("collision_broadphase_tree", n, static_cast<double>(n), "body", kernel);
+    }
+
+    // Exact test plus bounce over the broad phase's candidates, as stepSimulation does it.
+    // Bouncing pushes bodies apart, so every call starts again from the same overlaps.
+    if (suite.wants("collision_resolve")) {
+        BodySystem bodies = base;
+        Kernel kernel;
+        kernel.reset = [&] {
+            bodies.x = base.x;
+            bodies.y = base.y;
+            bodies.vx = base.vx;
+            bodies.vy = base.vy;
+        };
+        kernel.run = [&] {
+            for (const BodyPair& pair : pairs) {
+                if (checkCollision(bodies, pair.first, pair.second)) {
+                    resolveCollision(bodies, pair.first, pair.second);
+                }
+            }
+        };
+        suite.add("collision_resolve", n, static_cast<double>(std::max<size_t>(1, pairs.size())), "pair", kernel);
+    }
+
+    // The all-pairs checkCollision sweep the broad phase replaced
+    if (suite.wants("collision_all_pairs") && n <= kMaxPairwiseBodies) {
+        size_t hits = 0;
+        Kernel kernel;
+        kernel.run = [&] {
+            hits = 0;
+            for (size_t i = 0; i < n; ++i) {
+                for (size_t j = i + 1; j < n; ++j) {
+                    if (checkCollision(base, i, j)) hits++;
+                }
+            }
+        };
+        suite.add("collision_all_pairs", n, static_cast<double>(n) * (n - 1) / 2, "pair", kernel);
+    }
+}
+
+// Building the spatial index from nothing, refreshing it after every body has moved a
+// little, and the queries it answers, each at every body's centre in turn
+void benchSpatialIndex(Suite& suite, const BodySystem& base, size_t n) {
+    SpatialIndex index;
+
+    if (suite.wants("spatial_build")) {
+        Kernel kernel;
+        kernel.run = [&] {
+            index.clear();
+            index.update(base, 0.0);
+        };
+        suite.add("spatial_build", n, static_cast<double>(n), "body", kernel);
+    }
+
+    // Alternates between two layouts a tenth of a radius apart, so the padding absorbs
+    // the motion and this times the check every body gets rather than re-insertion
+    if (suite.wants("spatial_update")) {
+        BodySystem moved = base;
+        for (size_t i = 0; i < n; ++i) moved.x[i] += 0.1 * moved.radius[i];
+        index.clear();
+        index.update(base, 0.0);
+        bool flip = false;
+        Kernel kernel;
+        kernel.run = [&] {
+            flip = !flip;
+            index.update(flip ? moved : base, 0.0);
+        };
+        suite.add("spatial_update", n, static_cast<double>(n), "body", kernel);
+    }
+
+    index.clear();
+    index.update(base, 0.0);
+    size_t next = 0;
+    uint64_t found = 0; // hits, read after each pick case so the loops can't be dropped
+    std::vector<uint32_t> out;
+
+    // Every pick lands on a body's centre, so all of them should hit something
+    if (suite.wants("spatial_pick")) {
+        Kernel kernel;
+        kernel.run = [&] {
+            for (size_t k = 0; k < 256; ++k, next = (next + 1) % n) found += index.pick(base.x[next], base.y[next]) >= 0;
+        };
+        found = 0;
+        suite.add("spatial_pick", n, 256.0, "query", kernel);
+        if (found == 0) std::cerr << "spatial_pick: no pick hit a body\n";
+    }
+
+    if (suite.wants("spatial_nearest")) {
+        Kernel kernel;
+        kernel.run = [&] {
+            for (size_t k = 0; k < 256; ++k, next = (next + 1) % n) index.nearest(base.x[next], base.y[next], 8, out);
+        };
+        suite.add("spatial_nearest", n, 256.0, "query", kernel);
+    }
+
+    // The old way to pick: every body's distance to the point
+    if (suite.wants("spatial_pick_scan")) {
+        Kernel kernel;
+        kernel.run = [&] {
+            const double x = base.x[next];
+            const double y = base.y[next];
+            next = (next + 1) % n;
+            for (size_t i = 0; i < n; ++i) {
+                const double dist = std::sqrt(std::pow(x - base.x[i], 2) + std::pow(y - base.y[i], 2));
+                if (dist <= base.radius[i]) found++;
+            }
+        };
+        found = 0;
+        suite.add("spatial_pick_scan", n, 1.0, "query", kernel);
+        if (found == 0) std::cerr << "spatial_pick_scan: no pick hit a body\n";
+    }
+}
+
+// Merges bodies 2k and 2k+1 for every k, then the removal pass that drops the merged-away half
+// (and the same pass with only one body in 1024 merged away)
+void benchMerges(Suite& suite, const BodySystem& base, size_t n) {
+    BodySystem bodies = base;
+
+    if (suite.wants("merge_masses")) {
+        Kernel kernel;
+        kernel.reset = [&] {
+            bodies.vx = base.vx;
+            bodies.vy = base.vy;
+            bodies.mass = base.mass;
+            bodies.radius = base.radius;
+        };
+        kernel.run = [&] {
+            for (size_t i = 0; i + 1 < n; i += 2) mergeMasses(bodies, i, i + 1);
+        };
+        suite.add("merge_masses", n, static_cast<double>(n / 2), "merge", kernel);
+    }
+
+    if (suite.wants("remove_dead")) {
+        BodySystem merged = base;
+        for (size_t i = 0; i + 1 < n; i += 2) mergeMasses(merged, i, i + 1);
+
+        Kernel kernel;
+        kernel.reset = [&] { bodies = merged; };
+        kernel.run = [&] { bodies.removeDead(); };
+        suite.add("remove_dead", n, static_cast<double>(n), "body", kernel);
+    }
+
+    // The usual case while running: a merge or two among many live bodies
+    if (suite.wants("remove_dead_few")) {
+        BodySystem merged = base;
+        for (size_t i = 0; i + 1 < n; i += 1024) mergeMasses(merged, i, i + 1);
+
+        Kernel kernel;
+        kernel.reset = [&] { bodies = merged; };
+        kernel.run = [&] { bodies.removeDead(); };
+        suite.add("remove_dead_few", n, static_cast<double>(n), "body", kernel);
+    }
+}
+
+// Building the body draw list (culling, tessellation level, sub-pixel splatting) from two
+// snapshots for a 1000x1000 window, at three zooms: the whole field filling the window,
+// the whole field shrunk to an eighth of it (mostly points), and zoomed 8x into the middle
+// (mostly culled)
+void benchDrawList(Suite& suite, const BodySystem& base, size_t n) {
+    struct Zoom {
+        const char* name;
+        double fieldsPerWindow;
+    };
+    const Zoom zooms[] = {{"draw_list_fit", 1.0}, {"draw_list_far", 8.0}, {"draw_list_near", 1.0 / 8.0}};
+
+    bool any = false;
+    for (const Zoom& zoom : zooms) any = any || suite.wants(zoom.name);
+    if (!any) return;
+
+    RenderSnapshot snapshot;
+    snapshot.x = base.x;
+    snapshot.y = base.y;
+    snapshot.radius = base.radius;
+    snapshot.r.resize(n);
+    snapshot.g.resize(n);
+    snapshot.b.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        snapshot.r[i] = base.info[i].r;
+        snapshot.g[i] = base.info[i].g;
+        snapshot.b[i] = base.info[i].b;
+    }
+
+    // Two snapshots seen, so position() takes the blending path like it does while running
+    SnapshotInterpolator interpolator;
+    interpolator.advance(snapshot, true);
+    interpolator.advance(snapshot, true);
+
+    double side = 0.0;
+    for (size_t i = 0; i < n; ++i) side = std::max(side, 2.0 * std::max(std::abs(base.x[i]), std::abs(base.y[i])));
+
+    BodyDrawList drawList;
+    for (const Zoom& zoom : zooms) {
+        if (!suite.wants(zoom.name)) continue;
+        const BodyView view{0.0, 0.0, 2.0 / (side * zoom.fieldsPerWindow), 1000, 1000};
+        Kernel kernel;
+        kernel.run = [&] { drawList.build(snapshot, interpolator, 0.5, view, threadPool); };
+        suite.add(zoom.name, n, static_cast<double>(n), "body", kernel);
+    }
+}
+
+// The HUD's clock and counters line, built with a stream the way main() used to and
+// appended in place the way it does now
+void benchHudFormat(Suite& suite) {
+    const double seconds = 12.0 * 86400.0 + 3.0 * 3600.0 + 4.0 * 60.0 + 5.0;
+    const long long tested = 1234;
+    const long long hit = 5;
+
+    if (suite.wants("hud_format_stream")) {
+        std::string text;
+        Kernel kernel;
+        kernel.run = [&] {
+            long long total = static_cast<long long>(seconds);
+            std::ostringstream stream;
+            stream << "Sim Time: " << total / 86400 << "d " << std::setfill('0') << std::setw(2)
+                   << (total % 86400) / 3600 << "h " << std::setw(2) << (total % 3600) / 60 << "m "
+                   << std::setw(2) << total % 60 << "s" << "\nCollision pairs: " << tested << " tested, "
+                   << hit << " hit";
+            text = stream.str();
+        };
+        suite.add("hud_format_stream", 1, 1.0, "line", kernel);
+    }
+
+    if (suite.wants("hud_format_append")) {
+        std::string text;
+        Kernel kernel;
+        kernel.run = [&] {
+            text.clear();
+            text += "Sim Time: ";
+            appendSimTime(text, seconds);
+            text += "\nCollision pairs: ";
+            appendInt(text, tested);
+            text += " tested, ";
+            appendInt(text, hit);
+            text += " hit";
+        };
+        suite.add("hud_format_append", 1, 1.0, "line", kernel);
+    }
+}
+
+#ifdef SOLARSIM_BENCH_TEXT
+// HUD-shaped text, n characters long
+void benchTextMesh(Suite& suite) {
+    if (suite.wants("text_mesh")) {
+        const std::string line = "Time: 12y 143d 07:42:19  Collisions: 3  Bodies: 65536\n";
+        std::vector<unsigned char> scratch;
+        std::vector<float> vertices;
+
+        for (size_t length : {16, 64, 256, 1024}) {
+            std::string text;
+            while (text.size() < length) text += line;
+            text.resize(length);
+
+            Kernel kernel;
+            kernel.run = [&] { buildTextMesh(text, 2.0f, 10.0f, 10.0f, scratch, vertices); };
+            suite.add("text_mesh", length, static_cast<double>(length), "char", kernel);
+        }
+    }
+
+    // A line the overlay has already laid out once, the common case every frame
+    if (suite.wants("text_layout_cached")) {
+        TextLayoutCache cache;
+        const std::string clock = "Sim Time: 12d 03h 04m 05s";
+        cache.layout(clock, 2.6f);
+
+        Kernel kernel;
+        kernel.run = [&] { cache.layout(clock, 2.6f); };
+        suite.add("text_layout_cached", clock.size(), static_cast<double>(clock.size()), "char", kernel);
+    }
+}
+#endif
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    std::string outPath;
+    unsigned threads = 1;
+    bool verify = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (std::strcmp(arg, "--sizes") == 0 && hasValue) {
+            if (!parseSizes(argv[++i], options.sizes)) {
+                std::cerr << "Bad --sizes list: " << argv[i] << '\n';
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(arg, "--filter") == 0 && hasValue) {
+            options.filter = argv[++i];
+        } else if (std::strcmp(arg, "--threads") == 0 && hasValue) {
+            threads = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+        } else if (std::strcmp(arg, "--min-time") == 0 && hasValue) {
+            options.minSampleSeconds = std::atof(argv[++i]);
+        } else if (std::strcmp(arg, "--max-time") == 0 && hasValue) {
+            options.maxCaseSeconds = std::atof(argv[++i]);
+        } else if (std::strcmp(arg, "--rse") == 0 && hasValue) {
+            options.targetRse = std::atof(argv[++i]);
+        } else if (std::strcmp(arg, "--quick") == 0) {
+            options.sizes = {256, 4096};
+            options.maxCaseSeconds = 0.5;
+            options.targetRse = 0.03;
+        } else if (std::strcmp(arg, "--out") == 0 && hasValue) {
+            outPath = argv[++i];
+        } else if (std::strcmp(arg, "--verify") == 0) {
+            verify = true;
+        } else if (std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0) {
+            printUsage(argv[0]);
+            return EXIT_SUCCESS;
+        } else {
+            std::cerr << "Unknown option: " << arg << '\n';
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // One thread by default so numbers compare across machines; the pool only
+    // matters for Barnes-Hut, everything else here is single threaded anyway
+    threadPool.resize(threads);
+
+    if (verify) {
+        std::cerr << "Checking the direct kernel against Mass::calcAcceleration, tolerance " << kKernelTolerance
+                  << '\n';
+        int failures = verifyDirectKernel();
+        std::cerr << "Checking Barnes-Hut at theta = 0 against the direct sum, tolerance " << kBarnesHutTolerance
+                  << '\n';
+        failures += verifyBarnesHut();
+        std::cerr << (failures ? std::to_string(failures) + " case(s) FAILED" : std::string("All cases ok")) << '\n';
+        return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    std::cerr << "SolarSim kernel benchmarks, " << simdLevelName(detectSimdLevel()) << ", "
+              << threadPool.size() << " thread(s)\n";
+
+    Suite suite(options);
+    BodySystem base;
+    BodySystem bodies;
+
+    for (size_t n : options.sizes) {
+        makeBenchBodies(base, n, 1);
+
+        benchMassLoop(suite, base, n);
+        benchDirectKernel(suite, base, n);
+
+        bodies = base;
+        benchBarnesHut(suite, bodies, n);
+        benchParticleMesh(suite, bodies, n);
+
+        // Real accelerations for the integration pass to apply
+        bodies = base;
+        computeAccelerationsBarnesHut(bodies, barnesHutTheta);
+        benchIntegration(suite, bodies, n);
+
+        benchCollisions(suite, base, n);
+        benchSpatialIndex(suite, base, n);
+        benchMerges(suite, base, n);
+        benchDrawList(suite, base, n);
+    }
+
+    benchHudFormat(suite);
+#ifdef SOLARSIM_BENCH_TEXT
+    benchTextMesh(suite);
+#endif
+
+    if (outPath.empty()) {
+        suite.writeJson(std::cout);
+    } else {
+        std::ofstream out(outPath);
+        if (!out) {
+            std::cerr << "Can't write " << outPath << '\n';
+            return EXIT_FAILURE;
+        }
+        suite.writeJson(out);
+        std::cerr << "Wrote " << outPath << '\n';
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,131 @@
+#include "blocktimestep.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "bodysystem.h"
+#include "gravity.h"
+#include "simglobals.h"
+
+namespace SolarSim {
+
+namespace {
+
+// Accuracy knob in dt_i = eta * |a| / |da/dt|. 0.01 keeps the Earth-Moon orbit
+// on level 0 at 600 s while a moon skimming Earth drops 6-7 levels.
+constexpr double kEta = 0.01;
+
+// Bodies with no jerk estimate yet (just spawned) start on the finest level. Alignment
+// lets them climb one level per sync, so reaching a coarse level only takes ~12 substeps.
+constexpr int kStartLevel = kMaxStepLevel;
+
+constexpr size_t kDriftGrain = 4096;
+constexpr size_t kKickGrain = 256;
+
+constexpr uint32_t kTicksPerStep = 1u << kMaxStepLevel;
+
+uint32_t strideOf(int level) {
+    return 1u << (kMaxStepLevel - level);
+}
+
+// Level whose step is no longer than dtWanted
+int levelFor(double dtWanted, double dtMax) {
+    if (!(dtWanted < dtMax)) return 0; // also catches inf / nan from a zero jerk
+    int level = static_cast<int>(std::ceil(std::log2(dtMax / dtWanted)));
+    return std::clamp(level, 0, kMaxStepLevel);
+}
+
+} // namespace
+
+void BlockTimestepper::step(BodySystem& bodies, double dtMax) {
+    timestepStats = TimestepStats{};
+    const size_t n = bodies.size();
+    if (n == 0) return;
+
+    const double tick = dtMax / kTicksPerStep;
+
+    // Bodies added since last step have no forces or level yet
+    active.clear();
+    for (size_t i = 0; i < n; ++i) {
+        if (bodies.stepLevel[i] == BodySystem::kUnsetStepLevel) active.push_back(static_cast<uint32_t>(i));
+    }
+    if (!active.empty()) {
+        computeAccelerations(bodies, active);
+        for (uint32_t i : active) bodies.stepLevel[i] = kStartLevel;
+        timestepStats.forceEvaluations += active.size();
+    }
+
+    // Everyone is in sync here: opening half kick with each body's own step
+    threadPool.parallelFor(0, n, kDriftGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            double halfStep = 0.5 * tick * strideOf(bodies.stepLevel[i]);
+            bodies.vx[i] += bodies.ax[i] * halfStep;
+            bodies.vy[i] += bodies.ay[i] * halfStep;
+        }
+    });
+
+    uint32_t now = 0;
+    while (now < kTicksPerStep) {
+        // The finest body present decides when the next one is due
+        int finest = *std::max_element(bodies.stepLevel.begin(), bodies.stepLevel.end());
+        uint32_t advance = strideOf(finest);
+
+        threadPool.parallelFor(0, n, kDriftGrain, [&](size_t begin, size_t end) {
+            bodies.calcNewPositions(tick * advance, begin, end);
+        });
+        now += advance;
+
+        active.clear();
+        for (size_t i = 0; i < n; ++i) {
+            if (now % strideOf(bodies.stepLevel[i]) == 0) active.push_back(static_cast<uint32_t>(i));
+        }
+
+        previousAx.resize(active.size());
+        previousAy.resize(active.size());
+        for (size_t k = 0; k < active.size(); ++k) {
+            previousAx[k] = bodies.ax[active[k]];
+            previousAy[k] = bodies.ay[active[k]];
+        }
+
+        computeAccelerations(bodies, active);
+
+        threadPool.parallelFor(0, active.size(), kKickGrain, [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; ++k) {
+                const uint32_t i = active[k];
+                const int oldLevel = bodies.stepLevel[i];
+                const double oldStep = tick * strideOf(oldLevel);
+
+                // Closing half kick of the step that just ended
+                bodies.vx[i] += bodies.ax[i] * 0.5 * oldStep;
+                bodies.vy[i] += bodies.ay[i] * 0.5 * oldStep;
+
+                // Pick the next step from how fast the acceleration is changing
+                double jerkX = (bodies.ax[i] - previousAx[k]) / oldStep;
+                double jerkY = (bodies.ay[i] - previousAy[k]) / oldStep;
+                double accel = std::sqrt(bodies.ax[i] * bodies.ax[i] + bodies.ay[i] * bodies.ay[i]);
+                double jerk = std::sqrt(jerkX * jerkX + jerkY * jerkY);
+                int level = levelFor(kEta * accel / jerk, dtMax);
+
+                // Coarser steps have to start on their own boundary
+                while (level < oldLevel && now % strideOf(level) != 0) ++level;
+                bodies.stepLevel[i] = static_cast<uint8_t>(level);
+
+                // Opening half kick of the next step (the next outer step does this at the end)
+                if (now < kTicksPerStep) {
+                    double halfStep = 0.5 * tick * strideOf(level);
+                    bodies.vx[i] += bodies.ax[i] * halfStep;
+                    bodies.vy[i] += bodies.ay[i] * halfStep;
+                }
+            }
+        });
+
+        timestepStats.substeps++;
+        timestepStats.forceEvaluations += active.size();
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        timestepStats.bodiesAtLevel[bodies.stepLevel[i]]++;
+    }
+}
+
+} // namespace SolarSim
@@ -0,0 +1,262 @@
+#include "bodyinstances.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iterator>
+
+#include "physicsthread.h"
+#include "threadpool.h"
+
+namespace SolarSim {
+
+namespace {
+
+// Opacity one sub-pixel body gives its pixel; n of them together give 1 - (1 - a)^n,
+// so a dense clump reads brighter than a lone speck. Past kPointAlphaSteps bodies the
+// pixel is as good as opaque.
+constexpr float kPointAlpha = 0.6f;
+constexpr uint32_t kPointAlphaSteps = 16;
+
+// Bodies per slice of pass 1, and per batch of interpolated positions inside a slice
+constexpr size_t kSliceBodies = 1 << 15;
+constexpr size_t kBatchBodies = 512;
+
+// Sub-pixel bodies are binned into square tiles this many pixels across; one tile's sums
+// (64 KB) stay in cache while its bodies are added up
+constexpr uint32_t kTilePixels = 64;
+constexpr size_t kTileGrain = 8;
+
+// Up to this many occupied tiles (1 MB of sums) the splats are summed without binning
+constexpr size_t kUnbinnedTiles = 16;
+
+float pointAlpha(uint32_t count) {
+    static const auto table = [] {
+        std::array<float, kPointAlphaSteps + 1> alpha{};
+        float transparency = 1.0f;
+        for (uint32_t k = 0; k <= kPointAlphaSteps; ++k) {
+            alpha[k] = 1.0f - transparency;
+            transparency *= 1.0f - kPointAlpha;
+        }
+        return alpha;
+    }();
+    return table[count < kPointAlphaSteps ? count : kPointAlphaSteps];
+}
+
+int lodForRadius(double pixels) {
+    int lod = 0;
+    while (lod < kBodyLodLevels - 1 && pixels >= kBodyLodMaxRadius[lod]) ++lod;
+    return lod;
+}
+
+} // namespace
+
+void BodyDrawList::build(const RenderSnapshot& snapshot, const SnapshotInterpolator& interpolator, double blend,
+                         const BodyView& view, ThreadPool& pool) {
+    const size_t n = snapshot.size();
+    stats = BodyDrawStats{};
+    stats.bodies = n;
+
+    if (view.width != gridWidth || view.height != gridHeight) {
+        gridWidth = view.width;
+        gridHeight = view.height;
+        tilesX = static_cast<int>((static_cast<uint32_t>(gridWidth) + kTilePixels - 1) / kTilePixels);
+        tilesY = static_cast<int>((static_cast<uint32_t>(gridHeight) + kTilePixels - 1) / kTilePixels);
+        pixels.assign(static_cast<size_t>(gridWidth) * static_cast<size_t>(gridHeight), PixelSum{});
+    }
+    const size_t tiles = static_cast<size_t>(tilesX) * static_cast<size_t>(tilesY);
+    const size_t sliceCount = (n + kSliceBodies - 1) / kSliceBodies;
+    if (slices.size() < sliceCount) slices.resize(sliceCount);
+
+    // ndc = (world - cam) * scale, pixels = (ndc + 1) / 2 * width, (1 - ndc) / 2 * height.
+    // The shader uses the same scale on both axes, so a body's on-screen radius is the larger
+    // of its two pixel extents.
+    const double halfW = 0.5 * view.width;
+    const double halfH = 0.5 * view.height;
+    const double pixelsPerUnit = view.scale * (halfW > halfH ? halfW : halfH);
+    const double viewHalfExtent = 1.0 / view.scale; // world units from the camera to an edge
+
+    // Pass 1, per slice: cull, pick levels, and bin the sub-pixel bodies by tile
+    pool.parallelFor(0, sliceCount, 1, [&](size_t begin, size_t end) {
+        double x[kBatchBodies], y[kBatchBodies];
+        for (size_t s = begin; s < end; ++s) {
+            Slice& slice = slices[s];
+            const size_t sliceBegin = s * kSliceBodies;
+            const size_t sliceEnd = std::min(n, sliceBegin + kSliceBodies);
+            slice.visible.clear();
+            if (slice.splats.size() < sliceEnd - sliceBegin) slice.splats.resize(sliceEnd - sliceBegin);
+            Splat* splat = slice.splats.data();
+            slice.tileCount.assign(tiles, 0);
+            std::fill(std::begin(slice.lodCount), std::end(slice.lodCount), 0);
+            slice.culled = 0;
+
+            for (size_t batch = sliceBegin; batch < sliceEnd; batch += kBatchBodies) {
+                const size_t batchEnd = std::min(sliceEnd, batch + kBatchBodies);
+                interpolator.positions(snapshot, batch, batchEnd, blend, x, y);
+
+                for (size_t i = batch; i < batchEnd; ++i) {
+                    const double r = snapshot.radius[i];
+                    const double dx = x[i - batch] - view.camX;
+                    const double dy = y[i - batch] - view.camY;
+
+                    if (std::abs(dx) - r > viewHalfExtent || std::abs(dy) - r > viewHalfExtent) {
+                        ++slice.culled;
+                        continue;
+                    }
+
+                    const double radiusPixels = r * pixelsPerUnit;
+                    if (radiusPixels >= kPointRadiusPixels) {
+                        const int lod = lodForRadius(radiusPixels);
+                        ++slice.lodCount[lod];
+                        slice.visible.push_back(
+                            Visible{x[i - batch], y[i - batch], static_cast<uint32_t>(i), static_cast<uint8_t>(lod)});
+                        continue;
+                    }
+
+                    const double px = (dx * view.scale + 1.0) * halfW;
+                    const double py = (1.0 - dy * view.scale) * halfH;
+                    if (!(px >= 0.0 && px < view.width && py >= 0.0 && py < view.height)) {
+                        ++slice.culled; // centre is just past the edge and the body is smaller than a pixel
+                        continue;
+                    }
+
+                    const uint32_t column = static_cast<uint32_t>(px);
+                    const uint32_t row = static_cast<uint32_t>(py);
+                    ++slice.tileCount[(row / kTilePixels) * static_cast<uint32_t>(tilesX) + column / kTilePixels];
+                    *splat++ = Splat{row * static_cast<uint32_t>(gridWidth) + column, snapshot.r[i], snapshot.g[i],
+                                     snapshot.b[i]};
+                }
+            }
+            slice.splatCount = static_cast<size_t>(splat - slice.splats.data());
+        }
+    });
+
+    // Where every slice's circles and splats go, slices in body order so the result
+    // doesn't depend on which thread ran which slice
+    size_t lodCount[kBodyLodLevels] = {};
+    for (size_t s = 0; s < sliceCount; ++s) {
+        for (int l = 0; l < kBodyLodLevels; ++l) lodCount[l] += slices[s].lodCount[l];
+        stats.culled += slices[s].culled;
+        stats.splatted += slices[s].splatCount;
+    }
+    lodBegin[0] = 0;
+    for (int l = 0; l < kBodyLodLevels; ++l) lodBegin[l + 1] = lodBegin[l] + lodCount[l];
+    for (int l = 0; l < kBodyLodLevels; ++l) {
+        size_t cursor = lodBegin[l];
+        for (size_t s = 0; s < sliceCount; ++s) {
+            slices[s].lodCursor[l] = cursor;
+            cursor += slices[s].lodCount[l];
+        }
+    }
+
+    size_t occupiedTiles = 0;
+    tileBegin.assign(tiles + 1, 0);
+    for (size_t t = 0; t < tiles; ++t) {
+        size_t cursor = tileBegin[t];
+        for (size_t s = 0; s < sliceCount; ++s) {
+            const uint32_t count = slices[s].tileCount[t];
+            slices[s].tileCount[t] = static_cast<uint32_t>(cursor - tileBegin[t]);
+            cursor += count;
+        }
+        tileBegin[t + 1] = cursor;
+        if (cursor > tileBegin[t]) ++occupiedTiles;
+    }
+
+    // Zoomed far out, every splat lands in a few tiles whose sums fit in cache together:
+    // binning would only copy them around, so they're summed in body order instead
+    const bool binning = occupiedTiles > kUnbinnedTiles;
+
+    // Pass 2, per slice: circles into their level's bucket, splats into their tile's
+    instances.resize(lodBegin[kBodyLodLevels]);
+    if (binning) binned.resize(stats.splatted);
+    touched.resize(stats.splatted);
+    pool.parallelFor(0, sliceCount, 1, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; ++s) {
+            Slice& slice = slices[s];
+            for (const Visible& v : slice.visible) {
+                BodyInstance& instance = instances[slice.lodCursor[v.lod]++];
+                splitDouble(v.x, instance.posHigh[0], instance.posLow[0]);
+                splitDouble(v.y, instance.posHigh[1], instance.posLow[1]);
+                instance.radius = snapshot.radius[v.body];
+                instance.color[0] = snapshot.r[v.body];
+                instance.color[1] = snapshot.g[v.body];
+                instance.color[2] = snapshot.b[v.body];
+            }
+            if (!binning) continue;
+            for (size_t k = 0; k < slice.splatCount; ++k) {
+                const Splat& splat = slice.splats[k];
+                const uint32_t column = splat.pixel % static_cast<uint32_t>(gridWidth);
+                const uint32_t row = splat.pixel / static_cast<uint32_t>(gridWidth);
+                const size_t tile = (row / kTilePixels) * static_cast<size_t>(tilesX) + column / kTilePixels;
+                binned[tileBegin[tile] + slice.tileCount[tile]++] = splat;
+            }
+        }
+    });
+
+    // Sums splats into their pixels, appending each pixel to touched[hit++] the first time
+    auto accumulate = [&](const Splat* first, const Splat* last, size_t& hit) {
+        for (const Splat* splat = first; splat != last; ++splat) {
+            PixelSum& sum = pixels[splat->pixel];
+            if (sum.count == 0) touched[hit++] = splat->pixel;
+            sum.r += splat->r;
+            sum.g += splat->g;
+            sum.b += splat->b;
+            ++sum.count;
+        }
+    };
+
+    // Averages the pixels in touched[from, to) into out[0 .. to - from) and zeroes them
+    auto emit = [&](size_t from, size_t to, PointSprite* out) {
+        for (size_t k = from; k < to; ++k) {
+            const uint32_t pixel = touched[k];
+            PixelSum& sum = pixels[pixel];
+            const float inverse = 1.0f / static_cast<float>(sum.count);
+            PointSprite& p = out[k - from];
+            p.x = static_cast<float>(pixel % static_cast<uint32_t>(gridWidth));
+            p.y = static_cast<float>(pixel / static_cast<uint32_t>(gridWidth));
+            p.color[0] = sum.r * inverse;
+            p.color[1] = sum.g * inverse;
+            p.color[2] = sum.b * inverse;
+            p.color[3] = pointAlpha(sum.count);
+            sum = PixelSum{};
+        }
+    };
+
+    if (!binning) {
+        size_t hit = 0;
+        for (size_t s = 0; s < sliceCount; ++s) {
+            accumulate(slices[s].splats.data(), slices[s].splats.data() + slices[s].splatCount, hit);
+        }
+        points.resize(hit);
+        emit(0, hit, points.data());
+    } else {
+        // Pass 3, per tile: sum its splats, then turn the pixels they hit into points while
+        // those are still in cache
+        tilePoints.resize(stats.splatted);
+        pointBegin.assign(tiles + 1, 0);
+        pool.parallelFor(0, tiles, kTileGrain, [&](size_t begin, size_t end) {
+            for (size_t t = begin; t < end; ++t) {
+                size_t hit = tileBegin[t];
+                accumulate(binned.data() + tileBegin[t], binned.data() + tileBegin[t + 1], hit);
+                emit(tileBegin[t], hit, tilePoints.data() + tileBegin[t]);
+                pointBegin[t + 1] = hit - tileBegin[t];
+            }
+        });
+        for (size_t t = 0; t < tiles; ++t) pointBegin[t + 1] += pointBegin[t];
+
+        // Pass 4, per tile: close up the gaps between the tiles' points
+        points.resize(pointBegin[tiles]);
+        pool.parallelFor(0, tiles, kTileGrain, [&](size_t begin, size_t end) {
+            for (size_t t = begin; t < end; ++t) {
+                std::copy(tilePoints.begin() + tileBegin[t],
+                          tilePoints.begin() + tileBegin[t] + (pointBegin[t + 1] - pointBegin[t]),
+                          points.begin() + pointBegin[t]);
+            }
+        });
+    }
+
+    stats.instanced = instances.size();
+    stats.points = points.size();
+}
+
+} // namespace SolarSim
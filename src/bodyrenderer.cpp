@@ -0,0 +1,172 @@
+#include "bodyrenderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "globals.h"
+#include "physicsthread.h"
+
+namespace SolarSim {
+
+namespace {
+
+BodyDrawList drawList;
+size_t instanceCapacity = 0; // bodies the GPU-side buffer currently has room for
+size_t pointCapacity = 0;
+GLint lodFirstVertex[kBodyLodLevels] = {}; // where each tessellation starts in the mesh buffer
+
+// Points the instance attributes at `first` in the instance buffer. GL 3.3 has no base
+// instance, so each level's draw re-aims the pointers instead (bodyInstanceVBO bound).
+void setInstanceAttributes(size_t first) {
+    const GLsizei stride = sizeof(BodyInstance);
+    const size_t base = first * sizeof(BodyInstance);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(BodyInstance, posHigh)));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(BodyInstance, posLow)));
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(BodyInstance, radius)));
+    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(BodyInstance, color)));
+}
+
+// Grows `capacity` to fit `count` items when needed and orphans the bound buffer, so
+// the driver never waits on last frame's draw before the new data goes in
+void orphanAndUpload(size_t count, size_t itemBytes, const void* data, size_t& capacity) {
+    if (count > capacity) capacity = std::max(count, capacity * 2);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(capacity * itemBytes), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(count * itemBytes), data);
+}
+
+} // namespace
+
+void initBodyRenderer() {
+    // Every tessellation of the unit circle back to back, each a triangle fan:
+    // centre first, then the rim (last vertex closes the loop)
+    std::vector<float> circles;
+    for (int lod = 0; lod < kBodyLodLevels; ++lod) {
+        const int segments = kBodyLodSegments[lod];
+        lodFirstVertex[lod] = static_cast<GLint>(circles.size() / 2);
+        circles.push_back(0.0f);
+        circles.push_back(0.0f);
+        for (int i = 0; i <= segments; ++i) {
+            float angle = 2.0f * static_cast<float>(M_PI) * i / segments;
+            circles.push_back(std::cos(angle));
+            circles.push_back(std::sin(angle));
+        }
+    }
+
+    glGenVertexArrays(1, &bodyVAO);
+    glGenBuffers(1, &bodyMeshVBO);
+    glGenBuffers(1, &bodyInstanceVBO);
+    glBindVertexArray(bodyVAO);
+
+    // Attribute 0: the shared circles, advanced per vertex
+    glBindBuffer(GL_ARRAY_BUFFER, bodyMeshVBO);
+    glBufferData(GL_ARRAY_BUFFER, circles.size() * sizeof(float), circles.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    // Attributes 1-4: one BodyInstance per body, advanced per instance
+    glBindBuffer(GL_ARRAY_BUFFER, bodyInstanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_STREAM_DRAW);
+    setInstanceAttributes(0);
+    for (GLuint attrib = 1; attrib <= 4; ++attrib) {
+        glEnableVertexAttribArray(attrib);
+        glVertexAttribDivisor(attrib, 1);
+    }
+
+    // Sub-pixel bodies: one PointSprite per covered pixel
+    glGenVertexArrays(1, &pointVAO);
+    glGenBuffers(1, &pointVBO);
+    glBindVertexArray(pointVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, pointVBO);
+    glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_STREAM_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(PointSprite), (void*)offsetof(PointSprite, x));
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(PointSprite), (void*)offsetof(PointSprite, color));
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    instanceCapacity = 0;
+    pointCapacity = 0;
+
+    bodyCamHighUniform = glGetUniformLocation(shaderProgram, "uCamHigh");
+    bodyCamLowUniform = glGetUniformLocation(shaderProgram, "uCamLow");
+    bodyScaleUniform = glGetUniformLocation(shaderProgram, "uScale");
+}
+
+void shutdownBodyRenderer() {
+    glDeleteBuffers(1, &pointVBO);
+    glDeleteVertexArrays(1, &pointVAO);
+    glDeleteBuffers(1, &bodyInstanceVBO);
+    glDeleteBuffers(1, &bodyMeshVBO);
+    glDeleteVertexArrays(1, &bodyVAO);
+    pointVBO = pointVAO = 0;
+    bodyInstanceVBO = bodyMeshVBO = bodyVAO = 0;
+    instanceCapacity = 0;
+    pointCapacity = 0;
+}
+
+const BodyDrawStats& renderBodies(const RenderSnapshot& snapshot, const SnapshotInterpolator& interpolator,
+                                  double blend) {
+    int fbWidth = 0, fbHeight = 0;
+    glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+    if (snapshot.size() == 0 || fbWidth <= 0 || fbHeight <= 0) {
+        drawList.stats = BodyDrawStats{};
+        drawList.stats.bodies = snapshot.size();
+        return drawList.stats;
+    }
+
+    // Cull, pick a tessellation per body and splat the sub-pixel ones, on the render
+    // thread's own pool: the main one belongs to the physics thread and isn't safe to share
+    drawList.build(snapshot, interpolator, blend, BodyView{camX, camY, screenScale, fbWidth, fbHeight}, renderPool);
+
+    if (!drawList.instances.empty()) {
+        glBindBuffer(GL_ARRAY_BUFFER, bodyInstanceVBO);
+        orphanAndUpload(drawList.instances.size(), sizeof(BodyInstance), drawList.instances.data(),
+                        instanceCapacity);
+
+        // Camera goes in as uniforms instead of being baked into every vertex on the CPU
+        float camHigh[2], camLow[2];
+        splitDouble(camX, camHigh[0], camLow[0]);
+        splitDouble(camY, camHigh[1], camLow[1]);
+
+        glUseProgram(shaderProgram);
+        glUniform2f(bodyCamHighUniform, camHigh[0], camHigh[1]);
+        glUniform2f(bodyCamLowUniform, camLow[0], camLow[1]);
+        glUniform1f(bodyScaleUniform, static_cast<float>(screenScale));
+
+        // One instanced draw per tessellation level that has any bodies
+        glBindVertexArray(bodyVAO);
+        for (int lod = 0; lod < kBodyLodLevels; ++lod) {
+            const size_t first = drawList.lodBegin[lod];
+            const size_t count = drawList.lodBegin[lod + 1] - first;
+            if (count == 0) continue;
+            setInstanceAttributes(first);
+            glDrawArraysInstanced(GL_TRIANGLE_FAN, lodFirstVertex[lod], kBodyLodSegments[lod] + 2,
+                                  static_cast<GLsizei>(count));
+        }
+        glBindVertexArray(0);
+    }
+
+    // Everything smaller than a pixel, at most one point per pixel however many bodies it holds
+    if (!drawList.points.empty()) {
+        glBindBuffer(GL_ARRAY_BUFFER, pointVBO);
+        orphanAndUpload(drawList.points.size(), sizeof(PointSprite), drawList.points.data(), pointCapacity);
+
+        glUseProgram(pointShaderProgram);
+        glUniform2f(pointScreenUniform, static_cast<float>(fbWidth), static_cast<float>(fbHeight));
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glBindVertexArray(pointVAO);
+        glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(drawList.points.size()));
+        glBindVertexArray(0);
+        glDisable(GL_BLEND);
+        glUseProgram(shaderProgram);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return drawList.stats;
+}
+
+} // namespace SolarSim
@@ -0,0 +1,186 @@
+#include "bodysystem.h"
+
+#include <utility>
+
+#include "mass.h"
+
+namespace SolarSim {
+
+size_t BodySystem::add(const Mass& m) {
+    x.push_back(m.x);
+    y.push_back(m.y);
+    vx.push_back(m.vx);
+    vy.push_back(m.vy);
+    ax.push_back(m.ax);
+    ay.push_back(m.ay);
+    mass.push_back(m.mass);
+    radius.push_back(m.radius);
+    stepLevel.push_back(kUnsetStepLevel);
+
+    BodyInfo bodyInfo;
+    bodyInfo.name = m.name;
+    bodyInfo.r = m.r;
+    bodyInfo.g = m.g;
+    bodyInfo.b = m.b;
+    info.push_back(std::move(bodyInfo));
+
+    const size_t index = x.size() - 1;
+    slotOf.push_back(acquireSlot(static_cast<uint32_t>(index)));
+    layout++;
+    return index;
+}
+
+bool BodySystem::find(BodyHandle h, size_t& index) const {
+    if (h.slot >= slots.size() || slots[h.slot].generation != h.generation) return false;
+    index = slots[h.slot].index;
+    return true;
+}
+
+uint32_t BodySystem::acquireSlot(uint32_t index) {
+    uint32_t slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        slot = static_cast<uint32_t>(slots.size());
+        slots.emplace_back();
+    }
+    slots[slot].index = index;
+    return slot;
+}
+
+void BodySystem::releaseSlot(uint32_t slot) {
+    slots[slot].generation++;
+    freeSlots.push_back(slot);
+}
+
+Mass BodySystem::get(size_t i) const {
+    Mass m;
+    m.name = info[i].name;
+    m.mass = mass[i];
+    m.radius = radius[i];
+    m.x = x[i];
+    m.y = y[i];
+    m.vx = vx[i];
+    m.vy = vy[i];
+    m.ax = ax[i];
+    m.ay = ay[i];
+    m.r = info[i].r;
+    m.g = info[i].g;
+    m.b = info[i].b;
+    return m;
+}
+
+MassRef BodySystem::operator[](size_t i) {
+    return MassRef{x[i], y[i], vx[i], vy[i], ax[i], ay[i], mass[i], radius[i], info[i]};
+}
+
+void BodySystem::removeDead() {
+    size_t n = size();
+    const size_t before = n;
+    size_t i = 0;
+    while (i < n) {
+        if (mass[i] > 0) {
+            ++i;
+            continue;
+        }
+
+        // Move the last body into the hole and look at i again, it may be dead too
+        releaseSlot(slotOf[i]);
+        const size_t last = --n;
+        if (i != last) {
+            x[i] = x[last];
+            y[i] = y[last];
+            vx[i] = vx[last];
+            vy[i] = vy[last];
+            ax[i] = ax[last];
+            ay[i] = ay[last];
+            mass[i] = mass[last];
+            radius[i] = radius[last];
+            stepLevel[i] = stepLevel[last];
+            info[i] = std::move(info[last]);
+            slotOf[i] = slotOf[last];
+            slots[slotOf[i]].index = static_cast<uint32_t>(i);
+        }
+    }
+    if (n == before) return;
+
+    x.resize(n);
+    y.resize(n);
+    vx.resize(n);
+    vy.resize(n);
+    ax.resize(n);
+    ay.resize(n);
+    mass.resize(n);
+    radius.resize(n);
+    stepLevel.resize(n);
+    info.resize(n);
+    slotOf.resize(n);
+    layout++;
+}
+
+void BodySystem::reserve(size_t n) {
+    x.reserve(n);
+    y.reserve(n);
+    vx.reserve(n);
+    vy.reserve(n);
+    ax.reserve(n);
+    ay.reserve(n);
+    mass.reserve(n);
+    radius.reserve(n);
+    stepLevel.reserve(n);
+    info.reserve(n);
+    slotOf.reserve(n);
+}
+
+void BodySystem::resize(size_t n) {
+    x.resize(n);
+    y.resize(n);
+    vx.resize(n);
+    vy.resize(n);
+    ax.resize(n);
+    ay.resize(n);
+    mass.resize(n);
+    radius.resize(n);
+    stepLevel.resize(n, kUnsetStepLevel);
+    info.resize(n);
+
+    const size_t before = slotOf.size();
+    for (size_t i = n; i < before; ++i) releaseSlot(slotOf[i]);
+    slotOf.resize(n);
+    for (size_t i = before; i < n; ++i) slotOf[i] = acquireSlot(static_cast<uint32_t>(i));
+    layout++;
+}
+
+void BodySystem::clear() {
+    x.clear();
+    y.clear();
+    vx.clear();
+    vy.clear();
+    ax.clear();
+    ay.clear();
+    mass.clear();
+    radius.clear();
+    stepLevel.clear();
+    info.clear();
+
+    for (uint32_t slot : slotOf) releaseSlot(slot);
+    slotOf.clear();
+    layout++;
+}
+
+void BodySystem::calcVelocities(double dt, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        vx[i] += ax[i] * dt;
+        vy[i] += ay[i] * dt;
+    }
+}
+
+void BodySystem::calcNewPositions(double dt, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+    }
+}
+
+} // namespace SolarSim
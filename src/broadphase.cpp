@@ -0,0 +1,104 @@
+#include "broadphase.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+#include "bodysystem.h"
+
+namespace SolarSim {
+
+const char* broadPhaseName(BroadPhase phase) {
+    switch (phase) {
+        case BroadPhase::SweepAndPrune: return "Sweep and prune";
+        case BroadPhase::AabbTree: return "AABB tree";
+    }
+    return "Unknown";
+}
+
+bool broadPhaseFromName(const char* name, BroadPhase& phase) {
+    if (std::strcmp(name, "sweep") == 0) {
+        phase = BroadPhase::SweepAndPrune;
+    } else if (std::strcmp(name, "tree") == 0) {
+        phase = BroadPhase::AabbTree;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void SweepAndPrune::sortOrder(size_t n) {
+    auto byMinX = [&](uint32_t a, uint32_t b) { return minX[a] < minX[b]; };
+
+    // Bodies were added or removed, start over
+    if (order.size() != n) {
+        order.resize(n);
+        std::iota(order.begin(), order.end(), 0u);
+        std::sort(order.begin(), order.end(), byMinX);
+        return;
+    }
+
+    // Insertion sort on last frame's order, but give up and fall back to a
+    // full sort if things got shuffled a lot (e.g. after a big spawn)
+    const size_t shiftBudget = n * 8 + 64;
+    size_t shifts = 0;
+    for (size_t k = 1; k < n; ++k) {
+        uint32_t body = order[k];
+        size_t slot = k;
+        while (slot > 0 && byMinX(body, order[slot - 1])) {
+            order[slot] = order[slot - 1];
+            --slot;
+            if (++shifts > shiftBudget) {
+                order[slot] = body;
+                std::sort(order.begin(), order.end(), byMinX);
+                return;
+            }
+        }
+        order[slot] = body;
+    }
+}
+
+void SweepAndPrune::findCandidates(const BodySystem& bodies, std::vector<BodyPair>& pairs) {
+    // A body that didn't move sweeps nothing but its own circle
+    findCandidates(bodies, bodies.x.data(), bodies.y.data(), pairs);
+}
+
+void SweepAndPrune::findCandidates(const BodySystem& bodies, const double* startX, const double* startY,
+                                   std::vector<BodyPair>& pairs) {
+    pairs.clear();
+    const size_t n = bodies.size();
+
+    minX.resize(n);
+    maxX.resize(n);
+    minY.resize(n);
+    maxY.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        const double r = bodies.radius[i];
+        minX[i] = std::min(startX[i], bodies.x[i]) - r;
+        maxX[i] = std::max(startX[i], bodies.x[i]) + r;
+        minY[i] = std::min(startY[i], bodies.y[i]) - r;
+        maxY[i] = std::max(startY[i], bodies.y[i]) + r;
+    }
+
+    sortOrder(n);
+
+    for (size_t k = 0; k < n; ++k) {
+        const uint32_t a = order[k];
+
+        // Everything after a in the order starts further right; stop at the first one
+        // that starts past a's right edge
+        for (size_t m = k + 1; m < n; ++m) {
+            const uint32_t b = order[m];
+            if (minX[b] > maxX[a]) break;
+
+            // Cheap y test before the pair is worth an exact check
+            if (maxY[b] < minY[a] || minY[b] > maxY[a]) continue;
+
+            pairs.emplace_back(std::min(a, b), std::max(a, b));
+        }
+    }
+
+    std::sort(pairs.begin(), pairs.end());
+}
+
+} // namespace SolarSim
@@ -0,0 +1,108 @@
+#include "contactislands.h"
+
+#include <algorithm>
+
+#include "bodysystem.h"
+#include "mass.h"
+#include "simglobals.h"
+
+namespace SolarSim {
+
+namespace {
+
+// Candidate pairs per chunk of the narrow phase
+constexpr size_t kNarrowPhaseGrain = 1024;
+
+// pairTime for a pair that never touched (times of impact are within [0, 1])
+constexpr double kNoContact = 2.0;
+
+constexpr uint32_t kNoIsland = UINT32_MAX;
+
+} // namespace
+
+uint32_t ContactIslands::findRoot(uint32_t body) {
+    // Path halving: every other body on the way up skips to its grandparent
+    while (parent[body] != body) {
+        parent[body] = parent[parent[body]];
+        body = parent[body];
+    }
+    return body;
+}
+
+void ContactIslands::build(const BodySystem& bodies, const double* startX, const double* startY,
+                           const std::vector<BodyPair>& candidates) {
+    // Narrow phase: every pair is tested against the positions the integrator left, and
+    // only writes its own slot
+    pairTime.resize(candidates.size());
+    threadPool.parallelFor(0, candidates.size(), kNarrowPhaseGrain, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            const uint32_t i = candidates[k].first;
+            const uint32_t j = candidates[k].second;
+            const double t = sweptCollisionTime(bodies, startX, startY, i, j);
+            if (t >= 0.0) {
+                pairTime[k] = t;
+            } else {
+                pairTime[k] = checkCollision(bodies, i, j) ? -1.0 : kNoContact;
+            }
+        }
+    });
+
+    touching.clear();
+    for (size_t k = 0; k < candidates.size(); ++k) {
+        if (pairTime[k] != kNoContact) touching.push_back(Contact{pairTime[k], candidates[k].first, candidates[k].second});
+    }
+
+    contacts.clear();
+    islandBegin.assign(1, 0);
+    sweptContacts = 0;
+    largestIsland = 0;
+    if (touching.empty()) return;
+
+    // Union-find over the bodies in a contact. The smaller index always becomes the root,
+    // so every island ends up rooted at its lowest body whatever order pairs joined in.
+    if (parent.size() < bodies.size()) {
+        parent.resize(bodies.size());
+        islandOf.resize(bodies.size());
+    }
+    for (const Contact& c : touching) {
+        parent[c.i] = c.i;
+        parent[c.j] = c.j;
+        islandOf[c.i] = islandOf[c.j] = kNoIsland;
+    }
+    for (const Contact& c : touching) {
+        const uint32_t a = findRoot(c.i);
+        const uint32_t b = findRoot(c.j);
+        if (a < b) {
+            parent[b] = a;
+        } else if (b < a) {
+            parent[a] = b;
+        }
+    }
+
+    // Islands are numbered in the order their first contact appears. Counting sort on
+    // (island, has a time of impact) keeps candidate order inside each part.
+    uint32_t islands = 0;
+    keyOf.resize(touching.size());
+    for (size_t k = 0; k < touching.size(); ++k) {
+        const uint32_t root = findRoot(touching[k].i);
+        if (islandOf[root] == kNoIsland) islandOf[root] = islands++;
+        const bool swept = touching[k].t >= 0.0;
+        keyOf[k] = islandOf[root] * 2 + (swept ? 1 : 0);
+        if (swept) sweptContacts++;
+    }
+
+    keyStart.assign(size_t(islands) * 2 + 1, 0);
+    for (uint32_t key : keyOf) keyStart[key + 1]++;
+    for (size_t key = 1; key < keyStart.size(); ++key) keyStart[key] += keyStart[key - 1];
+
+    islandBegin.resize(size_t(islands) + 1);
+    for (uint32_t island = 0; island <= islands; ++island) islandBegin[island] = keyStart[size_t(island) * 2];
+    for (uint32_t island = 0; island < islands; ++island) {
+        largestIsland = std::max<size_t>(largestIsland, islandBegin[island + 1] - islandBegin[island]);
+    }
+
+    contacts.resize(touching.size());
+    for (size_t k = 0; k < touching.size(); ++k) contacts[keyStart[keyOf[k]]++] = touching[k];
+}
+
+} // namespace SolarSim
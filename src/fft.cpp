@@ -0,0 +1,90 @@
+#include "fft.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+#include "simglobals.h"
+
+namespace SolarSim {
+
+namespace {
+
+// Tile edge for the transpose: two 32 x 32 tiles of complex doubles fit in L1
+constexpr size_t kTransposeTile = 32;
+
+} // namespace
+
+void FFT::resize(size_t n) {
+    if (n == 0 || (n & (n - 1)) != 0) throw std::runtime_error("FFT length must be a power of two");
+    if (n == length) return;
+    length = n;
+
+    const double pi = std::acos(-1.0);
+    twiddles.resize(n / 2);
+    for (size_t k = 0; k < n / 2; ++k) {
+        const double angle = -2.0 * pi * static_cast<double>(k) / static_cast<double>(n);
+        twiddles[k] = Complex(std::cos(angle), std::sin(angle));
+    }
+
+    int bits = 0;
+    while ((size_t(1) << bits) < n) ++bits;
+    bitReverse.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t reversed = 0;
+        for (int b = 0; b < bits; ++b) {
+            if (i & (size_t(1) << b)) reversed |= 1u << (bits - 1 - b);
+        }
+        bitReverse[i] = reversed;
+    }
+}
+
+void FFT::transform(Complex* data, bool inverse) const {
+    for (size_t i = 0; i < length; ++i) {
+        if (i < bitReverse[i]) std::swap(data[i], data[bitReverse[i]]);
+    }
+
+    // Butterflies written out on the real and imaginary parts: std::complex's operator*
+    // checks for infinities and NaNs on every multiply unless built with -ffast-math
+    const double sign = inverse ? -1.0 : 1.0;
+    for (size_t half = 1; half < length; half *= 2) {
+        const size_t stride = length / (half * 2);
+        for (size_t block = 0; block < length; block += half * 2) {
+            for (size_t k = 0; k < half; ++k) {
+                const double wr = twiddles[k * stride].real();
+                const double wi = sign * twiddles[k * stride].imag();
+                Complex& a = data[block + k];
+                Complex& b = data[block + k + half];
+                const double br = b.real() * wr - b.imag() * wi;
+                const double bi = b.real() * wi + b.imag() * wr;
+                b = Complex(a.real() - br, a.imag() - bi);
+                a = Complex(a.real() + br, a.imag() + bi);
+            }
+        }
+    }
+}
+
+void transposeSquare(Complex* data, size_t n) {
+    const size_t tiles = (n + kTransposeTile - 1) / kTransposeTile;
+
+    // Tile row r swaps its tiles right of the diagonal with the matching ones below it,
+    // so no two tile rows touch the same elements
+    threadPool.parallelFor(0, tiles, 1, [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; ++r) {
+            const size_t rowBegin = r * kTransposeTile;
+            const size_t rowEnd = std::min(n, rowBegin + kTransposeTile);
+            for (size_t c = r; c < tiles; ++c) {
+                const size_t colBegin = c * kTransposeTile;
+                const size_t colEnd = std::min(n, colBegin + kTransposeTile);
+                for (size_t i = rowBegin; i < rowEnd; ++i) {
+                    for (size_t j = std::max(colBegin, i + 1); j < colEnd; ++j) {
+                        std::swap(data[i * n + j], data[j * n + i]);
+                    }
+                }
+            }
+        }
+    });
+}
+
+} // namespace SolarSim
@@ -1,12 +1,13 @@
 #include "globals.h"
 
+#include <algorithm>
+#include <thread>
+
 #include "constants.h"
-#include "mass.h"
 
 namespace SolarSim {
 
-// Simulation parameters
-double timeStepMult = 600.0;
+// Camera parameters
 double zoomFactor = 0.9;
 double camX = 0.0;
 double camY = 0.0;
@@ -16,6 +17,9 @@ double screenScale = 1.0 / (Constants::earthMoonDistance * 2) * zoomFactor;
 bool isLeftMouseButtonDown = false;
 bool isRightMouseButtonDown = false;
 bool isMiddleMouseButtonDown = false;
+bool isSolverKeyDown = false;
+bool isSaveKeyDown = false;
+bool isTraceKeyDown = false;
 int massType = 0;
 double startxpos = 0.0;
 double startypos = 0.0;
@@ -23,20 +27,26 @@ double lastMouseX = 0.0;
 double lastMouseY = 0.0;
 bool isCameraFollowMass = false;
 bool clickedExistingMass = false;
-int selectedMassIndex = -1;
+double requestedSimSpeed = 0.0;
 
 // OpenGL handles
 GLFWwindow* window = nullptr;
 unsigned int shaderProgram = 0;
 unsigned int textShaderProgram = 0;
-unsigned int textVAO = 0;
-unsigned int textVBO = 0;
 GLint textScreenUniform = -1;
 GLint textColorUniform = -1;
+unsigned int bodyVAO = 0;
+unsigned int bodyMeshVBO = 0;
+unsigned int bodyInstanceVBO = 0;
+GLint bodyCamHighUniform = -1;
+GLint bodyCamLowUniform = -1;
+GLint bodyScaleUniform = -1;
+unsigned int pointShaderProgram = 0;
+GLint pointScreenUniform = -1;
+unsigned int pointVAO = 0;
+unsigned int pointVBO = 0;
 
 // Text rendering buffers
-int textVertexCount = 0;
-std::vector<float> textVertices;
 bool showTextOverlay = false;
 std::string overlayText;
 float overlayScale = 3.0f;
@@ -44,10 +54,14 @@ float overlayMargin = 24.0f;
 float timeOverlayScale = 2.6f;
 float timeOverlayMargin = 24.0f;
 std::string timeOverlayText;
-std::vector<unsigned char> textScratchBuffer;
 
-// Simulation collections
-std::vector<Mass> massesVector;
+PhysicsThread physicsThread;
+SpatialIndex pickIndex;
+ThreadPool renderPool(std::max(1u, std::thread::hardware_concurrency() / 4));
+
+std::string tracePath = "solarsim-trace.json";
+
+// Names handed out to user-spawned masses
 std::vector<std::string> celestialBodies = {
     // Real exoplanets
     "Kepler-22b", "Kepler-62f", "Kepler-69c", "Kepler-186f", "Kepler-442b", "Kepler-452b",
@@ -81,7 +95,9 @@ std::vector<std::string> celestialBodies = {
     "HIP 99231c", "HIP 12008b", "HD 41023d"
 };
 
-// Random number generator seeded once (used for mass creation)
-std::mt19937 randomGenerator{std::random_device{}()};
+// Random number generator seeded once (used for mass creation). The seed is kept so an
+// input recording can note it, --seed fixes it.
+uint32_t randomSeed = std::random_device{}();
+std::mt19937 randomGenerator{randomSeed};
 
 } // namespace SolarSim
@@ -0,0 +1,303 @@
+#include "gravity.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "bodysystem.h"
+#include "constants.h"
+#include "simglobals.h"
+#include "gravitykernel.h"
+#include "particlemesh.h"
+#include "profiler.h"
+
+namespace SolarSim {
+
+namespace {
+
+// Past this depth bodies sharing a cell are just chained together in the leaf
+// (protects against near-coincident bodies subdividing forever).
+constexpr int kMaxDepth = 40;
+
+// Bodies per parallel chunk. Each direct-sum target is a full O(N) sweep so small
+// chunks already carry plenty of work; tree walks are cheaper and get bigger chunks.
+constexpr size_t kDirectGrain = 16;
+constexpr size_t kTreeWalkGrain = 64;
+
+// Reused between frames so the tree isn't reallocated every step
+QuadTree tree;
+ParticleMesh mesh;
+
+} // namespace
+
+void QuadTree::build(const BodySystem& bodies) {
+    nodes.clear();
+    nextBody.assign(bodies.size(), -1);
+    if (bodies.empty()) return;
+
+    // Square root cell covering every body
+    double minX = bodies.x[0], maxX = bodies.x[0];
+    double minY = bodies.y[0], maxY = bodies.y[0];
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        minX = std::min(minX, bodies.x[i]); maxX = std::max(maxX, bodies.x[i]);
+        minY = std::min(minY, bodies.y[i]); maxY = std::max(maxY, bodies.y[i]);
+    }
+
+    QuadNode root;
+    root.cx = (minX + maxX) * 0.5;
+    root.cy = (minY + maxY) * 0.5;
+    // Pad a little so bodies sitting exactly on the edge still land inside
+    root.halfSize = std::max(maxX - minX, maxY - minY) * 0.5 * (1.0 + 1e-9) + 1.0;
+    nodes.reserve(bodies.size() * 2 + 1);
+    nodes.push_back(root);
+
+    for (int i = 0; i < static_cast<int>(bodies.size()); ++i) {
+        insert(bodies, i);
+    }
+
+    // Children are always created after their parent, so walking backwards
+    // sums every subtree before its parent needs it
+    for (int n = static_cast<int>(nodes.size()) - 1; n >= 0; --n) {
+        QuadNode& node = nodes[n];
+        double mass = 0.0, mx = 0.0, my = 0.0;
+
+        if (node.isLeaf()) {
+            for (int b = node.firstBody; b >= 0; b = nextBody[b]) {
+                mass += bodies.mass[b];
+                mx += bodies.mass[b] * bodies.x[b];
+                my += bodies.mass[b] * bodies.y[b];
+            }
+        } else {
+            for (int c : node.children) {
+                if (c < 0) continue;
+                mass += nodes[c].mass;
+                mx += nodes[c].mass * nodes[c].comX;
+                my += nodes[c].mass * nodes[c].comY;
+            }
+        }
+
+        node.mass = mass;
+        node.comX = mass > 0.0 ? mx / mass : node.cx;
+        node.comY = mass > 0.0 ? my / mass : node.cy;
+    }
+}
+
+int QuadTree::childFor(int node, double x, double y) {
+    int quadrant = (x >= nodes[node].cx ? 1 : 0) | (y >= nodes[node].cy ? 2 : 0);
+    if (nodes[node].children[quadrant] >= 0) return nodes[node].children[quadrant];
+
+    // Copy what we need before push_back can move the node
+    double half = nodes[node].halfSize * 0.5;
+    QuadNode child;
+    child.cx = nodes[node].cx + ((quadrant & 1) ? half : -half);
+    child.cy = nodes[node].cy + ((quadrant & 2) ? half : -half);
+    child.halfSize = half;
+    child.depth = nodes[node].depth + 1;
+
+    nodes.push_back(child);
+    int index = static_cast<int>(nodes.size()) - 1;
+    nodes[node].children[quadrant] = index;
+    return index;
+}
+
+void QuadTree::insert(const BodySystem& bodies, int body) {
+    const double x = bodies.x[body];
+    const double y = bodies.y[body];
+    int node = 0;
+
+    while (true) {
+        if (!nodes[node].isLeaf()) {
+            node = childFor(node, x, y);
+            continue;
+        }
+
+        // Empty leaf, just take it
+        if (nodes[node].firstBody < 0) {
+            nodes[node].firstBody = body;
+            nextBody[body] = -1;
+            return;
+        }
+
+        // Too deep to keep splitting, share the leaf
+        if (nodes[node].depth >= kMaxDepth) {
+            nextBody[body] = nodes[node].firstBody;
+            nodes[node].firstBody = body;
+            return;
+        }
+
+        // Occupied leaf: push the current occupant down a level and try again
+        int existing = nodes[node].firstBody;
+        nodes[node].firstBody = -1;
+        int child = childFor(node, bodies.x[existing], bodies.y[existing]);
+        nodes[child].firstBody = existing;
+        nextBody[existing] = -1;
+    }
+}
+
+void QuadTree::accelerationAt(const BodySystem& bodies, int self, double px, double py,
+                              double theta, double& outAx, double& outAy) const {
+    outAx = 0.0;
+    outAy = 0.0;
+    if (nodes.empty()) return;
+
+    // Each level pops one node and pushes at most four
+    int stack[4 * kMaxDepth + 8];
+    int top = 0;
+    stack[top++] = 0;
+
+    const double theta2 = theta * theta;
+
+    while (top > 0) {
+        const QuadNode& node = nodes[stack[--top]];
+        if (node.mass == 0.0) continue;
+
+        if (node.isLeaf()) {
+            for (int b = node.firstBody; b >= 0; b = nextBody[b]) {
+                if (b == self) continue; // Don't pull yourself
+                double dx = bodies.x[b] - px;
+                double dy = bodies.y[b] - py;
+                double distSquared = dx * dx + dy * dy;
+                double dist = std::sqrt(distSquared);
+                double force = Constants::G * bodies.mass[b] / distSquared;
+                outAx += force * dx / dist;
+                outAy += force * dy / dist;
+            }
+            continue;
+        }
+
+        double dx = node.comX - px;
+        double dy = node.comY - py;
+        double distSquared = dx * dx + dy * dy;
+        double size = node.halfSize * 2.0;
+        bool inside = std::abs(px - node.cx) <= node.halfSize && std::abs(py - node.cy) <= node.halfSize;
+
+        // Far enough away: treat the whole cell as one point mass
+        if (!inside && size * size < theta2 * distSquared) {
+            double dist = std::sqrt(distSquared);
+            double force = Constants::G * node.mass / distSquared;
+            outAx += force * dx / dist;
+            outAy += force * dy / dist;
+            continue;
+        }
+
+        for (int c : node.children) {
+            if (c >= 0) stack[top++] = c;
+        }
+    }
+}
+
+void computeAccelerationsDirect(BodySystem& bodies) {
+    // For each mass add up the gravitational pull every other mass applies to it,
+    // a block of targets per chunk so every core gets a share
+    threadPool.parallelFor(0, bodies.size(), kDirectGrain, [&](size_t begin, size_t end) {
+        accumulateAccelerations(bodies.x.data(), bodies.y.data(), bodies.mass.data(), bodies.size(),
+                                begin, end, bodies.ax.data(), bodies.ay.data(), simdLevel);
+    });
+}
+
+void computeAccelerationsBarnesHut(BodySystem& bodies, double theta) {
+    // Building stays serial, the walks are independent per body
+    tree.build(bodies);
+    threadPool.parallelFor(0, bodies.size(), kTreeWalkGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            tree.accelerationAt(bodies, static_cast<int>(i), bodies.x[i], bodies.y[i], theta,
+                                bodies.ax[i], bodies.ay[i]);
+        }
+    });
+}
+
+void computeAccelerationsParticleMesh(BodySystem& bodies, size_t gridSize, bool shortRange) {
+    mesh.computeAccelerations(bodies, gridSize, shortRange);
+}
+
+void computeAccelerations(BodySystem& bodies) {
+    SOLARSIM_PROFILE_SCOPE(ProfilePhase::Gravity);
+    switch (forceSolver) {
+        case ForceSolver::Direct:
+            computeAccelerationsDirect(bodies);
+            break;
+        case ForceSolver::BarnesHut:
+            computeAccelerationsBarnesHut(bodies, barnesHutTheta);
+            break;
+        case ForceSolver::ParticleMesh:
+            computeAccelerationsParticleMesh(bodies, particleMeshGrid, particleMeshShortRange);
+            break;
+    }
+}
+
+void computeAccelerations(BodySystem& bodies, const std::vector<uint32_t>& targets) {
+    // Everyone's due, the contiguous passes are faster
+    if (targets.size() == bodies.size()) {
+        computeAccelerations(bodies);
+        return;
+    }
+
+    SOLARSIM_PROFILE_SCOPE(ProfilePhase::Gravity);
+    switch (forceSolver) {
+        case ForceSolver::Direct:
+            threadPool.parallelFor(0, targets.size(), kDirectGrain, [&](size_t begin, size_t end) {
+                for (size_t k = begin; k < end; ++k) {
+                    accumulateAccelerations(bodies.x.data(), bodies.y.data(), bodies.mass.data(), bodies.size(),
+                                            targets[k], targets[k] + 1, bodies.ax.data(), bodies.ay.data(), simdLevel);
+                }
+            });
+            break;
+        case ForceSolver::BarnesHut:
+            tree.build(bodies);
+            threadPool.parallelFor(0, targets.size(), kTreeWalkGrain, [&](size_t begin, size_t end) {
+                for (size_t k = begin; k < end; ++k) {
+                    const uint32_t i = targets[k];
+                    tree.accelerationAt(bodies, static_cast<int>(i), bodies.x[i], bodies.y[i], barnesHutTheta,
+                                        bodies.ax[i], bodies.ay[i]);
+                }
+            });
+            break;
+        case ForceSolver::ParticleMesh:
+            mesh.computeAccelerations(bodies, targets, particleMeshGrid, particleMeshShortRange);
+            break;
+    }
+}
+
+double totalEnergy(const BodySystem& bodies) {
+    const size_t n = bodies.size();
+    double kinetic = 0.0;
+    double potential = 0.0;
+
+    for (size_t i = 0; i < n; ++i) {
+        kinetic += 0.5 * bodies.mass[i] * (bodies.vx[i] * bodies.vx[i] + bodies.vy[i] * bodies.vy[i]);
+
+        for (size_t j = i + 1; j < n; ++j) {
+            double dx = bodies.x[j] - bodies.x[i];
+            double dy = bodies.y[j] - bodies.y[i];
+            double dist = std::sqrt(dx * dx + dy * dy);
+            if (dist == 0.0) continue;
+            potential -= Constants::G * bodies.mass[i] * bodies.mass[j] / dist;
+        }
+    }
+
+    return kinetic + potential;
+}
+
+const char* forceSolverName(ForceSolver solver) {
+    switch (solver) {
+        case ForceSolver::Direct: return "Direct";
+        case ForceSolver::BarnesHut: return "Barnes-Hut";
+        case ForceSolver::ParticleMesh: return "Particle-mesh";
+    }
+    return "Unknown";
+}
+
+bool forceSolverFromName(const char* name, ForceSolver& solver) {
+    if (std::strcmp(name, "direct") == 0) {
+        solver = ForceSolver::Direct;
+    } else if (std::strcmp(name, "barnes-hut") == 0) {
+        solver = ForceSolver::BarnesHut;
+    } else if (std::strcmp(name, "particle-mesh") == 0) {
+        solver = ForceSolver::ParticleMesh;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+} // namespace SolarSim
@@ -0,0 +1,228 @@
+#include "gravitykernel.h"
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SOLARSIM_X86 1
+#else
+#define SOLARSIM_X86 0
+#endif
+
+#include "constants.h"
+
+namespace SolarSim {
+
+namespace {
+
+// Pull of sources [from, n) on target i, same formula as Mass::calcAcceleration
+void accumulateScalarRange(const double* x, const double* y, const float* mass, size_t from, size_t n,
+                           size_t i, double& sumAx, double& sumAy) {
+    for (size_t j = from; j < n; ++j) {
+        double dx = x[j] - x[i];
+        double dy = y[j] - y[i];
+        double distSquared = dx * dx + dy * dy;
+        if (distSquared == 0.0) continue; // Don't pull yourself
+        double force = Constants::G * mass[j] / distSquared;
+        double dist = std::sqrt(distSquared);
+        sumAx += force * dx / dist;
+        sumAy += force * dy / dist;
+    }
+}
+
+void accumulateScalar(const double* x, const double* y, const float* mass, size_t n,
+                      size_t begin, size_t end, double* ax, double* ay) {
+    for (size_t i = begin; i < end; ++i) {
+        double sumAx = 0.0;
+        double sumAy = 0.0;
+        accumulateScalarRange(x, y, mass, 0, n, i, sumAx, sumAy);
+        ax[i] = sumAx;
+        ay[i] = sumAy;
+    }
+}
+
+#if SOLARSIM_X86
+
+__attribute__((target("sse2")))
+void accumulateSSE2(const double* x, const double* y, const float* mass, size_t n,
+                    size_t begin, size_t end, double* ax, double* ay) {
+    const __m128d g = _mm_set1_pd(Constants::G);
+    const __m128d half = _mm_set1_pd(0.5);
+    const __m128d threeHalves = _mm_set1_pd(1.5);
+    const __m128d zero = _mm_setzero_pd();
+    const size_t vecEnd = n - n % 2;
+
+    for (size_t i = begin; i < end; ++i) {
+        const __m128d px = _mm_set1_pd(x[i]);
+        const __m128d py = _mm_set1_pd(y[i]);
+        __m128d sumX = zero;
+        __m128d sumY = zero;
+
+        for (size_t j = 0; j < vecEnd; j += 2) {
+            __m128d dx = _mm_sub_pd(_mm_loadu_pd(x + j), px);
+            __m128d dy = _mm_sub_pd(_mm_loadu_pd(y + j), py);
+            __m128d d2 = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+
+            // Single precision estimate, then two Newton steps back up to ~double accuracy
+            __m128d inv = _mm_cvtps_pd(_mm_rsqrt_ps(_mm_cvtpd_ps(d2)));
+            inv = _mm_mul_pd(inv, _mm_sub_pd(threeHalves, _mm_mul_pd(_mm_mul_pd(half, d2), _mm_mul_pd(inv, inv))));
+            inv = _mm_mul_pd(inv, _mm_sub_pd(threeHalves, _mm_mul_pd(_mm_mul_pd(half, d2), _mm_mul_pd(inv, inv))));
+            inv = _mm_and_pd(inv, _mm_cmpgt_pd(d2, zero)); // self term is 0 * inf, mask it out
+
+            __m128d m = _mm_set_pd(mass[j + 1], mass[j]);
+            __m128d s = _mm_mul_pd(_mm_mul_pd(g, m), _mm_mul_pd(inv, _mm_mul_pd(inv, inv)));
+            sumX = _mm_add_pd(sumX, _mm_mul_pd(s, dx));
+            sumY = _mm_add_pd(sumY, _mm_mul_pd(s, dy));
+        }
+
+        double lanesX[2], lanesY[2];
+        _mm_storeu_pd(lanesX, sumX);
+        _mm_storeu_pd(lanesY, sumY);
+        double sumAx = lanesX[0] + lanesX[1];
+        double sumAy = lanesY[0] + lanesY[1];
+        accumulateScalarRange(x, y, mass, vecEnd, n, i, sumAx, sumAy);
+        ax[i] = sumAx;
+        ay[i] = sumAy;
+    }
+}
+
+__attribute__((target("avx2")))
+void accumulateAVX2(const double* x, const double* y, const float* mass, size_t n,
+                    size_t begin, size_t end, double* ax, double* ay) {
+    const __m256d g = _mm256_set1_pd(Constants::G);
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d threeHalves = _mm256_set1_pd(1.5);
+    const __m256d zero = _mm256_setzero_pd();
+    const size_t vecEnd = n - n % 4;
+
+    for (size_t i = begin; i < end; ++i) {
+        const __m256d px = _mm256_set1_pd(x[i]);
+        const __m256d py = _mm256_set1_pd(y[i]);
+        __m256d sumX = zero;
+        __m256d sumY = zero;
+
+        for (size_t j = 0; j < vecEnd; j += 4) {
+            __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + j), px);
+            __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + j), py);
+            __m256d d2 = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+
+            // AVX2 has no double rsqrt, so estimate in single precision and refine twice
+            __m256d inv = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(d2)));
+            inv = _mm256_mul_pd(inv, _mm256_sub_pd(threeHalves, _mm256_mul_pd(_mm256_mul_pd(half, d2), _mm256_mul_pd(inv, inv))));
+            inv = _mm256_mul_pd(inv, _mm256_sub_pd(threeHalves, _mm256_mul_pd(_mm256_mul_pd(half, d2), _mm256_mul_pd(inv, inv))));
+            inv = _mm256_and_pd(inv, _mm256_cmp_pd(d2, zero, _CMP_GT_OQ));
+
+            __m256d m = _mm256_cvtps_pd(_mm_loadu_ps(mass + j));
+            __m256d s = _mm256_mul_pd(_mm256_mul_pd(g, m), _mm256_mul_pd(inv, _mm256_mul_pd(inv, inv)));
+            sumX = _mm256_add_pd(sumX, _mm256_mul_pd(s, dx));
+            sumY = _mm256_add_pd(sumY, _mm256_mul_pd(s, dy));
+        }
+
+        double lanesX[4], lanesY[4];
+        _mm256_storeu_pd(lanesX, sumX);
+        _mm256_storeu_pd(lanesY, sumY);
+        double sumAx = (lanesX[0] + lanesX[1]) + (lanesX[2] + lanesX[3]);
+        double sumAy = (lanesY[0] + lanesY[1]) + (lanesY[2] + lanesY[3]);
+        accumulateScalarRange(x, y, mass, vecEnd, n, i, sumAx, sumAy);
+        ax[i] = sumAx;
+        ay[i] = sumAy;
+    }
+}
+
+__attribute__((target("avx512f")))
+void accumulateAVX512(const double* x, const double* y, const float* mass, size_t n,
+                      size_t begin, size_t end, double* ax, double* ay) {
+    const __m512d g = _mm512_set1_pd(Constants::G);
+    const __m512d half = _mm512_set1_pd(0.5);
+    const __m512d threeHalves = _mm512_set1_pd(1.5);
+    const __m512d zero = _mm512_setzero_pd();
+    const size_t vecEnd = n - n % 8;
+
+    for (size_t i = begin; i < end; ++i) {
+        const __m512d px = _mm512_set1_pd(x[i]);
+        const __m512d py = _mm512_set1_pd(y[i]);
+        __m512d sumX = zero;
+        __m512d sumY = zero;
+
+        for (size_t j = 0; j < vecEnd; j += 8) {
+            __m512d dx = _mm512_sub_pd(_mm512_loadu_pd(x + j), px);
+            __m512d dy = _mm512_sub_pd(_mm512_loadu_pd(y + j), py);
+            __m512d d2 = _mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy));
+
+            // 14-bit double estimate, two Newton steps take it past 50 bits.
+            // (all-lanes maskz forms: the plain ones trip GCC's maybe-uninitialized warning)
+            __m512d inv = _mm512_maskz_rsqrt14_pd(0xFF, d2);
+            inv = _mm512_mul_pd(inv, _mm512_sub_pd(threeHalves, _mm512_mul_pd(_mm512_mul_pd(half, d2), _mm512_mul_pd(inv, inv))));
+            inv = _mm512_mul_pd(inv, _mm512_sub_pd(threeHalves, _mm512_mul_pd(_mm512_mul_pd(half, d2), _mm512_mul_pd(inv, inv))));
+            inv = _mm512_maskz_mov_pd(_mm512_cmp_pd_mask(d2, zero, _CMP_GT_OQ), inv);
+
+            __m512d m = _mm512_maskz_cvtps_pd(0xFF, _mm256_loadu_ps(mass + j));
+            __m512d s = _mm512_mul_pd(_mm512_mul_pd(g, m), _mm512_mul_pd(inv, _mm512_mul_pd(inv, inv)));
+            sumX = _mm512_add_pd(sumX, _mm512_mul_pd(s, dx));
+            sumY = _mm512_add_pd(sumY, _mm512_mul_pd(s, dy));
+        }
+
+        double lanesX[8], lanesY[8];
+        _mm512_storeu_pd(lanesX, sumX);
+        _mm512_storeu_pd(lanesY, sumY);
+        double sumAx = ((lanesX[0] + lanesX[1]) + (lanesX[2] + lanesX[3])) + ((lanesX[4] + lanesX[5]) + (lanesX[6] + lanesX[7]));
+        double sumAy = ((lanesY[0] + lanesY[1]) + (lanesY[2] + lanesY[3])) + ((lanesY[4] + lanesY[5]) + (lanesY[6] + lanesY[7]));
+        accumulateScalarRange(x, y, mass, vecEnd, n, i, sumAx, sumAy);
+        ax[i] = sumAx;
+        ay[i] = sumAy;
+    }
+}
+
+#endif // SOLARSIM_X86
+
+} // namespace
+
+SimdLevel detectSimdLevel() {
+    static const SimdLevel level = [] {
+#if SOLARSIM_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return SimdLevel::AVX512;
+        if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+        if (__builtin_cpu_supports("sse2")) return SimdLevel::SSE2;
+#endif
+        return SimdLevel::Scalar;
+    }();
+    return level;
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Scalar: return "Scalar";
+        case SimdLevel::SSE2: return "SSE2";
+        case SimdLevel::AVX2: return "AVX2";
+        case SimdLevel::AVX512: return "AVX-512";
+    }
+    return "Unknown";
+}
+
+void accumulateAccelerations(const double* x, const double* y, const float* mass, size_t n,
+                             size_t begin, size_t end, double* ax, double* ay, SimdLevel level) {
+    // Never run something the CPU can't execute, whatever was asked for
+    if (static_cast<int>(level) > static_cast<int>(detectSimdLevel())) {
+        level = detectSimdLevel();
+    }
+
+    switch (level) {
+#if SOLARSIM_X86
+        case SimdLevel::AVX512:
+            accumulateAVX512(x, y, mass, n, begin, end, ax, ay);
+            return;
+        case SimdLevel::AVX2:
+            accumulateAVX2(x, y, mass, n, begin, end, ax, ay);
+            return;
+        case SimdLevel::SSE2:
+            accumulateSSE2(x, y, mass, n, begin, end, ax, ay);
+            return;
+#endif
+        default:
+            accumulateScalar(x, y, mass, n, begin, end, ax, ay);
+            return;
+    }
+}
+
+} // namespace SolarSim
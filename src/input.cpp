@@ -1,18 +1,65 @@
 #include "input.h"
 
+#include <algorithm>
 #include <cmath>
+#include <exception>
 #include <iostream>
-#include <sstream>
 
 #include "constants.h"
 #include "globals.h"
+#include "gravity.h"
 #include "mass.h"
+#include "profiler.h"
 #include "rendering.h"
+#include "stepscheduler.h"
 #include "utils.h"
 
 namespace SolarSim {
 
 int processInput(GLFWwindow* window) {
+    // B cycles through the gravity solvers: exact, Barnes-Hut, particle mesh
+    if (glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS && !isSolverKeyDown) {
+        isSolverKeyDown = true;
+        SimCommand command;
+        command.type = SimCommand::Type::SetForceSolver;
+        switch (physicsThread.latest().forceSolver) {
+            case ForceSolver::Direct: command.solver = ForceSolver::BarnesHut; break;
+            case ForceSolver::BarnesHut: command.solver = ForceSolver::ParticleMesh; break;
+            case ForceSolver::ParticleMesh: command.solver = ForceSolver::Direct; break;
+        }
+        physicsThread.post(command);
+        std::cout << "Force solver: " << forceSolverName(command.solver) << '\n';
+    } else if (glfwGetKey(window, GLFW_KEY_B) == GLFW_RELEASE) {
+        isSolverKeyDown = false;
+    }
+
+    // F5 saves a snapshot (see --checkpoint)
+    if (glfwGetKey(window, GLFW_KEY_F5) == GLFW_PRESS && !isSaveKeyDown) {
+        isSaveKeyDown = true;
+        SimCommand command;
+        command.type = SimCommand::Type::SaveCheckpoint;
+        physicsThread.post(command);
+    } else if (glfwGetKey(window, GLFW_KEY_F5) == GLFW_RELEASE) {
+        isSaveKeyDown = false;
+    }
+
+    // F6 dumps the last few seconds of phase timings as a Chrome trace (see --trace)
+    if (glfwGetKey(window, GLFW_KEY_F6) == GLFW_PRESS && !isTraceKeyDown) {
+        isTraceKeyDown = true;
+        if (!kProfilerEnabled) {
+            std::cout << "Profiler was compiled out (built with PROFILE=0)\n";
+        } else {
+            try {
+                size_t events = profiler.writeChromeTrace(tracePath);
+                std::cout << "Wrote " << events << " trace events to " << tracePath << '\n';
+            } catch (const std::exception& e) {
+                std::cerr << "Trace export failed: " << e.what() << '\n';
+            }
+        }
+    } else if (glfwGetKey(window, GLFW_KEY_F6) == GLFW_RELEASE) {
+        isTraceKeyDown = false;
+    }
+
     // If the escape key was pressed shut down the window
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
         clearOverlayText();
@@ -32,28 +79,21 @@ int processInput(GLFWwindow* window) {
         // Convert Mouse pos to world pos
         screenToWorld(startxpos, startypos, fbWidth, fbHeight, worldScreenX, worldScreenY);
 
-        // For each mass check if the mouse pos is less that the radius of the mass
-        for (size_t i = 0; i < massesVector.size(); ++i) {
-            double mouseMassDist = std::sqrt(std::pow(worldScreenX - massesVector[i].x, 2) +
-                                             std::pow(worldScreenY - massesVector[i].y, 2));
-            if (mouseMassDist <= massesVector[i].radius) {
-
-                clickedExistingMass = true;
-                selectedMassIndex = static_cast<int>(i);
-                isCameraFollowMass = true;
-
-                // If clicked mass has no name assign it a name
-                if (massesVector[i].name.empty()) {
-                    massesVector[i].name = "[UNKNOWN]";
-                }
-
-                std::ostringstream overlay;
-                overlay << "Name: " << massesVector[i].name
-                        << "\nMass: " << formatScientific(massesVector[i].mass) << " kg"
-                        << "\nRadius: " << formatScientific(massesVector[i].radius) << " m";
-                updateOverlayText(overlay.str());
-                isLeftMouseButtonDown = false;
-            }
+        // Check whether the click landed on a mass in the latest snapshot. This only
+        // decides whether the click hit something; the physics thread does the real pick
+        // against its own bodies and the HUD picks up the result from the snapshot.
+        if (pickIndex.pick(worldScreenX, worldScreenY) >= 0) {
+            clickedExistingMass = true;
+            isCameraFollowMass = true;
+            isLeftMouseButtonDown = false;
+        }
+
+        if (clickedExistingMass) {
+            SimCommand command;
+            command.type = SimCommand::Type::SelectAt;
+            command.x = worldScreenX;
+            command.y = worldScreenY;
+            physicsThread.post(command);
         }
 
     // If the left mouse button isn't down and wasn't already up get the pos of the cursor
@@ -122,9 +162,11 @@ int processInput(GLFWwindow* window) {
         temp.mass   = static_cast<float>(massMult * random);
         temp.radius = static_cast<float>(radiusMult * random);
 
-        // Initialize the new mass and add it to the vector of masses
-        temp.init();
-        massesVector.push_back(temp);
+        // Hand the new mass to the physics thread, it lands before the next step
+        SimCommand command;
+        command.type = SimCommand::Type::SpawnMass;
+        command.mass = temp;
+        physicsThread.post(command);
         clearOverlayText();
 
     // Right mouse is pressed
@@ -191,18 +233,16 @@ void scroll_callback(GLFWwindow* window, double /*xoffset*/, double yoffset) {
         screenScale = 1.0 / (Constants::earthMoonDistance * 2) * zoomFactor;
     }
 
-    // Keeping the rest commented out for debugging parity with the original file
-    /*
+    // Shift+scroll speeds the simulation up or slows it down by a quarter per notch
     if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS ||
         glfwGetKey(window, GLFW_KEY_RIGHT_SHIFT) == GLFW_PRESS) {
 
-        timeStepMult += static_cast<float>(yoffset) * 10.0f;
-        if (timeStepMult < 0) timeStepMult = 0;
-        if (timeStepMult > 3000) timeStepMult = 3000;
-
-        std::cout << "\033[6;1H\33[KtimeStepMult " << timeStepMult;
+        requestedSimSpeed = std::clamp(requestedSimSpeed * std::pow(1.25, yoffset), kMinSimSpeed, kMaxSimSpeed);
+        SimCommand command;
+        command.type = SimCommand::Type::SetSimSpeed;
+        command.speed = requestedSimSpeed;
+        physicsThread.post(command);
     }
-    */
 }
 
 } // namespace SolarSim
@@ -0,0 +1,57 @@
+#include "integrator.h"
+
+#include <cstring>
+
+#include "simulationpolicies.h"
+
+namespace SolarSim {
+
+void integrate(BodySystem& bodies, double dt, Integrator scheme) {
+    // The same schemes Simulation<> compiles per combination, with the solver looked up
+    // at every force evaluation and nothing pinned
+    switch (scheme) {
+        case Integrator::SemiImplicitEuler:
+            EulerScheme::integrate<SelectedForces>(bodies, dt, NoPin{});
+            return;
+        case Integrator::Leapfrog:
+            LeapfrogScheme::integrate<SelectedForces>(bodies, dt, NoPin{});
+            return;
+        case Integrator::Yoshida4:
+            Yoshida4Scheme::integrate<SelectedForces>(bodies, dt, NoPin{});
+            return;
+        case Integrator::BlockLeapfrog:
+            BlockScheme::integrate<SelectedForces>(bodies, dt, NoPin{});
+            return;
+    }
+}
+
+int integratorForceEvals(Integrator scheme) {
+    return scheme == Integrator::Yoshida4 ? 3 : 1;
+}
+
+const char* integratorName(Integrator scheme) {
+    switch (scheme) {
+        case Integrator::SemiImplicitEuler: return "Semi-implicit Euler";
+        case Integrator::Leapfrog: return "Leapfrog";
+        case Integrator::Yoshida4: return "Yoshida 4";
+        case Integrator::BlockLeapfrog: return "Block leapfrog";
+    }
+    return "Unknown";
+}
+
+bool integratorFromName(const char* name, Integrator& scheme) {
+    if (std::strcmp(name, "euler") == 0) {
+        scheme = Integrator::SemiImplicitEuler;
+    } else if (std::strcmp(name, "leapfrog") == 0 || std::strcmp(name, "verlet") == 0) {
+        scheme = Integrator::Leapfrog;
+    } else if (std::strcmp(name, "yoshida4") == 0) {
+        scheme = Integrator::Yoshida4;
+    } else if (std::strcmp(name, "block") == 0) {
+        scheme = Integrator::BlockLeapfrog;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+} // namespace SolarSim
@@ -1,23 +1,109 @@
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <exception>
-#include <iomanip>
 #include <iostream>
 #include <numeric>
 #include <sstream>
+#include <string>
 #include <vector>
 
-#include "constants.h"
+#include "bodyrenderer.h"
 #include "globals.h"
 #include "input.h"
-#include "mass.h"
+#include "profiler.h"
 #include "rendering.h"
+#include "scene.h"
+#include "sceneloader.h"
+#include "sessionrecord.h"
+#include "simulation.h"
+#include "snapshot.h"
+#include "stepscheduler.h"
+#include "textformat.h"
+#include "trajectory.h"
 #include "utils.h"
 #include "window.h"
 
 using namespace SolarSim;
 
 // Destroy stuff ONLY when told
-int main() {
+int main(int argc, char** argv) {
+    // --threads N limits how many cores the simulation step uses (default: all of them)
+    // --render-threads N sets how many build the body draw list each frame (default: a quarter)
+    // --integrator euler|leapfrog|yoshida4|block picks the time integration scheme
+    // --collisions bounce|merge picks what touching bodies do
+    // --pin NAME holds the body called NAME in place (e.g. Earth)
+    // --load FILE starts from a snapshot instead of the Earth-Moon scene
+    // --scene FILE starts from a CSV / JSON body catalogue instead
+    // --checkpoint FILE / --checkpoint-every S set where F5 saves to and how often it autosaves
+    // --trajectory FILE / --trajectory-every N record every body's orbit every N steps
+    // --trace FILE sets where F6 exports the profiler trace
+    // --record FILE logs every input command with its sim frame (replay with solarsim-batch --replay)
+    // --seed S seeds the random sizes and names of spawned masses
+    // --speed X aims for X sim-seconds per wall-second (Shift+scroll changes it)
+    // --max-dt S caps the step size the speed is made up of (default 600)
+    // --step-budget MS sets how much of each 60 Hz tick the physics steps may use
+    std::string loadPath;
+    std::string scenePath;
+    std::string checkpointPath = "solarsim.snap";
+    double checkpointEvery = 0.0;
+    std::string trajectoryPath;
+    TrajectoryOptions trajectoryOptions;
+    std::string pinName;
+    std::string recordPath;
+    double stepBudgetMs = 12.5;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threadPool.resize(static_cast<unsigned>(std::max(0, std::atoi(argv[++i]))));
+        } else if (std::strcmp(argv[i], "--render-threads") == 0 && i + 1 < argc) {
+            renderPool.resize(static_cast<unsigned>(std::max(1, std::atoi(argv[++i]))));
+        } else if (std::strcmp(argv[i], "--integrator") == 0 && i + 1 < argc) {
+            if (!integratorFromName(argv[++i], integrator)) {
+                std::cerr << "Unknown integrator: " << argv[i] << '\n';
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(argv[i], "--collisions") == 0 && i + 1 < argc) {
+            if (!collisionModeFromName(argv[++i], collisionMode)) {
+                std::cerr << "Unknown collision mode: " << argv[i] << '\n';
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(argv[i], "--pin") == 0 && i + 1 < argc) {
+            pinName = argv[++i];
+        } else if (std::strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+            loadPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+            scenePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            checkpointPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--checkpoint-every") == 0 && i + 1 < argc) {
+            checkpointEvery = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--trajectory") == 0 && i + 1 < argc) {
+            trajectoryPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--trajectory-every") == 0 && i + 1 < argc) {
+            trajectoryOptions.everySteps = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            randomSeed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            randomGenerator.seed(randomSeed);
+        } else if (std::strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            simSpeed = std::clamp(std::atof(argv[++i]), kMinSimSpeed, kMaxSimSpeed);
+        } else if (std::strcmp(argv[i], "--max-dt") == 0 && i + 1 < argc) {
+            timeStepMult = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--step-budget") == 0 && i + 1 < argc) {
+            stepBudgetMs = std::atof(argv[++i]);
+        }
+    }
+    if (timeStepMult <= 0.0 || stepBudgetMs <= 0.0) {
+        std::cerr << "--max-dt and --step-budget must be positive\n";
+        return EXIT_FAILURE;
+    }
+    requestedSimSpeed = simSpeed;
+
     try {
         initWindow();
     } catch (const std::exception& e) {
@@ -27,149 +113,264 @@ int main() {
 
     glfwSetScrollCallback(window, scroll_callback);
 
-    int frame = 0;
-
-    // Create an instance of mass based off the sun
-    Mass sun;
-    sun.r = 0.75f; sun.g = 0.75f; sun.b = 0.0f;
-    sun.name = "Sun";
-    sun.mass = static_cast<float>(Constants::sunMass);
-    sun.radius = static_cast<float>(Constants::sunRadius * 20);
-    sun.x = -Constants::sunEarthDistance;
-    sun.vx = 0;
-    sun.init();
-
-    // Add sun to the vector of masses
-    // massesVector.push_back(sun);
-
-    // Create an instance of mass based off the earth
-    Mass earth;
-    earth.r = 0.0f; earth.g = 0.0f; earth.b = 1.0f;
-    earth.name = "Earth";
-    earth.mass = static_cast<float>(Constants::earthMass);
-    earth.radius = static_cast<float>(Constants::earthRadius);
-    earth.x = 0;
-    earth.vy = 0;
-    earth.init();
-
-    // Add earth to the vector of masses
-    massesVector.push_back(earth);
-
-    // Create an instance of mass based off the moon
-    Mass moon;
-    moon.r = 1.5f; moon.g = 1.5f; moon.b = 1.5f;
-    moon.name = "Moon";
-    moon.mass = static_cast<float>(Constants::moonMass);
-    moon.radius = static_cast<float>(Constants::moonRadius);
-    moon.x = Constants::earthMoonDistance;
-    moon.vy = Constants::moonTanVelocity;
-    moon.init();
-
-    // Add moon to the vector masses
-    massesVector.push_back(moon);
+    // Earth + Moon, unless there's a saved state or a catalogue to start from
+    if (loadPath.empty() && !scenePath.empty()) {
+        try {
+            SceneLoadStats loaded = loadSceneFile(scenePath, bodies);
+            std::cout << "Loaded " << loaded.bodies << " bodies from " << scenePath << " ("
+                      << loaded.megabytesPerSecond() << " MB/s)\n";
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to load scene: " << e.what() << '\n';
+            shutdownWindow();
+            return EXIT_FAILURE;
+        }
+    } else if (loadPath.empty()) {
+        loadDefaultScene(bodies);
+    } else {
+        try {
+            MappedSnapshot snapshot(loadPath);
+            snapshot.copyTo(bodies);
+            simFrame = snapshot.frame();
+            simSeconds = snapshot.seconds();
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to load snapshot: " << e.what() << '\n';
+            shutdownWindow();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!pinName.empty() && !pinBodyByName(bodies, pinName)) {
+        std::cerr << "No body called " << pinName << " to pin\n";
+        shutdownWindow();
+        return EXIT_FAILURE;
+    }
+    checkpointer.start(checkpointPath, checkpointEvery);
+
+    if (!trajectoryPath.empty()) {
+        try {
+            trajectoryWriter.start(trajectoryPath, trajectoryOptions);
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to start trajectory output: " << e.what() << '\n';
+            shutdownWindow();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!recordPath.empty()) {
+        SessionSettings settings;
+        settings.seed = randomSeed;
+        settings.dt = timeStepMult;
+        settings.speed = simSpeed;
+        settings.tickRate = kPhysicsTickRate;
+        settings.integrator = integrator;
+        settings.solver = forceSolver;
+        settings.collisions = collisionMode;
+        settings.theta = barnesHutTheta;
+        settings.meshGrid = particleMeshGrid;
+        settings.meshShortRange = particleMeshShortRange;
+        settings.scenePath = scenePath;
+        settings.loadPath = loadPath;
+        settings.pinName = pinName;
+        try {
+            sessionRecorder.start(recordPath, settings);
+            std::cout << "Recording input to " << recordPath << " (seed " << randomSeed << ")\n";
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to start input recording: " << e.what() << '\n';
+            shutdownWindow();
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Physics ticks at the old vsync rate on its own thread from here on, as many steps
+    // a tick as the requested speed needs and the budget allows; this loop only draws
+    // whatever snapshot it last published
+    physicsThread.start(bodies, kPhysicsTickRate, stepBudgetMs / 1000.0);
+    SnapshotInterpolator interpolator;
+    uint64_t shownSelectionSerial = 0;
+    std::vector<uint32_t> cursorBodies;
+    constexpr double kCursorReachPixels = 20.0;
+    if (kProfilerEnabled) profiler.nameThread("Render");
 
     while (!glfwWindowShouldClose(window)) {
+        SOLARSIM_PROFILE_SCOPE(ProfilePhase::Frame);
+
+        // Pick up the newest finished step, if there is one
+        bool newSnapshot = physicsThread.update();
+        const RenderSnapshot& snapshot = physicsThread.latest();
+        interpolator.advance(snapshot, newSnapshot);
+        if (newSnapshot) {
+            SOLARSIM_PROFILE_SCOPE(ProfilePhase::Index);
+            pickIndex.update(snapshot.size(), snapshot.x.data(), snapshot.y.data(), snapshot.radius.data(),
+                             snapshot.slot.data());
+        }
+        double blend = interpolator.blend(snapshot, physicsThread.tickInterval());
+
         // Check keypresses
         processInput(window);
 
         // Render loop
 
-        // If the camera should follow a mass set cam x and y to match the masses x and y
-        if (isCameraFollowMass && selectedMassIndex >= 0 &&
-            selectedMassIndex < static_cast<int>(massesVector.size())) {
-            camX = massesVector[selectedMassIndex].x;
-            camY = massesVector[selectedMassIndex].y;
+        // A pick landed on the physics thread, show what was hit. The selection is a handle
+        // on the physics side, so it changes too when the selected body merges away.
+        if (snapshot.selectionSerial != shownSelectionSerial) {
+            shownSelectionSerial = snapshot.selectionSerial;
+            if (snapshot.selectedIndex >= 0) {
+                std::ostringstream overlay;
+                overlay << "Name: " << snapshot.selectedName
+                        << "\nMass: " << formatScientific(snapshot.selectedMass) << " kg"
+                        << "\nRadius: " << formatScientific(snapshot.selectedRadius) << " m";
+                updateOverlayText(overlay.str());
+            } else {
+                clearOverlayText();
+                isCameraFollowMass = false;
+            }
+        }
+
+        // If the camera should follow a mass set cam x and y to match the masses x and y.
+        // selectedIndex is the selected handle resolved against this snapshot's layout.
+        if (isCameraFollowMass && snapshot.selectedIndex >= 0 &&
+            snapshot.selectedIndex < static_cast<int>(snapshot.size())) {
+            interpolator.position(snapshot, static_cast<size_t>(snapshot.selectedIndex), blend, camX, camY);
         }
 
         // Set bg color
         glClearColor(0.025f, 0.005f, 0.075f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        // Count amount of frames have passed
-        frame++;
-
-        // How many seconds have passed
-        double totalSimSeconds = frame * timeStepMult;
-
-        // Calculate days, hours, minutes, and seconds
-        int totalSeconds = static_cast<int>(totalSimSeconds);
-        int days = totalSeconds / 86400;
-        int hours = (totalSeconds % 86400) / 3600;
-        int minutes = (totalSeconds % 3600) / 60;
-        int seconds = totalSeconds % 60;
-
-        std::ostringstream timeStream;
-        timeStream << "Sim Time: "
-                   << days << "d "
-                   << std::setfill('0') << std::setw(2) << hours << "h "
-                   << std::setw(2) << minutes << "m "
-                   << std::setw(2) << seconds << "s";
-        timeOverlayText = timeStream.str();
-
-        // For each mass calculate the gravitational pull every other mass applies to itself then average it
-        for (size_t i = 0; i < massesVector.size(); ++i) {
-            Mass& m1 = massesVector[i];
-
-            std::vector<double> m1axVector;
-            std::vector<double> m1ayVector;
-
-            // Reset acceleration
-            m1.ax = 0.0;
-            m1.ay = 0.0;
-
-            // For every other mass
-            for (size_t j = 0; j < massesVector.size(); ++j) {
-                if (i == j) continue; // Don't pull yourself
-                Mass& m2 = massesVector[j]; // Get other mass
-                m1.calcAcceleration(m2.mass, m2.x, m2.y);
-
-                // Push the acceleration vectors the other mass is having on the first mass to the vector
-                m1axVector.push_back(m1.ax);
-                m1ayVector.push_back(m1.ay);
+        // Draw the masses in view: an instanced call per tessellation level, one for the sub-pixel ones
+        const BodyDrawStats* drawn;
+        {
+            SOLARSIM_PROFILE_SCOPE(ProfilePhase::Bodies);
+            drawn = &renderBodies(snapshot, interpolator, blend);
+        }
+
+        // Rebuilt in place every frame: clear() keeps the capacity, so once the HUD has
+        // been drawn a few times none of this touches the heap
+        std::string& hud = timeOverlayText;
+        hud.clear();
+        hud += "Sim Time: ";
+        appendSimTime(hud, snapshot.simSeconds);
+
+        // Achieved against requested speed, and what the scheduler made it out of
+        const ScheduleStats& schedule = snapshot.schedule;
+        hud += "\nSpeed: ";
+        appendGeneral(hud, schedule.achievedSpeed, 3);
+        hud += " of ";
+        appendGeneral(hud, schedule.requestedSpeed, 3);
+        hud += " sim-s/s, ";
+        appendInt(hud, schedule.stepsLastTick);
+        hud += " x ";
+        appendGeneral(hud, schedule.stepDt, 3);
+        hud += " s steps at ";
+        appendFixed(hud, schedule.stepCost * 1000.0, 2);
+        hud += " ms";
+        if (schedule.budgetLimited) hud += " (over budget)";
+        hud += "\nCollision pairs: ";
+        appendInt(hud, static_cast<long long>(snapshot.collisions.candidatePairs));
+        hud += " tested, ";
+        appendInt(hud, static_cast<long long>(snapshot.collisions.collisions));
+        hud += " hit (";
+        appendInt(hud, static_cast<long long>(snapshot.collisions.swept));
+        hud += " mid-step) in ";
+        appendInt(hud, static_cast<long long>(snapshot.collisions.islands));
+        hud += " islands";
+        hud += "\nDrawn: ";
+        appendInt(hud, static_cast<long long>(drawn->instanced));
+        hud += " circles, ";
+        appendInt(hud, static_cast<long long>(drawn->splatted));
+        hud += " in ";
+        appendInt(hud, static_cast<long long>(drawn->points));
+        hud += " points, ";
+        appendInt(hud, static_cast<long long>(drawn->culled));
+        hud += " culled";
+
+        // What's around the cursor, straight from the pick index: how far off the nearest
+        // body is and how many reach within kCursorReachPixels of it
+        {
+            double cursorX, cursorY, worldX, worldY, edgeX, edgeY, originX, originY;
+            int fbWidth, fbHeight;
+            glfwGetCursorPos(window, &cursorX, &cursorY);
+            glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+            screenToWorld(cursorX, cursorY, fbWidth, fbHeight, worldX, worldY);
+            screenToWorld(0.0, 0.0, fbWidth, fbHeight, originX, originY);
+            screenToWorld(kCursorReachPixels, 0.0, fbWidth, fbHeight, edgeX, edgeY);
+
+            pickIndex.nearest(worldX, worldY, 1, cursorBodies);
+            if (!cursorBodies.empty()) {
+                const double dx = snapshot.x[cursorBodies[0]] - worldX;
+                const double dy = snapshot.y[cursorBodies[0]] - worldY;
+                hud += "\nCursor: nearest body ";
+                appendGeneral(hud, std::sqrt(dx * dx + dy * dy), 3);
+                hud += " m off, ";
+                pickIndex.queryRadius(worldX, worldY, std::abs(edgeX - originX), cursorBodies);
+                appendInt(hud, static_cast<long long>(cursorBodies.size()));
+                hud += " within ";
+                appendInt(hud, static_cast<long long>(kCursorReachPixels));
+                hud += " px";
             }
+        }
 
-            // Average each masses acceleration vectors to get one vector
-            m1.ax = average(m1axVector);
-            m1.ay = average(m1ayVector);
+        // Block timesteps: how many bodies sit on each level (step = dt / 2^level)
+        if (snapshot.integrator == Integrator::BlockLeapfrog) {
+            hud += "\nStep levels:";
+            for (int level = 0; level < kStepLevels; ++level) {
+                if (snapshot.timesteps.bodiesAtLevel[level] == 0) continue;
+                hud += ' ';
+                appendInt(hud, level);
+                hud += ':';
+                appendInt(hud, static_cast<long long>(snapshot.timesteps.bodiesAtLevel[level]));
+            }
+            hud += " (";
+            appendInt(hud, static_cast<long long>(snapshot.timesteps.substeps));
+            hud += " substeps)";
         }
 
-        // Update each mass
-        // (uncomment the 2 lines in the for loop so that the earth doesn't move to simulate earth moon orbit)
-        for (Mass& m : massesVector) {
-            // if (m.name != "Earth") {
-            m.calcVelocity();
-            m.calcNewPos();
-            // }
-            m.updateVertices();
-            m.draw(shaderProgram);
+        // Trajectory output: size on disk per frame and how fast the writer thread gets through it
+        if (snapshot.recordingTrajectory) {
+            hud += "\nTrajectory: ";
+            appendGeneral(hud, snapshot.trajectory.lastFrameBytes / 1024.0, 3);
+            hud += " KB/frame, ";
+            appendGeneral(hud, snapshot.trajectory.writerMBPerSecond, 3);
+            hud += " MB/s, ";
+            appendInt(hud, static_cast<long long>(snapshot.trajectory.framesDropped));
+            hud += " dropped";
+            if (snapshot.trajectory.failed) hud += ", write failed, recording stopped";
         }
 
-        renderOverlayText();
-
-        // Check for collision and either bounce the objects or merge the masses
-        // (swap with line above or below the or is commented in order to swap between merge and bounce)
-        for (size_t i = 0; i < massesVector.size(); ++i) {
-            for (size_t j = i + 1; j < massesVector.size(); ++j) {
-                if (checkCollision(massesVector[i], massesVector[j])) {
-                    resolveCollision(massesVector[i], massesVector[j]);
-                    // OR
-                    // mergeMasses(massesVector[i], massesVector[j]);
-                }
+        // Rolling per-phase timings over the last few seconds (F6 exports them as a trace)
+        if (kProfilerEnabled) {
+            hud += "\nPhase ms (min / avg / p99):";
+            for (size_t p = 0; p < kProfilePhaseCount; ++p) {
+                ProfilePhase phase = static_cast<ProfilePhase>(p);
+                ProfileStats stats = profiler.stats(phase);
+                if (stats.samples == 0) continue;
+                hud += "\n  ";
+                hud += profilePhaseName(phase);
+                hud += ": ";
+                appendFixed(hud, stats.minMs, 2);
+                hud += " / ";
+                appendFixed(hud, stats.avgMs, 2);
+                hud += " / ";
+                appendFixed(hud, stats.p99Ms, 2);
             }
         }
 
-        // Only ran if masses merge, checks if mass is 0 then deletes it so it's not used
-        // in calculating acceleration of other masses
-        massesVector.erase(
-            std::remove_if(massesVector.begin(), massesVector.end(),
-                           [](const Mass& m){ return m.mass <= 0; }),
-            massesVector.end()
-        );
+        {
+            SOLARSIM_PROFILE_SCOPE(ProfilePhase::Text);
+            renderOverlayText();
+        }
 
         glfwPollEvents();
-        glfwSwapBuffers(window);
+        {
+            SOLARSIM_PROFILE_SCOPE(ProfilePhase::Swap);
+            glfwSwapBuffers(window);
+        }
     }
 
+    physicsThread.stop();
+    sessionRecorder.stop(simFrame);
+    checkpointer.stop();
+    trajectoryWriter.stop();
     shutdownWindow();
     return EXIT_SUCCESS;
 }
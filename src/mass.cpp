@@ -1,83 +1,13 @@
 #include "mass.h"
 
 #include <cmath>
-#include <vector>
 
+#include "bodysystem.h"
 #include "constants.h"
-#include "globals.h"
+#include "simglobals.h"
 
 namespace SolarSim {
 
-void Mass::init() {
-    // Vector of vertices
-    std::vector<float> vertices;
-
-    // (x, y, z) of the origin of the circle
-    vertices.push_back(static_cast<float>(x));
-    vertices.push_back(static_cast<float>(y));
-    vertices.push_back(0.0f);
-
-    // Create a triangle then rotate and make another to make a circle esque shape
-    for (int i = 0; i <= numOfVertices; ++i) {
-        float angle = 2.0f * static_cast<float>(M_PI) * i / numOfVertices;
-        vertices.push_back(radius * std::cos(angle) + static_cast<float>(x));
-        vertices.push_back(radius * std::sin(angle) + static_cast<float>(y));
-        vertices.push_back(0.0f);
-    }
-
-    // Create and assign VAO and VBO
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-
-    // Bind VAO and VBO, of and the buffer data
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_DYNAMIC_DRAW);
-
-    // Send the vertices
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-}
-
-void Mass::updateVertices() {
-    std::vector<float> vertices;
-
-    // Convert physical position (in meters) to OpenGL coordinates
-    // Subtract camera position, so that moving the camera left will move masses to the right
-    float drawX = static_cast<float>((x - camX) * screenScale);
-    float drawY = static_cast<float>((y - camY) * screenScale);
-    float drawRadius = static_cast<float>(radius * screenScale);
-
-    // Center of the mass
-    vertices.push_back(drawX);
-    vertices.push_back(drawY);
-    vertices.push_back(0.0f);
-
-    // Generate circle vertices around the center
-    for (int i = 0; i <= numOfVertices; ++i) {
-        float angle = 2.0f * static_cast<float>(M_PI) * i / numOfVertices;
-        vertices.push_back(drawRadius * std::cos(angle) + drawX);
-        vertices.push_back(drawRadius * std::sin(angle) + drawY);
-        vertices.push_back(0.0f);
-    }
-
-    // Update VBO with the new vertices
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(float), vertices.data());
-}
-
-void Mass::draw(unsigned int shader) {
-    glUseProgram(shader);
-
-    // Custom Color
-    int colorLoc = glGetUniformLocation(shader, "uColor");
-    glUniform3f(colorLoc, r, g, b);
-
-    // Bind the Vertex Array Object to it's target and draw the arrays
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLE_FAN, 0, numOfVertices + 2);
-}
-
 void Mass::calcAcceleration(double otherMass, double otherX, double otherY) {
     double dx = otherX - x;
     double dy = otherY - y;
@@ -98,70 +28,152 @@ void Mass::calcNewPos() {
     y += (vy * timeStepMult);
 }
 
-bool checkCollision(const Mass& m1, const Mass& m2) {
-    double dx = m1.x - m2.x;
-    double dy = m1.y - m2.y;
+bool checkCollision(const BodySystem& bodies, size_t i, size_t j) {
+    double dx = bodies.x[i] - bodies.x[j];
+    double dy = bodies.y[i] - bodies.y[j];
 
     double distSq = dx * dx + dy * dy;
-    double minDist = m1.radius + m2.radius;
+    double minDist = bodies.radius[i] + bodies.radius[j];
 
     return distSq < (minDist * minDist);
 }
 
-void resolveCollision(Mass& m1, Mass& m2) {
-    double dx = m1.x - m2.x;
-    double dy = m1.y - m2.y;
-    double dist = std::sqrt(dx * dx + dy * dy);
-
-    if (dist == 0.0) return; // avoid divide by zero
-
-    // Normal vector
-    double nx = dx / dist;
-    double ny = dy / dist;
+namespace {
 
+// Elastic impulse along the unit normal (nx, ny) pointing from j to i.
+// Returns false, leaving the velocities alone, if the pair is already separating.
+bool applyBounceImpulse(BodySystem& bodies, size_t i, size_t j, double nx, double ny) {
     // Relative velocity
-    double vx = m1.vx - m2.vx;
-    double vy = m1.vy - m2.vy;
+    double vx = bodies.vx[i] - bodies.vx[j];
+    double vy = bodies.vy[i] - bodies.vy[j];
 
     // Relative velocity in terms of normal direction
     double relVel = vx * nx + vy * ny;
 
     // Only resolve if they are moving toward each other
-    if (relVel > 0) return;
+    if (relVel > 0) return false;
+
+    const double m1 = bodies.mass[i];
+    const double m2 = bodies.mass[j];
 
     // Elastic collision impulse
     double e = 1.0; // coefficient of restitution (1 = perfectly elastic. adjust as you want)
-    double j = -(1 + e) * relVel / (1 / m1.mass + 1 / m2.mass);
+    double impulse = -(1 + e) * relVel / (1 / m1 + 1 / m2);
 
     // Apply impulse
-    double impulseX = j * nx;
-    double impulseY = j * ny;
+    double impulseX = impulse * nx;
+    double impulseY = impulse * ny;
 
     // Change velocities based on elastic collision
-    m1.vx += impulseX / m1.mass;
-    m1.vy += impulseY / m1.mass;
-    m2.vx -= impulseX / m2.mass;
-    m2.vy -= impulseY / m2.mass;
+    bodies.vx[i] += impulseX / m1;
+    bodies.vy[i] += impulseY / m1;
+    bodies.vx[j] -= impulseX / m2;
+    bodies.vy[j] -= impulseY / m2;
+    return true;
+}
+
+// Puts both bodies back where they were `t` of the way through the step
+void rewindTo(BodySystem& bodies, const double* startX, const double* startY, size_t i, double t) {
+    bodies.x[i] = startX[i] + (bodies.x[i] - startX[i]) * t;
+    bodies.y[i] = startY[i] + (bodies.y[i] - startY[i]) * t;
+}
+
+} // namespace
+
+void resolveCollision(BodySystem& bodies, size_t i, size_t j) {
+    double dx = bodies.x[i] - bodies.x[j];
+    double dy = bodies.y[i] - bodies.y[j];
+    double dist = std::sqrt(dx * dx + dy * dy);
+
+    if (dist == 0.0) return; // avoid divide by zero
+
+    // Normal vector
+    double nx = dx / dist;
+    double ny = dy / dist;
+
+    if (!applyBounceImpulse(bodies, i, j, nx, ny)) return;
 
     // Push them apart slightly so they don’t sink into each other
-    double overlap = (m1.radius + m2.radius) - dist;
-    m1.x += (overlap / 2) * nx;
-    m1.y += (overlap / 2) * ny;
-    m2.x -= (overlap / 2) * nx;
-    m2.y -= (overlap / 2) * ny;
+    double overlap = (bodies.radius[i] + bodies.radius[j]) - dist;
+    bodies.x[i] += (overlap / 2) * nx;
+    bodies.y[i] += (overlap / 2) * ny;
+    bodies.x[j] -= (overlap / 2) * nx;
+    bodies.y[j] -= (overlap / 2) * ny;
+}
+
+double sweptCollisionTime(const BodySystem& bodies, const double* startX, const double* startY, size_t i, size_t j) {
+    // Separation d(t) = d0 + e t for t in [0, 1]; solve |d(t)| = ri + rj for the first root
+    const double d0x = startX[i] - startX[j];
+    const double d0y = startY[i] - startY[j];
+    const double ex = (bodies.x[i] - bodies.x[j]) - d0x;
+    const double ey = (bodies.y[i] - bodies.y[j]) - d0y;
+    const double reach = static_cast<double>(bodies.radius[i]) + bodies.radius[j];
+
+    const double c = d0x * d0x + d0y * d0y - reach * reach;
+    if (c <= 0.0) return -1.0; // touching already when the step began
+
+    const double a = ex * ex + ey * ey;
+    const double b = 2.0 * (d0x * ex + d0y * ey);
+    if (a == 0.0 || b >= 0.0) return -1.0; // not closing in
+
+    const double disc = b * b - 4.0 * a * c;
+    if (disc < 0.0) return -1.0; // closest approach stays wider than the radii
+
+    // Smaller root, written as 2c / (-b + sqrt(disc)) so it keeps its precision when c is tiny
+    const double t = 2.0 * c / (-b + std::sqrt(disc));
+    return t <= 1.0 ? t : -1.0;
+}
+
+void resolveCollisionAt(BodySystem& bodies, const double* startX, const double* startY, size_t i, size_t j,
+                        double t, double dt) {
+    const double endX[2] = {bodies.x[i], bodies.x[j]};
+    const double endY[2] = {bodies.y[i], bodies.y[j]};
+    rewindTo(bodies, startX, startY, i, t);
+    rewindTo(bodies, startX, startY, j, t);
+
+    double dx = bodies.x[i] - bodies.x[j];
+    double dy = bodies.y[i] - bodies.y[j];
+    double dist = std::sqrt(dx * dx + dy * dy);
+
+    // Already separating at contact (gravity bent the path): leave the step as it was
+    if (dist == 0.0 || !applyBounceImpulse(bodies, i, j, dx / dist, dy / dist)) {
+        bodies.x[i] = endX[0];
+        bodies.y[i] = endY[0];
+        bodies.x[j] = endX[1];
+        bodies.y[j] = endY[1];
+        return;
+    }
+
+    // Spend the rest of the step on the new velocities
+    const double remaining = (1.0 - t) * dt;
+    bodies.x[i] += bodies.vx[i] * remaining;
+    bodies.y[i] += bodies.vy[i] * remaining;
+    bodies.x[j] += bodies.vx[j] * remaining;
+    bodies.y[j] += bodies.vy[j] * remaining;
+}
+
+void mergeMassesAt(BodySystem& bodies, const double* startX, const double* startY, size_t i, size_t j,
+                   double t, double dt) {
+    // The merged body continues from i's point of contact
+    rewindTo(bodies, startX, startY, i, t);
+    mergeMasses(bodies, i, j);
+
+    const double remaining = (1.0 - t) * dt;
+    bodies.x[i] += bodies.vx[i] * remaining;
+    bodies.y[i] += bodies.vy[i] * remaining;
 }
 
-void mergeMasses(Mass& m1, Mass& m2) {
+void mergeMasses(BodySystem& bodies, size_t i, size_t j) {
     // conserve momentum
-    double totalMass = m1.mass + m2.mass;
-    m1.vx = (m1.vx * m1.mass + m2.vx * m2.mass) / totalMass;
-    m1.vy = (m1.vy * m1.mass + m2.vy * m2.mass) / totalMass;
+    double totalMass = bodies.mass[i] + bodies.mass[j];
+    bodies.vx[i] = (bodies.vx[i] * bodies.mass[i] + bodies.vx[j] * bodies.mass[j]) / totalMass;
+    bodies.vy[i] = (bodies.vy[i] * bodies.mass[i] + bodies.vy[j] * bodies.mass[j]) / totalMass;
 
     // Set the new mass and radius based on the 2 masses total mass and approximate volume
-    m1.mass = totalMass;
-    m1.radius = std::cbrt(std::pow(m1.radius, 3) + std::pow(m2.radius, 3)); // approximate volume merge
+    bodies.mass[i] = static_cast<float>(totalMass);
+    bodies.radius[i] = static_cast<float>(std::cbrt(std::pow(bodies.radius[i], 3) + std::pow(bodies.radius[j], 3))); // approximate volume merge
 
-    m2.mass = 0; // mark m2 as dead :(
+    bodies.mass[j] = 0; // mark j as dead :(
 }
 
 } // namespace SolarSim
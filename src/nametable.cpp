@@ -0,0 +1,67 @@
+#include "nametable.h"
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+namespace SolarSim {
+
+namespace {
+
+// Split by hash so loader threads interning at the same time rarely share a lock
+constexpr size_t kShardCount = 64;
+
+struct Shard {
+    std::mutex lock;
+    std::deque<std::string> strings; // deque never moves what it already holds
+    std::unordered_map<std::string_view, const std::string*> lookup;
+};
+
+Shard* shards() {
+    static Shard table[kShardCount];
+    return table;
+}
+
+const std::string& emptyName() {
+    static const std::string empty;
+    return empty;
+}
+
+} // namespace
+
+InternedName& InternedName::operator=(std::string_view value) {
+    *this = internName(value);
+    return *this;
+}
+
+const std::string& InternedName::str() const {
+    return text ? *text : emptyName();
+}
+
+InternedName internName(std::string_view value) {
+    InternedName name;
+    if (value.empty()) return name;
+
+    Shard& shard = shards()[std::hash<std::string_view>{}(value) % kShardCount];
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    auto found = shard.lookup.find(value);
+    if (found == shard.lookup.end()) {
+        const std::string& stored = shard.strings.emplace_back(value);
+        found = shard.lookup.emplace(std::string_view(stored), &stored).first;
+    }
+    name.text = found->second;
+    return name;
+}
+
+size_t internedNameCount() {
+    size_t count = 0;
+    for (size_t i = 0; i < kShardCount; ++i) {
+        std::lock_guard<std::mutex> guard(shards()[i].lock);
+        count += shards()[i].strings.size();
+    }
+    return count;
+}
+
+} // namespace SolarSim
@@ -0,0 +1,251 @@
+#include "particlemesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#include "bodysystem.h"
+#include "constants.h"
+#include "simglobals.h"
+
+namespace SolarSim {
+
+namespace {
+
+// Grid rows per parallel chunk of the FFT passes, bodies per chunk of the read back
+constexpr size_t kRowGrain = 4;
+constexpr size_t kReadBackGrain = 1024;
+
+// Samples of the short-range share table, evenly spaced in squared distance
+constexpr size_t kShareSamples = 4096;
+
+// Fraction of a point mass's pull at `cells` away that the mesh carries once the force
+// is split: the pull of a Gaussian cloud of scale 2 * kMeshSplitCells instead of a point
+double longRangeShare(double cells) {
+    const double pi = std::acos(-1.0);
+    const double scaled = cells / (2.0 * kMeshSplitCells);
+    return std::erf(scaled) - 2.0 * scaled / std::sqrt(pi) * std::exp(-scaled * scaled);
+}
+
+// Runs the same 1D transform over rows [0, rows) of a padded x padded grid
+void transformRows(const FFT& fft, Complex* data, size_t padded, size_t rows, bool inverse) {
+    threadPool.parallelFor(0, rows, kRowGrain, [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; ++row) {
+            if (inverse) {
+                fft.inverse(data + row * padded);
+            } else {
+                fft.forward(data + row * padded);
+            }
+        }
+    });
+}
+
+} // namespace
+
+void ParticleMesh::prepareKernel(size_t gridSize, bool shortRange) {
+    if (gridSize < kMinMeshGrid || gridSize > kMaxMeshGrid || (gridSize & (gridSize - 1)) != 0) {
+        throw std::runtime_error("Particle-mesh grid must be a power of two between " +
+                                 std::to_string(kMinMeshGrid) + " and " + std::to_string(kMaxMeshGrid));
+    }
+    grid = gridSize;
+    padded = gridSize * 2;
+    kernelShortRange = shortRange;
+    fft.resize(padded);
+
+    // Offsets past the middle of the padded grid wrap around to negative ones. The cell
+    // a body deposits into doesn't pull on itself.
+    kernel.assign(padded * padded, Complex());
+    for (size_t row = 0; row < padded; ++row) {
+        const double dy = row < grid ? static_cast<double>(row) : static_cast<double>(row) - static_cast<double>(padded);
+        for (size_t col = 0; col < padded; ++col) {
+            const double dx = col < grid ? static_cast<double>(col) : static_cast<double>(col) - static_cast<double>(padded);
+            const double distSquared = dx * dx + dy * dy;
+            if (distSquared == 0.0) continue;
+            const double dist = std::sqrt(distSquared);
+            double inverseCube = 1.0 / (distSquared * dist);
+            if (shortRange) inverseCube *= longRangeShare(dist);
+            kernel[row * padded + col] = Complex(-dx * inverseCube, -dy * inverseCube);
+        }
+    }
+
+    transformRows(fft, kernel.data(), padded, padded, false);
+    transposeSquare(kernel.data(), padded);
+    transformRows(fft, kernel.data(), padded, padded, false);
+
+    if (shortRange && shortRangeShare.empty()) {
+        shortRangeShare.resize(kShareSamples + 1);
+        for (size_t k = 0; k <= kShareSamples; ++k) {
+            const double distSquared = kMeshCutoffCells * kMeshCutoffCells * static_cast<double>(k) / kShareSamples;
+            shortRangeShare[k] = 1.0 - longRangeShare(std::sqrt(distSquared));
+        }
+    }
+}
+
+void ParticleMesh::buildNeighbourCells(const BodySystem& bodies) {
+    // Cells one cutoff wide, so every neighbour in range is in the 3 x 3 block around a body
+    neighbourCell = kMeshCutoffCells * cell;
+    const double span = static_cast<double>(grid) * cell;
+    neighbourWidth = neighbourHeight = static_cast<size_t>(span / neighbourCell) + 1;
+
+    // Counting sort by cell, so bodies keep index order inside a cell
+    cellOfBody.resize(bodies.size());
+    cellStart.assign(neighbourWidth * neighbourHeight + 1, 0);
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        const size_t col = std::min(static_cast<size_t>((bodies.x[i] - originX) / neighbourCell), neighbourWidth - 1);
+        const size_t row = std::min(static_cast<size_t>((bodies.y[i] - originY) / neighbourCell), neighbourHeight - 1);
+        cellOfBody[i] = static_cast<uint32_t>(row * neighbourWidth + col);
+        cellStart[cellOfBody[i] + 1]++;
+    }
+    for (size_t c = 1; c < cellStart.size(); ++c) cellStart[c] += cellStart[c - 1];
+
+    cellBodies.resize(bodies.size());
+    cellCursor.assign(cellStart.begin(), cellStart.end() - 1);
+    for (size_t i = 0; i < bodies.size(); ++i) cellBodies[cellCursor[cellOfBody[i]]++] = static_cast<uint32_t>(i);
+}
+
+void ParticleMesh::solve(const BodySystem& bodies, size_t gridSize, bool shortRange) {
+    if (gridSize != grid || shortRange != kernelShortRange) prepareKernel(gridSize, shortRange);
+    withShortRange = shortRange;
+
+    // Square mesh around every body, with half a cell spare on each side so all four
+    // cloud-in-cell neighbours of any body are on the grid
+    double minX = bodies.x[0], maxX = bodies.x[0];
+    double minY = bodies.y[0], maxY = bodies.y[0];
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        minX = std::min(minX, bodies.x[i]); maxX = std::max(maxX, bodies.x[i]);
+        minY = std::min(minY, bodies.y[i]); maxY = std::max(maxY, bodies.y[i]);
+    }
+    double side = std::max(maxX - minX, maxY - minY);
+    if (side <= 0.0) side = 1.0;
+    cell = side / static_cast<double>(grid - 2);
+    originX = minX - 0.5 * cell;
+    originY = minY - 0.5 * cell;
+
+    // Cloud-in-cell: each mass is shared between the four grid points around it by area.
+    // Serial, so the sums come out the same on any thread count.
+    field.assign(padded * padded, Complex());
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        const double u = (bodies.x[i] - originX) / cell;
+        const double v = (bodies.y[i] - originY) / cell;
+        const size_t col = std::min(static_cast<size_t>(u), grid - 2);
+        const size_t row = std::min(static_cast<size_t>(v), grid - 2);
+        const double fx = u - static_cast<double>(col);
+        const double fy = v - static_cast<double>(row);
+        const double m = bodies.mass[i];
+
+        Complex* cellRow = field.data() + row * padded + col;
+        cellRow[0] += m * (1.0 - fx) * (1.0 - fy);
+        cellRow[1] += m * fx * (1.0 - fy);
+        cellRow[padded] += m * (1.0 - fx) * fy;
+        cellRow[padded + 1] += m * fx * fy;
+    }
+
+    // Forward 2D transform. Only the first `grid` rows hold any mass, the rest are padding.
+    // The spectrum is left transposed, the same way the kernel's was, and the inverse
+    // transposes back.
+    transformRows(fft, field.data(), padded, grid, false);
+    transposeSquare(field.data(), padded);
+    transformRows(fft, field.data(), padded, padded, false);
+
+    threadPool.parallelFor(0, padded, kRowGrain, [&](size_t begin, size_t end) {
+        for (size_t k = begin * padded; k < end * padded; ++k) {
+            const double ar = field[k].real(), ai = field[k].imag();
+            const double br = kernel[k].real(), bi = kernel[k].imag();
+            field[k] = Complex(ar * br - ai * bi, ar * bi + ai * br);
+        }
+    });
+
+    // Only the first `grid` rows of the result lie on the mesh
+    transformRows(fft, field.data(), padded, padded, true);
+    transposeSquare(field.data(), padded);
+    transformRows(fft, field.data(), padded, grid, true);
+
+    const double cells = static_cast<double>(padded) * static_cast<double>(padded);
+    fieldScale = Constants::G / (cell * cell) / cells;
+
+    if (shortRange) buildNeighbourCells(bodies);
+}
+
+void ParticleMesh::accelerationAt(const BodySystem& bodies, size_t i, double& outAx, double& outAy) const {
+    const double px = bodies.x[i];
+    const double py = bodies.y[i];
+    const double u = (px - originX) / cell;
+    const double v = (py - originY) / cell;
+    const size_t col = std::min(static_cast<size_t>(u), grid - 2);
+    const size_t row = std::min(static_cast<size_t>(v), grid - 2);
+    const double fx = u - static_cast<double>(col);
+    const double fy = v - static_cast<double>(row);
+
+    const Complex* cellRow = field.data() + row * padded + col;
+    const Complex a = cellRow[0] * ((1.0 - fx) * (1.0 - fy)) + cellRow[1] * (fx * (1.0 - fy)) +
+                      cellRow[padded] * ((1.0 - fx) * fy) + cellRow[padded + 1] * (fx * fy);
+    outAx = a.real() * fieldScale;
+    outAy = a.imag() * fieldScale;
+    if (!withShortRange) return;
+
+    // Whatever the mesh left out of the pulls of every body within the cutoff,
+    // visiting the 3 x 3 neighbour cells (and the bodies in them) in a fixed order
+    const double cutoffSquared = neighbourCell * neighbourCell;
+    const double toTable = static_cast<double>(kShareSamples) / cutoffSquared;
+    const size_t home = cellOfBody[i];
+    const size_t homeCol = home % neighbourWidth;
+    const size_t homeRow = home / neighbourWidth;
+    double sumAx = 0.0;
+    double sumAy = 0.0;
+    for (size_t r = homeRow > 0 ? homeRow - 1 : 0; r <= std::min(homeRow + 1, neighbourHeight - 1); ++r) {
+        for (size_t c = homeCol > 0 ? homeCol - 1 : 0; c <= std::min(homeCol + 1, neighbourWidth - 1); ++c) {
+            const size_t neighbour = r * neighbourWidth + c;
+            for (uint32_t k = cellStart[neighbour]; k < cellStart[neighbour + 1]; ++k) {
+                const uint32_t j = cellBodies[k];
+                const double dx = bodies.x[j] - px;
+                const double dy = bodies.y[j] - py;
+                const double distSquared = dx * dx + dy * dy;
+                if (distSquared == 0.0 || distSquared >= cutoffSquared) continue; // yourself, or out of reach
+
+                const double sample = distSquared * toTable;
+                const size_t lower = std::min(static_cast<size_t>(sample), kShareSamples - 1);
+                const double t = sample - static_cast<double>(lower);
+                const double share = shortRangeShare[lower] + (shortRangeShare[lower + 1] - shortRangeShare[lower]) * t;
+
+                const double dist = std::sqrt(distSquared);
+                const double force = Constants::G * bodies.mass[j] / distSquared * share;
+                sumAx += force * dx / dist;
+                sumAy += force * dy / dist;
+            }
+        }
+    }
+    outAx += sumAx;
+    outAy += sumAy;
+}
+
+void ParticleMesh::computeAccelerations(BodySystem& bodies, size_t gridSize, bool shortRange) {
+    if (bodies.size() < 2) {
+        std::fill(bodies.ax.begin(), bodies.ax.end(), 0.0);
+        std::fill(bodies.ay.begin(), bodies.ay.end(), 0.0);
+        return;
+    }
+
+    solve(bodies, gridSize, shortRange);
+    threadPool.parallelFor(0, bodies.size(), kReadBackGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) accelerationAt(bodies, i, bodies.ax[i], bodies.ay[i]);
+    });
+}
+
+void ParticleMesh::computeAccelerations(BodySystem& bodies, const std::vector<uint32_t>& targets, size_t gridSize,
+                                        bool shortRange) {
+    if (bodies.size() < 2) {
+        for (uint32_t i : targets) bodies.ax[i] = bodies.ay[i] = 0.0;
+        return;
+    }
+
+    solve(bodies, gridSize, shortRange);
+    threadPool.parallelFor(0, targets.size(), kReadBackGrain, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            const uint32_t i = targets[k];
+            accelerationAt(bodies, i, bodies.ax[i], bodies.ay[i]);
+        }
+    });
+}
+
+} // namespace SolarSim
@@ -0,0 +1,229 @@
+#include "physicsthread.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "bodysystem.h"
+#include "profiler.h"
+#include "simglobals.h"
+#include "simulation.h"
+
+namespace SolarSim {
+
+void CommandQueue::push(const SimCommand& command) {
+    std::lock_guard<std::mutex> guard(lock);
+    pending.push_back(command);
+}
+
+void CommandQueue::drain(std::vector<SimCommand>& out) {
+    out.clear();
+    std::lock_guard<std::mutex> guard(lock);
+    out.swap(pending);
+}
+
+bool applyCommand(BodySystem& bodies, const SimCommand& command, BodyHandle& selected) {
+    bool picked = false;
+    switch (command.type) {
+        case SimCommand::Type::SpawnMass:
+            bodies.add(command.mass);
+            break;
+
+        case SimCommand::Type::SelectAt: {
+            // With the tree broad phase the index is refreshed after every step; otherwise
+            // (or after bodies were added, or a scene loaded) it's brought up to date here
+            if (!spatialIndex.matches(bodies)) spatialIndex.update(bodies, 0.0);
+            const int hit = spatialIndex.pick(command.x, command.y);
+            if (hit < 0) break;
+
+            const size_t i = static_cast<size_t>(hit);
+            selected = bodies.handle(i);
+            picked = true;
+
+            // If clicked mass has no name assign it a name
+            if (bodies.info[i].name.empty()) {
+                bodies.info[i].name = "[UNKNOWN]";
+            }
+            break;
+        }
+
+        case SimCommand::Type::SetForceSolver:
+            forceSolver = command.solver;
+            break;
+
+        case SimCommand::Type::SetSimSpeed:
+            simSpeed = std::clamp(command.speed, kMinSimSpeed, kMaxSimSpeed);
+            break;
+
+        case SimCommand::Type::SaveCheckpoint:
+            // Nowhere to write it (a replay run without --checkpoint)
+            if (!checkpointer.enabled()) break;
+            if (!checkpointer.checkpoint(bodies, simFrame, simSeconds)) {
+                std::cout << "Checkpoint skipped, the last one is still being written\n";
+            }
+            break;
+    }
+    return picked;
+}
+
+PhysicsThread::~PhysicsThread() {
+    stop();
+}
+
+void PhysicsThread::start(BodySystem& system, double rate, double stepBudget) {
+    stop();
+    bodies = &system;
+    ticksPerSecond = rate > 0.0 ? rate : 60.0;
+    scheduler.setBudget(stepBudget > 0.0 ? stepBudget : 0.75 / ticksPerSecond);
+
+    // Make sure the renderer has something to draw before the first step lands
+    publish();
+
+    running = true;
+    thread = std::thread(&PhysicsThread::run, this);
+}
+
+void PhysicsThread::stop() {
+    running = false;
+    if (thread.joinable()) thread.join();
+}
+
+void PhysicsThread::run() {
+    using Clock = std::chrono::steady_clock;
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / ticksPerSecond));
+    auto next = Clock::now();
+    auto lastTick = next;
+    if (kProfilerEnabled) profiler.nameThread("Physics");
+
+    while (running) {
+        // Commands land between ticks, so every step of a tick has the same size
+        applyCommands();
+
+        const auto tickStart = Clock::now();
+        scheduler.beginTick(simSpeed, timeStepMult, ticksPerSecond);
+        while (scheduler.wantsStep(std::chrono::duration<double>(Clock::now() - tickStart).count())) {
+            const auto stepStart = Clock::now();
+            stepSimulation(*bodies, scheduler.stepDt());
+
+            // Both only cost a copy of the columns when due, the writing happens elsewhere
+            {
+                SOLARSIM_PROFILE_SCOPE(ProfilePhase::Output);
+                checkpointer.maybeCheckpoint(*bodies, simFrame, simSeconds);
+                trajectoryWriter.record(*bodies, simFrame, simSeconds);
+            }
+            scheduler.stepDone(std::chrono::duration<double>(Clock::now() - stepStart).count());
+        }
+        const auto tickEnd = Clock::now();
+        scheduler.endTick(std::chrono::duration<double>(tickEnd - lastTick).count());
+        lastTick = tickEnd;
+
+        {
+            SOLARSIM_PROFILE_SCOPE(ProfilePhase::Publish);
+            publish();
+        }
+
+        // If a tick ran long don't try to catch up with a burst of ticks; the
+        // scheduler has already dropped whatever sim time it couldn't fit
+        next += period;
+        auto now = Clock::now();
+        if (now > next + period * 4) next = now;
+        std::this_thread::sleep_until(next);
+    }
+}
+
+void PhysicsThread::applyCommands() {
+    commands.drain(drained);
+
+    for (const SimCommand& command : drained) {
+        sessionRecorder.record(simFrame, command);
+        if (applyCommand(*bodies, command, selected)) selectionSerial++;
+    }
+}
+
+void PhysicsThread::publish() {
+    RenderSnapshot& snapshot = snapshots.writeBuffer();
+    const BodySystem& system = *bodies;
+    const size_t n = system.size();
+
+    snapshot.x.assign(system.x.begin(), system.x.end());
+    snapshot.y.assign(system.y.begin(), system.y.end());
+    snapshot.radius.assign(system.radius.begin(), system.radius.end());
+    snapshot.slot.assign(system.slotOf.begin(), system.slotOf.end());
+    snapshot.r.resize(n);
+    snapshot.g.resize(n);
+    snapshot.b.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        snapshot.r[i] = system.info[i].r;
+        snapshot.g[i] = system.info[i].g;
+        snapshot.b[i] = system.info[i].b;
+    }
+
+    snapshot.frame = simFrame;
+    snapshot.simSeconds = simSeconds;
+    snapshot.collisions = collisionStats;
+    snapshot.forceSolver = forceSolver;
+    snapshot.integrator = integrator;
+    snapshot.timesteps = timestepStats;
+    snapshot.schedule = scheduler.stats();
+    snapshot.recordingTrajectory = trajectoryWriter.enabled();
+    if (snapshot.recordingTrajectory) snapshot.trajectory = trajectoryWriter.stats();
+
+    snapshot.layoutVersion = system.layoutVersion();
+
+    // Resolve the selection against this step's layout; a body that merged away drops it
+    size_t selectedIndex = 0;
+    if (!selected.isNull() && !system.find(selected, selectedIndex)) {
+        selected = BodyHandle{};
+        selectionSerial++;
+    }
+    snapshot.selected = selected;
+    snapshot.selectedIndex = selected.isNull() ? -1 : static_cast<int>(selectedIndex);
+    snapshot.selectionSerial = selectionSerial;
+    if (!selected.isNull()) {
+        snapshot.selectedName = system.info[selectedIndex].name;
+        snapshot.selectedMass = system.mass[selectedIndex];
+        snapshot.selectedRadius = system.radius[selectedIndex];
+    }
+
+    snapshot.publishTime = std::chrono::steady_clock::now();
+    snapshots.publish();
+}
+
+void SnapshotInterpolator::advance(const RenderSnapshot& latest, bool changed) {
+    if (!changed) return;
+    previousX.swap(currentX);
+    previousY.swap(currentY);
+    previousLayout = currentLayout;
+    currentX.assign(latest.x.begin(), latest.x.end());
+    currentY.assign(latest.y.begin(), latest.y.end());
+    currentLayout = latest.layoutVersion;
+}
+
+double SnapshotInterpolator::blend(const RenderSnapshot& latest, double tickInterval) const {
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - latest.publishTime).count();
+    return std::clamp(elapsed / tickInterval, 0.0, 1.0);
+}
+
+void SnapshotInterpolator::position(const RenderSnapshot& latest, size_t i, double blend, double& x, double& y) const {
+    if (previousLayout != latest.layoutVersion || previousX.size() != latest.size()) {
+        x = latest.x[i];
+        y = latest.y[i];
+        return;
+    }
+    x = previousX[i] + (latest.x[i] - previousX[i]) * blend;
+    y = previousY[i] + (latest.y[i] - previousY[i]) * blend;
+}
+
+void SnapshotInterpolator::positions(const RenderSnapshot& latest, size_t begin, size_t end, double blend, double* x,
+                                     double* y) const {
+    if (previousLayout != latest.layoutVersion || previousX.size() != latest.size()) {
+        std::copy(latest.x.begin() + begin, latest.x.begin() + end, x);
+        std::copy(latest.y.begin() + begin, latest.y.begin() + end, y);
+        return;
+    }
+    for (size_t i = begin; i < end; ++i) {
+        x[i - begin] = previousX[i] + (latest.x[i] - previousX[i]) * blend;
+        y[i - begin] = previousY[i] + (latest.y[i] - previousY[i]) * blend;
+    }
+}
+
+} // namespace SolarSim
@@ -0,0 +1,160 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include "simglobals.h"
+
+namespace SolarSim {
+
+namespace {
+
+// Index the calling thread got from each profiler, -1 until it records something.
+// Only one profiler exists in practice, so a single slot per thread is enough.
+thread_local const Profiler* threadOwner = nullptr;
+thread_local int threadSlot = -1;
+
+const char* phaseCategory(ProfilePhase phase) {
+    return static_cast<int>(phase) < static_cast<int>(ProfilePhase::Frame) ? "physics" : "render";
+}
+
+} // namespace
+
+const char* profilePhaseName(ProfilePhase phase) {
+    switch (phase) {
+        case ProfilePhase::Step: return "Step";
+        case ProfilePhase::Integrate: return "Integrate";
+        case ProfilePhase::Gravity: return "Gravity";
+        case ProfilePhase::Collisions: return "Collisions";
+        case ProfilePhase::RemoveDead: return "Remove dead";
+        case ProfilePhase::Index: return "Spatial index";
+        case ProfilePhase::Publish: return "Publish";
+        case ProfilePhase::Output: return "Output";
+        case ProfilePhase::Frame: return "Frame";
+        case ProfilePhase::Bodies: return "Bodies";
+        case ProfilePhase::Text: return "Text";
+        case ProfilePhase::Swap: return "Swap";
+        case ProfilePhase::Count: break;
+    }
+    return "Unknown";
+}
+
+Profiler::Profiler() : origin(Clock::now()) {}
+
+uint16_t Profiler::threadIndex() {
+    if (threadOwner != this) {
+        threadOwner = this;
+        threadSlot = static_cast<int>(threadNames.size());
+        threadNames.push_back("Thread " + std::to_string(threadSlot));
+    }
+    return static_cast<uint16_t>(threadSlot);
+}
+
+void Profiler::record(ProfilePhase phase, Clock::time_point start, Clock::time_point end) {
+    const int64_t durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+    std::lock_guard<std::mutex> guard(lock);
+    const int64_t startNs = std::chrono::duration_cast<std::chrono::nanoseconds>(start - origin).count();
+
+    History& h = history[static_cast<size_t>(phase)];
+    h.ms[h.next] = static_cast<float>(durationNs * 1e-6);
+    h.next = (h.next + 1) % kHistory;
+    h.count = std::min(h.count + 1, kHistory);
+
+    TraceEvent event{startNs, durationNs, threadIndex(), phase};
+    if (trace.size() < kTraceEvents) {
+        trace.push_back(event);
+    } else {
+        trace[traceNext] = event;
+        traceNext = (traceNext + 1) % kTraceEvents;
+    }
+}
+
+void Profiler::nameThread(const std::string& name) {
+    std::lock_guard<std::mutex> guard(lock);
+    threadNames[threadIndex()] = name;
+}
+
+ProfileStats Profiler::stats(ProfilePhase phase) const {
+    float samples[kHistory];
+    size_t count;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        const History& h = history[static_cast<size_t>(phase)];
+        count = h.count;
+        std::copy(h.ms, h.ms + count, samples);
+    }
+
+    ProfileStats result;
+    result.samples = count;
+    if (count == 0) return result;
+
+    double sum = 0.0;
+    float lowest = samples[0];
+    for (size_t i = 0; i < count; ++i) {
+        sum += samples[i];
+        lowest = std::min(lowest, samples[i]);
+    }
+
+    // Nearest-rank 99th percentile
+    size_t rank = (count * 99 + 99) / 100 - 1;
+    std::nth_element(samples, samples + rank, samples + count);
+
+    result.minMs = lowest;
+    result.avgMs = sum / static_cast<double>(count);
+    result.p99Ms = samples[rank];
+    return result;
+}
+
+size_t Profiler::writeChromeTrace(const std::string& path) const {
+    // Copy out under the lock, write without it so recording threads never wait on the disk
+    std::vector<TraceEvent> events;
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        events.reserve(trace.size());
+        events.insert(events.end(), trace.begin() + static_cast<std::ptrdiff_t>(traceNext), trace.end());
+        events.insert(events.end(), trace.begin(), trace.begin() + static_cast<std::ptrdiff_t>(traceNext));
+        names = threadNames;
+    }
+
+    std::ofstream out(path);
+    if (!out) throw std::runtime_error("Unable to create " + path);
+
+    // Timestamps and durations are in microseconds; "X" is a complete event, "M" metadata
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    const char* separator = "\n";
+    for (size_t t = 0; t < names.size(); ++t) {
+        out << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t
+            << ",\"args\":{\"name\":\"" << names[t] << "\"}}";
+        separator = ",\n";
+    }
+    out << std::fixed;
+    out.precision(3);
+    for (const TraceEvent& e : events) {
+        out << separator << "{\"name\":\"" << profilePhaseName(e.phase) << "\",\"cat\":\"" << phaseCategory(e.phase)
+            << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread
+            << ",\"ts\":" << e.startNs * 1e-3 << ",\"dur\":" << e.durationNs * 1e-3 << '}';
+        separator = ",\n";
+    }
+    out << "\n]}\n";
+
+    out.close();
+    if (!out) throw std::runtime_error("Writing " + path + " failed");
+    return events.size();
+}
+
+void Profiler::clear() {
+    std::lock_guard<std::mutex> guard(lock);
+    for (History& h : history) h = History{};
+    trace.clear();
+    traceNext = 0;
+    origin = Clock::now();
+}
+
+ProfileScope::~ProfileScope() {
+    profiler.record(phase, start, Profiler::Clock::now());
+}
+
+} // namespace SolarSim
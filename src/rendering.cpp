@@ -1,83 +1,197 @@
 #include "rendering.h"
 
-#include <algorithm>
-
-#define STB_EASY_FONT_IMPLEMENTATION
-#include "stb_easy_font.h"
+#include <string_view>
+#include <vector>
 
 #include "globals.h"
+#include "textmesh.h"
 #include "utils.h"
 
 namespace SolarSim {
 
-void initTextRenderer() {
-    glGenVertexArrays(1, &textVAO);
-    glGenBuffers(1, &textVBO);
-    glBindVertexArray(textVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-    glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_DYNAMIC_DRAW);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-}
-
-void updateOverlayText(const std::string& text) {
-    overlayText = text;
-    showTextOverlay = !overlayText.empty();
-}
+namespace {
+
+// Spare floats every line slot gets past its current mesh (8 quads' worth), so a line
+// that grows by a glyph or two still fits and doesn't force a full re-upload
+constexpr size_t kLineSlackFloats = 8 * 6 * 2;
+
+// One overlay's vertex buffer, laid out as a fixed slot per line. A line whose text
+// changed only re-uploads the floats that actually differ (for the clock, usually just
+// the last digit); unchanged lines cost a string compare. Unused slot space is zeros,
+// which draws as degenerate triangles, so the whole overlay is still one draw call.
+class OverlayMesh {
+public:
+    void init() {
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_DYNAMIC_DRAW);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        lines.clear();
+        bufferFloats = 0;
+    }
 
-void clearOverlayText() {
-    showTextOverlay = false;
-    textVertices.clear();
-    textVertexCount = 0;
-    overlayText.clear();
-}
+    void shutdown() {
+        glDeleteBuffers(1, &vbo);
+        glDeleteVertexArrays(1, &vao);
+        vbo = vao = 0;
+        lines.clear();
+        bufferFloats = 0;
+    }
 
-bool buildTextMesh(const std::string& text, float scale, float offsetX, float offsetY, int& outVertexCount) {
-    outVertexCount = 0;
-    if (text.empty()) return false;
+    void draw(const std::string& text, float scale, float offsetX, float offsetY) {
+        splitLines(text);
+
+        // A new position, scale or line count moves everything, start the layout over
+        bool relayout = scale != lastScale || offsetX != lastOffsetX || offsetY != lastOffsetY ||
+                        pieces.size() != lines.size();
+        lastScale = scale;
+        lastOffsetX = offsetX;
+        lastOffsetY = offsetY;
+        if (relayout) lines.assign(pieces.size(), Line{});
+
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+        // Rebuild the changed lines on the CPU first; any that outgrew its slot means a new layout
+        changed.clear();
+        for (size_t i = 0; i < pieces.size(); ++i) {
+            Line& line = lines[i];
+            if (!relayout && line.text == pieces[i]) continue;
+
+            line.text.assign(pieces[i].data(), pieces[i].size());
+            const std::vector<float>& glyphs = layoutCache.layout(pieces[i], scale);
+            const float lineY = offsetY + static_cast<float>(i) * kEasyFontLineHeight * scale;
+
+            line.next.resize(glyphs.size());
+            for (size_t k = 0; k < glyphs.size(); k += 2) {
+                line.next[k] = glyphs[k] + offsetX;
+                line.next[k + 1] = glyphs[k + 1] + lineY;
+            }
+            line.dirty = true;
+            if (line.next.size() > line.vertices.size()) relayout = true;
+            changed.push_back(i);
+        }
 
-    size_t bufferSize = std::max<size_t>(1, text.size()) * kEasyFontBytesPerChar;
-    textScratchBuffer.resize(bufferSize);
+        if (relayout) {
+            uploadAll();
+        } else {
+            for (size_t i : changed) uploadLine(lines[i]);
+        }
 
-    int quadCount = stb_easy_font_print(0.0f, 0.0f, const_cast<char*>(text.c_str()), nullptr,
-                                        textScratchBuffer.data(), static_cast<int>(bufferSize));
-    if (quadCount <= 0) return false;
+        if (bufferFloats > 0) glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(bufferFloats / 2));
+    }
 
-    struct EasyFontVertex {
-        float x;
-        float y;
-        float z;
-        unsigned char rgba[4];
+private:
+    struct Line {
+        std::string text;
+        size_t first = 0;            // offset of the slot in the buffer, in floats
+        size_t used = 0;             // floats of the slot holding the actual mesh
+        std::vector<float> vertices; // what the GPU holds for the slot, zero padded to its size
+        std::vector<float> next;     // freshly built mesh waiting to go in
+        bool dirty = false;          // `next` is newer than `vertices`
     };
 
-    EasyFontVertex* verts = reinterpret_cast<EasyFontVertex*>(textScratchBuffer.data());
-    textVertices.clear();
-    textVertices.reserve(static_cast<size_t>(quadCount) * 6 * 2);
+    void splitLines(const std::string& text) {
+        pieces.clear();
+        std::string_view rest(text);
+        while (true) {
+            size_t end = rest.find('\n');
+            pieces.push_back(rest.substr(0, end));
+            if (end == std::string_view::npos) break;
+            rest.remove_prefix(end + 1);
+        }
+    }
+
+    // Gives every line a slot with some slack and sends the whole buffer over in one go
+    void uploadAll() {
+        staging.clear();
+        for (Line& line : lines) {
+            if (line.dirty) {
+                line.vertices.swap(line.next);
+                line.used = line.vertices.size();
+            }
+            line.vertices.resize(line.used);
+            line.vertices.resize(line.used + kLineSlackFloats, 0.0f);
+
+            line.first = staging.size();
+            staging.insert(staging.end(), line.vertices.begin(), line.vertices.end());
+            line.next.clear();
+            line.dirty = false;
+        }
+        bufferFloats = staging.size();
+        glBufferData(GL_ARRAY_BUFFER, bufferFloats * sizeof(float), staging.data(), GL_DYNAMIC_DRAW);
+    }
+
+    // Writes the part of a line's slot that differs from what the GPU already has
+    void uploadLine(Line& line) {
+        line.used = line.next.size();
+        line.next.resize(line.vertices.size(), 0.0f);
 
-    for (int i = 0; i < quadCount; ++i) {
-        EasyFontVertex* quad = verts + i * 4;
-        auto emit = [&](int idx) {
-            textVertices.push_back(quad[idx].x * scale + offsetX);
-            textVertices.push_back(quad[idx].y * scale + offsetY);
-        };
+        size_t begin = 0;
+        size_t end = line.vertices.size();
+        while (begin < end && line.next[begin] == line.vertices[begin]) ++begin;
+        while (end > begin && line.next[end - 1] == line.vertices[end - 1]) --end;
 
-        emit(0); emit(1); emit(2);
-        emit(0); emit(2); emit(3);
+        if (begin < end) {
+            glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>((line.first + begin) * sizeof(float)),
+                            static_cast<GLsizeiptr>((end - begin) * sizeof(float)), line.next.data() + begin);
+        }
+        line.vertices.swap(line.next);
+        line.next.clear();
+        line.dirty = false;
     }
 
-    outVertexCount = static_cast<int>(textVertices.size() / 2);
-    if (outVertexCount == 0) return false;
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    size_t bufferFloats = 0;
+    float lastScale = 0.0f;
+    float lastOffsetX = 0.0f;
+    float lastOffsetY = 0.0f;
+
+    std::vector<Line> lines;
+    std::vector<std::string_view> pieces;
+    std::vector<size_t> changed;
+    std::vector<float> staging;
+
+    TextLayoutCache layoutCache;
+};
+
+OverlayMesh timeOverlayMesh;
+OverlayMesh infoOverlayMesh;
+
+// Unscaled width of overlayText, measured once whenever the text changes
+float overlayTextWidth = 0.0f;
+
+} // namespace
 
-    glBufferData(GL_ARRAY_BUFFER, textVertices.size() * sizeof(float), textVertices.data(), GL_DYNAMIC_DRAW);
-    textVertexCount = outVertexCount;
-    return true;
+void initTextRenderer() {
+    timeOverlayMesh.init();
+    infoOverlayMesh.init();
 }
 
-void renderOverlayText() {
-    textVertexCount = 0;
+void shutdownTextRenderer() {
+    timeOverlayMesh.shutdown();
+    infoOverlayMesh.shutdown();
+}
+
+void updateOverlayText(const std::string& text) {
+    overlayText = text;
+    overlayTextWidth = textWidth(overlayText);
+    showTextOverlay = !overlayText.empty();
+}
+
+void clearOverlayText() {
+    showTextOverlay = false;
+    overlayText.clear();
+    overlayTextWidth = 0.0f;
+}
 
+void renderOverlayText() {
     int fbWidth = 0, fbHeight = 0;
     glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
     if (fbWidth <= 0 || fbHeight <= 0) return;
@@ -86,24 +200,14 @@ void renderOverlayText() {
     glUniform2f(textScreenUniform, static_cast<float>(fbWidth), static_cast<float>(fbHeight));
     glUniform3f(textColorUniform, 0.85f, 0.85f, 0.9f);
 
-    glBindVertexArray(textVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-
-    int vertexCount = 0;
-
     if (!timeOverlayText.empty()) {
-        if (buildTextMesh(timeOverlayText, timeOverlayScale, timeOverlayMargin, timeOverlayMargin, vertexCount)) {
-            glDrawArrays(GL_TRIANGLES, 0, vertexCount);
-        }
+        timeOverlayMesh.draw(timeOverlayText, timeOverlayScale, timeOverlayMargin, timeOverlayMargin);
     }
 
     if (showTextOverlay && !overlayText.empty()) {
-        float rawWidth = static_cast<float>(stb_easy_font_width(const_cast<char*>(overlayText.c_str())));
-        float offsetX = static_cast<float>(fbWidth) - rawWidth * overlayScale - overlayMargin;
+        float offsetX = static_cast<float>(fbWidth) - overlayTextWidth * overlayScale - overlayMargin;
         if (offsetX < overlayMargin) offsetX = overlayMargin;
-        if (buildTextMesh(overlayText, overlayScale, offsetX, overlayMargin, vertexCount)) {
-            glDrawArrays(GL_TRIANGLES, 0, vertexCount);
-        }
+        infoOverlayMesh.draw(overlayText, overlayScale, offsetX, overlayMargin);
     }
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
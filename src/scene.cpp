@@ -0,0 +1,78 @@
+#include "scene.h"
+
+#include <cmath>
+#include <random>
+
+#include "bodysystem.h"
+#include "constants.h"
+#include "mass.h"
+
+namespace SolarSim {
+
+void loadDefaultScene(BodySystem& bodies) {
+    // Create an instance of mass based off the sun
+    Mass sun;
+    sun.r = 0.75f; sun.g = 0.75f; sun.b = 0.0f;
+    sun.name = "Sun";
+    sun.mass = static_cast<float>(Constants::sunMass);
+    sun.radius = static_cast<float>(Constants::sunRadius * 20);
+    sun.x = -Constants::sunEarthDistance;
+    sun.vx = 0;
+
+    // Add sun to the system
+    // bodies.add(sun);
+
+    // Create an instance of mass based off the earth
+    Mass earth;
+    earth.r = 0.0f; earth.g = 0.0f; earth.b = 1.0f;
+    earth.name = "Earth";
+    earth.mass = static_cast<float>(Constants::earthMass);
+    earth.radius = static_cast<float>(Constants::earthRadius);
+    earth.x = 0;
+    earth.vy = 0;
+
+    // Add earth to the system
+    bodies.add(earth);
+
+    // Create an instance of mass based off the moon
+    Mass moon;
+    moon.r = 1.5f; moon.g = 1.5f; moon.b = 1.5f;
+    moon.name = "Moon";
+    moon.mass = static_cast<float>(Constants::moonMass);
+    moon.radius = static_cast<float>(Constants::moonRadius);
+    moon.x = Constants::earthMoonDistance;
+    moon.vy = Constants::moonTanVelocity;
+
+    // Add moon to the system
+    bodies.add(moon);
+}
+
+void addRandomBodies(BodySystem& bodies, size_t count, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> orbitDist(0.2 * Constants::earthMoonDistance,
+                                                     3.0 * Constants::earthMoonDistance);
+    std::uniform_real_distribution<double> angleDist(0.0, 2.0 * M_PI);
+    std::uniform_real_distribution<double> sizeDist(0.01, 0.1);
+
+    bodies.reserve(bodies.size() + count);
+    for (size_t i = 0; i < count; ++i) {
+        double orbit = orbitDist(rng);
+        double angle = angleDist(rng);
+        double size = sizeDist(rng);
+
+        // Circular speed around an earth mass at the origin
+        double speed = std::sqrt(Constants::G * Constants::earthMass / orbit);
+
+        Mass m;
+        m.r = 0.75f; m.g = 0.75f; m.b = 0.75f;
+        m.x = orbit * std::cos(angle);
+        m.y = orbit * std::sin(angle);
+        m.vx = -speed * std::sin(angle);
+        m.vy = speed * std::cos(angle);
+        m.mass = static_cast<float>(Constants::moonMass * size);
+        m.radius = static_cast<float>(Constants::moonRadius * size);
+        bodies.add(m);
+    }
+}
+
+} // namespace SolarSim
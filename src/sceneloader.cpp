@@ -0,0 +1,614 @@
+#include "sceneloader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bodysystem.h"
+#include "nametable.h"
+#include "simglobals.h"
+
+namespace SolarSim {
+
+namespace {
+
+// Smallest piece of a CSV file worth a thread-pool chunk
+constexpr size_t kMinChunkBytes = 1 << 20;
+
+// JSON objects per chunk once the structure has been indexed
+constexpr size_t kJsonObjectGrain = 4096;
+
+enum class Field { Name, Mass, Radius, X, Y, VX, VY, R, G, B, Unknown };
+
+constexpr unsigned kRequiredFields = (1u << static_cast<unsigned>(Field::Name)) |
+                                     (1u << static_cast<unsigned>(Field::Mass)) |
+                                     (1u << static_cast<unsigned>(Field::Radius)) |
+                                     (1u << static_cast<unsigned>(Field::X)) |
+                                     (1u << static_cast<unsigned>(Field::Y));
+
+Field fieldFromKey(std::string_view key) {
+    if (key == "name") return Field::Name;
+    if (key == "mass") return Field::Mass;
+    if (key == "radius") return Field::Radius;
+    if (key == "x") return Field::X;
+    if (key == "y") return Field::Y;
+    if (key == "vx") return Field::VX;
+    if (key == "vy") return Field::VY;
+    if (key == "r") return Field::R;
+    if (key == "g") return Field::G;
+    if (key == "b") return Field::B;
+    return Field::Unknown;
+}
+
+unsigned bit(Field field) {
+    return 1u << static_cast<unsigned>(field);
+}
+
+const char* missingFieldName(unsigned seen) {
+    if (!(seen & bit(Field::Name))) return "name";
+    if (!(seen & bit(Field::Mass))) return "mass";
+    if (!(seen & bit(Field::Radius))) return "radius";
+    if (!(seen & bit(Field::X))) return "x";
+    return "y";
+}
+
+// Read-only mapping of the whole input file
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Unable to open " + path + ": " + std::strerror(errno));
+
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Unable to stat " + path + ": " + std::strerror(errno));
+        }
+        bytes = static_cast<size_t>(info.st_size);
+
+        if (bytes > 0) {
+            void* mapping = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("Unable to map " + path + ": " + std::strerror(errno));
+            }
+            data = static_cast<const char*>(mapping);
+            ::madvise(mapping, bytes, MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile() {
+        if (data) ::munmap(const_cast<char*>(data), bytes);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view view() const { return std::string_view(data ? data : "", bytes); }
+
+private:
+    const char* data = nullptr;
+    size_t bytes = 0;
+};
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && isSpace(text.front())) text.remove_prefix(1);
+    while (!text.empty() && isSpace(text.back())) text.remove_suffix(1);
+    return text;
+}
+
+bool parseNumber(std::string_view text, double& out) {
+    text = trim(text);
+    if (!text.empty() && text.front() == '+') text.remove_prefix(1);
+    if (text.empty()) return false;
+    auto result = std::from_chars(text.data(), text.data() + text.size(), out);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+bool positive(float value) {
+    return value > 0.0f && std::isfinite(value);
+}
+
+// Writes one parsed value into row `i` of the columns. Returns why the value can't be used,
+// or nullptr: a massless body is removed on the first step, and a NaN or infinity spoils the
+// force on every other body.
+const char* store(BodySystem& bodies, size_t i, Field field, double value) {
+    switch (field) {
+        case Field::Mass:
+            bodies.mass[i] = static_cast<float>(value);
+            return positive(bodies.mass[i]) ? nullptr : "mass must be positive and finite";
+        case Field::Radius:
+            bodies.radius[i] = static_cast<float>(value);
+            return positive(bodies.radius[i]) ? nullptr : "radius must be positive and finite";
+        case Field::X: bodies.x[i] = value; return std::isfinite(value) ? nullptr : "x must be finite";
+        case Field::Y: bodies.y[i] = value; return std::isfinite(value) ? nullptr : "y must be finite";
+        case Field::VX: bodies.vx[i] = value; return std::isfinite(value) ? nullptr : "vx must be finite";
+        case Field::VY: bodies.vy[i] = value; return std::isfinite(value) ? nullptr : "vy must be finite";
+        case Field::R: bodies.info[i].r = static_cast<float>(value); break;
+        case Field::G: bodies.info[i].g = static_cast<float>(value); break;
+        case Field::B: bodies.info[i].b = static_cast<float>(value); break;
+        case Field::Name:
+        case Field::Unknown:
+            return nullptr;
+    }
+    return std::isfinite(static_cast<float>(value)) ? nullptr : "color must be finite";
+}
+
+// 1-based line number of `offset`, only worked out when there's an error to report
+size_t lineOf(std::string_view text, size_t offset) {
+    return 1 + static_cast<size_t>(std::count(text.begin(), text.begin() + std::min(offset, text.size()), '\n'));
+}
+
+// First problem found by any chunk; the earliest offset wins so the report doesn't
+// depend on which thread got there first
+struct ParseError {
+    size_t offset = std::string_view::npos;
+    std::string message;
+
+    void set(size_t at, std::string why) {
+        if (at < offset) {
+            offset = at;
+            message = std::move(why);
+        }
+    }
+};
+
+// ---- CSV ----
+
+bool isDataLine(std::string_view line) {
+    line = trim(line);
+    return !line.empty() && line.front() != '#';
+}
+
+// Cuts `line` at the next comma (outside quotes) and returns the field, unquoted; `more`
+// says whether a comma followed. Quoted fields with doubled quotes are unescaped into `scratch`.
+// Returns false for an unterminated quote.
+bool nextCsvField(std::string_view& line, std::string_view& field, bool& more, std::string& scratch) {
+    size_t start = 0;
+    while (start < line.size() && (line[start] == ' ' || line[start] == '\t')) ++start;
+
+    if (start < line.size() && line[start] == '"') {
+        size_t at = start + 1;
+        bool escaped = false;
+        while (true) {
+            size_t quote = line.find('"', at);
+            if (quote == std::string_view::npos) return false;
+            if (quote + 1 < line.size() && line[quote + 1] == '"') {
+                escaped = true;
+                at = quote + 2;
+                continue;
+            }
+            field = line.substr(start + 1, quote - start - 1);
+            size_t comma = line.find(',', quote + 1);
+            more = comma != std::string_view::npos;
+            line = more ? line.substr(comma + 1) : std::string_view();
+            break;
+        }
+        if (escaped) {
+            scratch.clear();
+            for (size_t k = 0; k < field.size(); ++k) {
+                scratch.push_back(field[k]);
+                if (field[k] == '"') ++k; // skip the second of each pair
+            }
+            field = scratch;
+        }
+        return true;
+    }
+
+    size_t comma = line.find(',');
+    more = comma != std::string_view::npos;
+    if (!more) {
+        field = line;
+        line = std::string_view();
+    } else {
+        field = line.substr(0, comma);
+        line = line.substr(comma + 1);
+    }
+    return true;
+}
+
+void loadCsv(std::string_view text, BodySystem& bodies, SceneLoadStats& stats, const std::string& path) {
+    // Header: first line that isn't blank or a comment
+    size_t at = 0;
+    std::string_view headerLine;
+    while (at < text.size()) {
+        size_t end = text.find('\n', at);
+        if (end == std::string_view::npos) end = text.size();
+        std::string_view line = text.substr(at, end - at);
+        at = end + 1;
+        if (isDataLine(line)) {
+            headerLine = trim(line);
+            break;
+        }
+    }
+    if (headerLine.empty()) throw std::runtime_error(path + ": no header row");
+
+    std::vector<Field> columns;
+    unsigned seen = 0;
+    std::string scratch;
+    for (bool more = true; more;) {
+        std::string_view key;
+        if (!nextCsvField(headerLine, key, more, scratch)) throw std::runtime_error(path + ": bad header row");
+        Field field = fieldFromKey(trim(key));
+        columns.push_back(field);
+        seen |= bit(field);
+    }
+    if ((seen & kRequiredFields) != kRequiredFields) {
+        throw std::runtime_error(path + ": header has no " + missingFieldName(seen) + " column");
+    }
+
+    // Chunks end on line breaks
+    const size_t bodyStart = std::min(at, text.size());
+    const size_t target = std::max(kMinChunkBytes, (text.size() - bodyStart) / (threadPool.size() * 4) + 1);
+    std::vector<size_t> chunkStart;
+    for (size_t pos = bodyStart; pos < text.size();) {
+        chunkStart.push_back(pos);
+        size_t next = pos + target;
+        if (next >= text.size()) break;
+        size_t newline = text.find('\n', next);
+        if (newline == std::string_view::npos) break;
+        pos = newline + 1;
+    }
+    chunkStart.push_back(text.size());
+    const size_t chunks = chunkStart.size() - 1;
+    stats.chunks = chunks;
+
+    auto forEachLine = [&](size_t chunk, auto&& fn) {
+        size_t pos = chunkStart[chunk];
+        const size_t end = chunkStart[chunk + 1];
+        while (pos < end) {
+            size_t newline = text.find('\n', pos);
+            if (newline == std::string_view::npos || newline > end) newline = end;
+            fn(pos, text.substr(pos, newline - pos));
+            pos = newline + 1;
+        }
+    };
+
+    // Pass 1: count rows per chunk so every chunk knows where its rows go
+    std::vector<size_t> rowStart(chunks + 1, 0);
+    threadPool.parallelFor(0, chunks, 1, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            size_t rows = 0;
+            forEachLine(c, [&](size_t, std::string_view line) {
+                if (isDataLine(line)) ++rows;
+            });
+            rowStart[c + 1] = rows;
+        }
+    });
+    for (size_t c = 0; c < chunks; ++c) rowStart[c + 1] += rowStart[c];
+
+    const size_t base = bodies.size();
+    bodies.resize(base + rowStart[chunks]);
+
+    // Pass 2: parse each chunk straight into its rows
+    std::vector<ParseError> errors(chunks);
+    threadPool.parallelFor(0, chunks, 1, [&](size_t begin, size_t end) {
+        std::string nameScratch;
+        for (size_t c = begin; c < end; ++c) {
+            size_t row = base + rowStart[c];
+            forEachLine(c, [&](size_t offset, std::string_view line) {
+                if (!isDataLine(line)) return;
+                line = trim(line);
+
+                bool more = true;
+                size_t k = 0;
+                for (; k < columns.size(); ++k) {
+                    std::string_view field;
+                    if (!more) {
+                        errors[c].set(offset, "expected " + std::to_string(columns.size()) + " fields");
+                        break;
+                    }
+                    if (!nextCsvField(line, field, more, nameScratch)) {
+                        errors[c].set(offset, "unterminated quote");
+                        break;
+                    }
+                    if (columns[k] == Field::Name) {
+                        bodies.info[row].name = trim(field);
+                    } else if (columns[k] != Field::Unknown) {
+                        double value;
+                        if (!parseNumber(field, value)) {
+                            errors[c].set(offset, "bad number '" + std::string(trim(field)) + "'");
+                            break;
+                        }
+                        if (const char* why = store(bodies, row, columns[k], value)) {
+                            errors[c].set(offset, why);
+                            break;
+                        }
+                    }
+                }
+                if (k == columns.size() && more) {
+                    errors[c].set(offset, "more than the header's " + std::to_string(columns.size()) + " fields");
+                }
+                ++row;
+            });
+        }
+    });
+
+    for (const ParseError& error : errors) {
+        if (error.offset != std::string_view::npos) {
+            bodies.resize(base);
+            throw std::runtime_error(path + ":" + std::to_string(lineOf(text, error.offset)) + ": " + error.message);
+        }
+    }
+    stats.bodies = rowStart[chunks];
+}
+
+// ---- JSON ----
+
+// Skips a string starting at text[at] == '"', returns the offset just past the closing quote
+size_t skipString(std::string_view text, size_t at) {
+    for (++at; at < text.size(); ++at) {
+        if (text[at] == '\\') {
+            ++at;
+        } else if (text[at] == '"') {
+            return at + 1;
+        }
+    }
+    return std::string_view::npos;
+}
+
+// Reads a string starting at text[at] == '"'. Escapes are rare in names, so they're only
+// decoded (into scratch, \uXXXX kept as-is) when present.
+bool readString(std::string_view text, size_t& at, std::string_view& out, std::string& scratch) {
+    size_t end = skipString(text, at);
+    if (end == std::string_view::npos) return false;
+    std::string_view raw = text.substr(at + 1, end - at - 2);
+    at = end;
+
+    if (raw.find('\\') == std::string_view::npos) {
+        out = raw;
+        return true;
+    }
+    scratch.clear();
+    for (size_t k = 0; k < raw.size(); ++k) {
+        char c = raw[k];
+        if (c == '\\' && k + 1 < raw.size()) {
+            char e = raw[++k];
+            switch (e) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'u': scratch += "\\u"; continue;
+                default: c = e; break; // \" \\ \/
+            }
+        }
+        scratch.push_back(c);
+    }
+    out = scratch;
+    return true;
+}
+
+void skipSpace(std::string_view text, size_t& at) {
+    while (at < text.size() && isSpace(text[at])) ++at;
+}
+
+// Offset just past a number / true / false / null starting at `at`
+size_t scalarEnd(std::string_view text, size_t at) {
+    while (at < text.size() && !isSpace(text[at]) && text[at] != ',' && text[at] != '}' && text[at] != ']') ++at;
+    return at;
+}
+
+// Skips any value, nested or not. Returns npos on malformed input.
+size_t skipValue(std::string_view text, size_t at) {
+    if (at >= text.size()) return std::string_view::npos;
+    if (text[at] == '"') return skipString(text, at);
+    if (text[at] != '{' && text[at] != '[') return scalarEnd(text, at);
+
+    int depth = 0;
+    while (at < text.size()) {
+        char c = text[at];
+        if (c == '"') {
+            at = skipString(text, at);
+            if (at == std::string_view::npos) return at;
+            continue;
+        }
+        if (c == '{' || c == '[') ++depth;
+        if (c == '}' || c == ']') {
+            if (--depth == 0) return at + 1;
+        }
+        ++at;
+    }
+    return std::string_view::npos;
+}
+
+// Parses the object starting at text[at] == '{' into row i. Returns an error message or nullptr.
+const char* parseJsonBody(std::string_view text, size_t at, BodySystem& bodies, size_t i, std::string& scratch) {
+    unsigned seen = 0;
+    ++at;
+    while (true) {
+        skipSpace(text, at);
+        if (at >= text.size()) return "unexpected end of file";
+        if (text[at] == '}') break;
+        if (text[at] == ',') {
+            ++at;
+            continue;
+        }
+        if (text[at] != '"') return "expected a key";
+
+        std::string_view key;
+        if (!readString(text, at, key, scratch)) return "unterminated string";
+        Field field = fieldFromKey(key);
+        bool isColor = field == Field::Unknown && key == "color";
+
+        skipSpace(text, at);
+        if (at >= text.size() || text[at] != ':') return "expected ':'";
+        ++at;
+        skipSpace(text, at);
+        if (at >= text.size()) return "unexpected end of file";
+
+        if (field == Field::Name) {
+            std::string_view name;
+            if (text[at] != '"' || !readString(text, at, name, scratch)) return "name must be a string";
+            bodies.info[i].name = name;
+        } else if (isColor) {
+            // [r, g, b]
+            if (text[at] != '[') return "color must be [r, g, b]";
+            ++at;
+            const Field channels[3] = {Field::R, Field::G, Field::B};
+            for (int k = 0; k < 3; ++k) {
+                skipSpace(text, at);
+                size_t end = scalarEnd(text, at);
+                double value;
+                if (!parseNumber(text.substr(at, end - at), value)) return "bad color value";
+                if (const char* why = store(bodies, i, channels[k], value)) return why;
+                at = end;
+                skipSpace(text, at);
+                if (at < text.size() && text[at] == ',') ++at;
+            }
+            skipSpace(text, at);
+            if (at >= text.size() || text[at] != ']') return "color must be [r, g, b]";
+            ++at;
+        } else if (field == Field::Unknown) {
+            at = skipValue(text, at);
+            if (at == std::string_view::npos) return "malformed value";
+        } else {
+            size_t end = scalarEnd(text, at);
+            double value;
+            if (!parseNumber(text.substr(at, end - at), value)) return "bad number";
+            if (const char* why = store(bodies, i, field, value)) return why;
+            at = end;
+        }
+        seen |= bit(field);
+    }
+
+    if ((seen & kRequiredFields) != kRequiredFields) return "body is missing a required key";
+    return nullptr;
+}
+
+// Offset of the '[' opening the bodies array: the top level itself, or the "bodies" member
+// of a top-level object. Other members are skipped whole, strings and all, so brackets in
+// a title or an array-valued version number don't get mistaken for it.
+size_t findBodiesArray(std::string_view text, const std::string& path) {
+    auto fail = [&](size_t offset, const char* why) {
+        throw std::runtime_error(path + ":" + std::to_string(lineOf(text, offset)) + ": " + why);
+    };
+
+    size_t at = 0;
+    skipSpace(text, at);
+    if (at < text.size() && text[at] == '[') return at;
+    if (at >= text.size() || text[at] != '{') fail(at, "expected an array of bodies or an object");
+
+    std::string scratch;
+    ++at;
+    while (true) {
+        skipSpace(text, at);
+        if (at >= text.size()) fail(at, "unexpected end of file");
+        if (text[at] == '}') fail(at, "no \"bodies\" key");
+        if (text[at] == ',') {
+            ++at;
+            continue;
+        }
+        if (text[at] != '"') fail(at, "expected a key");
+
+        std::string_view key;
+        if (!readString(text, at, key, scratch)) fail(at, "unterminated string");
+        skipSpace(text, at);
+        if (at >= text.size() || text[at] != ':') fail(at, "expected ':'");
+        ++at;
+        skipSpace(text, at);
+
+        if (key == "bodies") {
+            if (at >= text.size() || text[at] != '[') fail(at, "\"bodies\" must be an array");
+            return at;
+        }
+        size_t end = skipValue(text, at);
+        if (end == std::string_view::npos) fail(at, "malformed value");
+        at = end;
+    }
+}
+
+void loadJson(std::string_view text, BodySystem& bodies, SceneLoadStats& stats, const std::string& path) {
+    const size_t at = findBodiesArray(text, path);
+
+    // Index pass: offsets of every object directly inside the array. Only strings and
+    // brackets are looked at here, the number parsing is left to the parallel pass.
+    std::vector<size_t> objects;
+    int depth = 0;
+    for (size_t pos = at; pos < text.size(); ++pos) {
+        char c = text[pos];
+        if (c == '"') {
+            pos = skipString(text, pos);
+            if (pos == std::string_view::npos) {
+                throw std::runtime_error(path + ":" + std::to_string(lineOf(text, text.size())) + ": unterminated string");
+            }
+            --pos;
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            if (depth == 1 && c == '{') objects.push_back(pos);
+            ++depth;
+        } else if (c == '}' || c == ']') {
+            if (--depth == 0) break;
+        }
+    }
+    if (depth != 0) throw std::runtime_error(path + ": unbalanced brackets");
+
+    const size_t base = bodies.size();
+    const size_t count = objects.size();
+    bodies.resize(base + count);
+
+    const size_t chunks = (count + kJsonObjectGrain - 1) / kJsonObjectGrain;
+    stats.chunks = chunks;
+    std::vector<ParseError> errors(chunks);
+    threadPool.parallelFor(0, count, kJsonObjectGrain, [&](size_t begin, size_t end) {
+        std::string scratch;
+        ParseError& error = errors[begin / kJsonObjectGrain];
+        for (size_t k = begin; k < end; ++k) {
+            if (const char* why = parseJsonBody(text, objects[k], bodies, base + k, scratch)) {
+                error.set(objects[k], why);
+                return;
+            }
+        }
+    });
+
+    for (const ParseError& error : errors) {
+        if (error.offset != std::string_view::npos) {
+            bodies.resize(base);
+            throw std::runtime_error(path + ":" + std::to_string(lineOf(text, error.offset)) + ": " + error.message);
+        }
+    }
+    stats.bodies = count;
+}
+
+} // namespace
+
+SceneLoadStats loadSceneFile(const std::string& path, BodySystem& bodies) {
+    auto start = std::chrono::steady_clock::now();
+    SceneLoadStats stats;
+
+    MappedFile file(path);
+    std::string_view text = file.view();
+    stats.bytes = text.size();
+
+    size_t first = 0;
+    while (first < text.size() && isSpace(text[first])) ++first;
+    if (first < text.size() && (text[first] == '[' || text[first] == '{')) {
+        loadJson(text, bodies, stats, path);
+    } else {
+        loadCsv(text, bodies, stats, path);
+    }
+
+    stats.distinctNames = internedNameCount();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+} // namespace SolarSim
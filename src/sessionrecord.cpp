@@ -0,0 +1,242 @@
+#include "sessionrecord.h"
+
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+
+namespace SolarSim {
+
+namespace {
+
+constexpr const char* kSessionMagic = "solarsim-session";
+constexpr int kSessionVersion = 1;
+
+// Names as the command line spells them, which is what the *FromName functions read back
+const char* integratorKey(Integrator scheme) {
+    switch (scheme) {
+        case Integrator::SemiImplicitEuler: return "euler";
+        case Integrator::Leapfrog: return "leapfrog";
+        case Integrator::Yoshida4: return "yoshida4";
+        case Integrator::BlockLeapfrog: return "block";
+    }
+    return "euler";
+}
+
+const char* forceSolverKey(ForceSolver solver) {
+    switch (solver) {
+        case ForceSolver::Direct: return "direct";
+        case ForceSolver::BarnesHut: return "barnes-hut";
+        case ForceSolver::ParticleMesh: return "particle-mesh";
+    }
+    return "direct";
+}
+
+const char* collisionModeKey(CollisionMode mode) {
+    switch (mode) {
+        case CollisionMode::Bounce: return "bounce";
+        case CollisionMode::Merge: return "merge";
+    }
+    return "bounce";
+}
+
+// Shortest text that reads back as the same double / float
+std::string exact(double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+    return buffer;
+}
+
+std::string exact(float value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.9g", static_cast<double>(value));
+    return buffer;
+}
+
+// What's left of the line after the key, without the separating space
+std::string restOfLine(std::istringstream& in) {
+    std::string rest;
+    std::getline(in, rest);
+    if (!rest.empty() && rest[0] == ' ') rest.erase(0, 1);
+    return rest;
+}
+
+[[noreturn]] void badLine(const std::string& path, size_t lineNumber, const std::string& why) {
+    throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": " + why);
+}
+
+} // namespace
+
+Session loadSession(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("Unable to open " + path);
+
+    Session session;
+    std::string line;
+    size_t lineNumber = 0;
+
+    std::string magic;
+    int version = 0;
+    if (!std::getline(in, line) || !(std::istringstream(line) >> magic >> version) || magic != kSessionMagic) {
+        throw std::runtime_error(path + " is not a session recording");
+    }
+    if (version != kSessionVersion) {
+        throw std::runtime_error(path + " is session version " + std::to_string(version) + ", expected " +
+                                 std::to_string(kSessionVersion));
+    }
+    lineNumber++;
+
+    SessionSettings& settings = session.settings;
+    bool sawSpeed = false;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        if (line.empty()) continue;
+
+        std::istringstream fields(line);
+        std::string key;
+        fields >> key;
+
+        bool ok = true;
+        if (key == "seed") {
+            ok = static_cast<bool>(fields >> settings.seed);
+        } else if (key == "dt") {
+            ok = static_cast<bool>(fields >> settings.dt);
+        } else if (key == "speed") {
+            ok = static_cast<bool>(fields >> settings.speed);
+            sawSpeed = true;
+        } else if (key == "tick-rate") {
+            ok = static_cast<bool>(fields >> settings.tickRate);
+        } else if (key == "integrator" || key == "solver" || key == "collisions") {
+            std::string name;
+            fields >> name;
+            if (key == "integrator") {
+                ok = integratorFromName(name.c_str(), settings.integrator);
+            } else if (key == "solver") {
+                ok = forceSolverFromName(name.c_str(), settings.solver);
+            } else {
+                ok = collisionModeFromName(name.c_str(), settings.collisions);
+            }
+        } else if (key == "theta") {
+            ok = static_cast<bool>(fields >> settings.theta);
+        } else if (key == "mesh-grid") {
+            ok = static_cast<bool>(fields >> settings.meshGrid);
+        } else if (key == "mesh-short-range") {
+            ok = static_cast<bool>(fields >> settings.meshShortRange);
+        } else if (key == "scene") {
+            settings.scenePath = restOfLine(fields);
+        } else if (key == "load") {
+            settings.loadPath = restOfLine(fields);
+        } else if (key == "pin") {
+            settings.pinName = restOfLine(fields);
+        } else if (key == "end") {
+            ok = static_cast<bool>(fields >> session.endFrame);
+        } else if (key == "frame") {
+            RecordedCommand recorded;
+            std::string type;
+            if (!(fields >> recorded.frame >> type)) badLine(path, lineNumber, "can't read '" + line + "'");
+            if (!session.commands.empty() && recorded.frame < session.commands.back().frame) {
+                badLine(path, lineNumber, "frames go backwards");
+            }
+
+            SimCommand& command = recorded.command;
+            if (type == "spawn") {
+                Mass& mass = command.mass;
+                double massKg = 0.0, radius = 0.0, r = 0.0, g = 0.0, b = 0.0;
+                command.type = SimCommand::Type::SpawnMass;
+                ok = static_cast<bool>(fields >> mass.x >> mass.y >> mass.vx >> mass.vy >> massKg >> radius >> r >>
+                                       g >> b);
+                mass.mass = static_cast<float>(massKg);
+                mass.radius = static_cast<float>(radius);
+                mass.r = static_cast<float>(r);
+                mass.g = static_cast<float>(g);
+                mass.b = static_cast<float>(b);
+                mass.name = restOfLine(fields);
+            } else if (type == "select") {
+                command.type = SimCommand::Type::SelectAt;
+                ok = static_cast<bool>(fields >> command.x >> command.y);
+            } else if (type == "solver") {
+                std::string name;
+                command.type = SimCommand::Type::SetForceSolver;
+                ok = static_cast<bool>(fields >> name) && forceSolverFromName(name.c_str(), command.solver);
+            } else if (type == "checkpoint") {
+                command.type = SimCommand::Type::SaveCheckpoint;
+            } else if (type == "speed") {
+                command.type = SimCommand::Type::SetSimSpeed;
+                ok = static_cast<bool>(fields >> command.speed);
+            } else {
+                badLine(path, lineNumber, "unknown command '" + type + "'");
+            }
+            if (ok) session.commands.push_back(recorded);
+        } else {
+            badLine(path, lineNumber, "unknown key '" + key + "'");
+        }
+
+        if (!ok) badLine(path, lineNumber, "can't read '" + line + "'");
+    }
+
+    // Logs from before the step scheduler ran one dt step per tick
+    if (!sawSpeed) settings.speed = settings.dt * settings.tickRate;
+    if (settings.dt <= 0.0 || settings.speed <= 0.0 || settings.tickRate <= 0.0) {
+        throw std::runtime_error(path + ": dt, speed and tick-rate must be positive");
+    }
+    return session;
+}
+
+void SessionRecorder::start(const std::string& path, const SessionSettings& settings) {
+    stop(-1);
+    out.open(path);
+    if (!out) throw std::runtime_error("Unable to create " + path);
+    count = 0;
+
+    out << kSessionMagic << ' ' << kSessionVersion << '\n'
+        << "seed " << settings.seed << '\n'
+        << "dt " << exact(settings.dt) << '\n'
+        << "speed " << exact(settings.speed) << '\n'
+        << "tick-rate " << exact(settings.tickRate) << '\n'
+        << "integrator " << integratorKey(settings.integrator) << '\n'
+        << "solver " << forceSolverKey(settings.solver) << '\n'
+        << "collisions " << collisionModeKey(settings.collisions) << '\n'
+        << "theta " << exact(settings.theta) << '\n'
+        << "mesh-grid " << settings.meshGrid << '\n'
+        << "mesh-short-range " << (settings.meshShortRange ? 1 : 0) << '\n';
+    if (!settings.scenePath.empty()) out << "scene " << settings.scenePath << '\n';
+    if (!settings.loadPath.empty()) out << "load " << settings.loadPath << '\n';
+    if (!settings.pinName.empty()) out << "pin " << settings.pinName << '\n';
+    out.flush();
+}
+
+void SessionRecorder::stop(long long endFrame) {
+    if (!out.is_open()) return;
+    if (endFrame >= 0) out << "end " << endFrame << '\n';
+    out.close();
+}
+
+void SessionRecorder::record(long long frame, const SimCommand& command) {
+    if (!out.is_open()) return;
+
+    out << "frame " << frame << ' ';
+    switch (command.type) {
+        case SimCommand::Type::SpawnMass: {
+            const Mass& mass = command.mass;
+            out << "spawn " << exact(mass.x) << ' ' << exact(mass.y) << ' ' << exact(mass.vx) << ' '
+                << exact(mass.vy) << ' ' << exact(mass.mass) << ' ' << exact(mass.radius) << ' ' << exact(mass.r)
+                << ' ' << exact(mass.g) << ' ' << exact(mass.b) << ' ' << mass.name;
+            break;
+        }
+        case SimCommand::Type::SelectAt:
+            out << "select " << exact(command.x) << ' ' << exact(command.y);
+            break;
+        case SimCommand::Type::SetForceSolver:
+            out << "solver " << forceSolverKey(command.solver);
+            break;
+        case SimCommand::Type::SaveCheckpoint:
+            out << "checkpoint";
+            break;
+        case SimCommand::Type::SetSimSpeed:
+            out << "speed " << exact(command.speed);
+            break;
+    }
+    out << std::endl;
+    count++;
+}
+
+} // namespace SolarSim
@@ -0,0 +1,37 @@
+#include "simglobals.h"
+
+namespace SolarSim {
+
+// Simulation parameters
+double timeStepMult = 600.0;
+double simSpeed = 36000.0; // one 600 s step per 60 Hz tick, the old one-step-per-frame pace
+ForceSolver forceSolver = ForceSolver::Direct;
+Integrator integrator = Integrator::SemiImplicitEuler;
+double barnesHutTheta = 0.5;
+size_t particleMeshGrid = 256;
+bool particleMeshShortRange = true;
+SimdLevel simdLevel = detectSimdLevel();
+CollisionMode collisionMode = CollisionMode::Bounce;
+BroadPhase broadPhase = BroadPhase::SweepAndPrune;
+BodyHandle pinnedBody;
+
+// Simulation clock
+long long simFrame = 0;
+double simSeconds = 0.0;
+CollisionStats collisionStats;
+TimestepStats timestepStats;
+
+// Simulation collections
+BodySystem bodies;
+MassView massesVector{bodies};
+SpatialIndex spatialIndex;
+
+// One thread per core unless main() is told otherwise
+ThreadPool threadPool;
+
+Checkpointer checkpointer;
+TrajectoryWriter trajectoryWriter;
+SessionRecorder sessionRecorder;
+Profiler profiler;
+
+} // namespace SolarSim
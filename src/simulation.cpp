@@ -0,0 +1,252 @@
+#include "simulation.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "bodysystem.h"
+#include "broadphase.h"
+#include "contactislands.h"
+#include "mass.h"
+#include "profiler.h"
+#include "simglobals.h"
+#include "simulationpolicies.h"
+
+namespace SolarSim {
+
+namespace {
+
+// Kept between steps so the sweep can reuse last frame's ordering
+SweepAndPrune sweepAndPrune;
+std::vector<BodyPair> candidatePairs;
+
+// Where every body was when the step began, for the swept collision test
+std::vector<double> startX;
+std::vector<double> startY;
+
+// Touching pairs grouped into independent islands, and per island what resolving it did
+ContactIslands islands;
+std::vector<uint32_t> islandCollisions;
+std::vector<uint32_t> islandSwept;
+std::vector<uint8_t> hitThisStep; // per body, already had its time-of-impact event
+
+// Islands per chunk when they're spread across the thread pool. Most are a single pair.
+constexpr size_t kIslandGrain = 64;
+
+// Steps of motion each spatial index box is padded for, so a body moving steadily
+// only needs re-inserting every few steps
+constexpr double kIndexLookAheadSteps = 4.0;
+
+NoPin resolvePin(const BodySystem&, NoPin) {
+    return NoPin{};
+}
+
+// stepSimulation only picks the pinned specialisation while pinnedBody resolves
+PinnedBody resolvePin(const BodySystem& bodies, PinnedBody) {
+    PinnedBody pin;
+    bodies.find(pinnedBody, pin.index);
+    pin.x = bodies.x[pin.index];
+    pin.y = bodies.y[pin.index];
+    return pin;
+}
+
+// One step with every policy fixed at compile time: the drift and kick loops, the
+// pin check inside them and the collision response are all inlined for this combination
+template <class Scheme, class Forces, class Collisions, class Pin>
+class Simulation {
+public:
+    static void step(BodySystem& bodies, double dt) {
+        SOLARSIM_PROFILE_SCOPE(ProfilePhase::Step);
+        const Pin pin = resolvePin(bodies, Pin{});
+
+        startX.assign(bodies.x.begin(), bodies.x.end());
+        startY.assign(bodies.y.begin(), bodies.y.end());
+
+        // Add up the gravitational pull on every mass and move them, as many times
+        // as the integrator needs
+        {
+            SOLARSIM_PROFILE_SCOPE(ProfilePhase::Integrate);
+            Scheme::template integrate<Forces>(bodies, dt, pin);
+        }
+
+        {
+            SOLARSIM_PROFILE_SCOPE(ProfilePhase::Collisions);
+            collide(bodies, dt);
+            pin.hold(bodies);
+        }
+
+        // Checks if mass is 0 then deletes it so it's not used in calculating
+        // acceleration of other masses (only merges leave any behind)
+        {
+            SOLARSIM_PROFILE_SCOPE(ProfilePhase::RemoveDead);
+            bodies.removeDead();
+        }
+
+        // Kept current every step only for the tree broad phase; otherwise nothing reads it
+        // between steps and SelectAt brings it up to date the odd time someone clicks
+        if (broadPhase == BroadPhase::AabbTree) {
+            SOLARSIM_PROFILE_SCOPE(ProfilePhase::Index);
+            spatialIndex.update(bodies, dt * kIndexLookAheadSteps);
+        } else {
+            spatialIndex.markStale();
+        }
+
+        simFrame++;
+        simSeconds += dt;
+    }
+
+private:
+    // Bounces or merges every pair that touched during the step. The broad phase boxes
+    // cover each body's whole path, so a fast body can't skip through another between
+    // steps. Touching pairs are split into islands that share no bodies and the islands
+    // are resolved in parallel, each one on its own in a fixed order, so the result is
+    // the same bit for bit on any number of threads. Within an island, pairs already
+    // overlapping when the step began get the end-of-step response in i < j order; the
+    // rest are handled at their time of impact, earliest first. A body gets one such
+    // event per step, after which any further contacts it has fall back to the
+    // end-of-step test.
+    static void collide(BodySystem& bodies, double dt) {
+        if (broadPhase == BroadPhase::AabbTree) {
+            spatialIndex.update(bodies, startX.data(), startY.data(), dt * kIndexLookAheadSteps);
+            spatialIndex.findPairs(candidatePairs);
+        } else {
+            sweepAndPrune.findCandidates(bodies, startX.data(), startY.data(), candidatePairs);
+        }
+        islands.build(bodies, startX.data(), startY.data(), candidatePairs);
+
+        const size_t count = islands.islandCount();
+        islandCollisions.assign(count, 0);
+        islandSwept.assign(count, 0);
+        if (islands.sweptContacts > 0) hitThisStep.assign(bodies.size(), 0);
+
+        threadPool.parallelFor(0, count, kIslandGrain, [&](size_t begin, size_t end) {
+            for (size_t island = begin; island < end; ++island) resolveIsland(bodies, dt, island);
+        });
+
+        collisionStats.bodies = bodies.size();
+        collisionStats.candidatePairs = candidatePairs.size();
+        collisionStats.collisions = 0;
+        collisionStats.swept = 0;
+        collisionStats.islands = count;
+        collisionStats.largestIsland = islands.largestIsland;
+        for (size_t island = 0; island < count; ++island) {
+            collisionStats.collisions += islandCollisions[island];
+            collisionStats.swept += islandSwept[island];
+        }
+    }
+
+    // Only touches the island's own bodies and contacts
+    static void resolveIsland(BodySystem& bodies, double dt, size_t island) {
+        Contact* first = islands.contacts.data() + islands.islandBegin[island];
+        Contact* last = islands.contacts.data() + islands.islandBegin[island + 1];
+        uint32_t collisions = 0;
+        uint32_t swept = 0;
+
+        // An earlier pair in the island may already have pushed this one apart
+        Contact* c = first;
+        for (; c != last && c->t < 0.0; ++c) {
+            if (checkCollision(bodies, c->i, c->j)) {
+                collisions++;
+                Collisions::resolve(bodies, c->i, c->j);
+            }
+        }
+
+        std::sort(c, last, [](const Contact& a, const Contact& b) {
+            return a.t < b.t || (a.t == b.t && (a.i < b.i || (a.i == b.i && a.j < b.j)));
+        });
+        for (; c != last; ++c) {
+            if (hitThisStep[c->i] || hitThisStep[c->j]) {
+                if (checkCollision(bodies, c->i, c->j)) {
+                    collisions++;
+                    Collisions::resolve(bodies, c->i, c->j);
+                }
+                continue;
+            }
+            hitThisStep[c->i] = hitThisStep[c->j] = 1;
+            collisions++;
+            swept++;
+            Collisions::resolveAt(bodies, startX.data(), startY.data(), c->i, c->j, c->t, dt);
+        }
+
+        islandCollisions[island] = collisions;
+        islandSwept[island] = swept;
+    }
+};
+
+template <class Scheme, class Forces, class Collisions>
+StepFunction selectPin(bool pinned) {
+    if (pinned) return &Simulation<Scheme, Forces, Collisions, PinnedBody>::step;
+    return &Simulation<Scheme, Forces, Collisions, NoPin>::step;
+}
+
+template <class Scheme, class Forces>
+StepFunction selectCollisions(CollisionMode mode, bool pinned) {
+    switch (mode) {
+        case CollisionMode::Bounce: return selectPin<Scheme, Forces, BounceCollisions>(pinned);
+        case CollisionMode::Merge: return selectPin<Scheme, Forces, MergeCollisions>(pinned);
+    }
+    return nullptr;
+}
+
+template <class Scheme>
+StepFunction selectForces(ForceSolver solver, CollisionMode mode, bool pinned) {
+    switch (solver) {
+        case ForceSolver::Direct: return selectCollisions<Scheme, DirectForces>(mode, pinned);
+        case ForceSolver::BarnesHut: return selectCollisions<Scheme, BarnesHutForces>(mode, pinned);
+        case ForceSolver::ParticleMesh: return selectCollisions<Scheme, ParticleMeshForces>(mode, pinned);
+    }
+    return nullptr;
+}
+
+} // namespace
+
+const char* collisionModeName(CollisionMode mode) {
+    switch (mode) {
+        case CollisionMode::Bounce: return "Bounce";
+        case CollisionMode::Merge: return "Merge";
+    }
+    return "Unknown";
+}
+
+bool collisionModeFromName(const char* name, CollisionMode& mode) {
+    if (std::strcmp(name, "bounce") == 0) {
+        mode = CollisionMode::Bounce;
+    } else if (std::strcmp(name, "merge") == 0) {
+        mode = CollisionMode::Merge;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+StepFunction selectStep(Integrator scheme, ForceSolver solver, CollisionMode mode, bool pinned) {
+    switch (scheme) {
+        case Integrator::SemiImplicitEuler: return selectForces<EulerScheme>(solver, mode, pinned);
+        case Integrator::Leapfrog: return selectForces<LeapfrogScheme>(solver, mode, pinned);
+        case Integrator::Yoshida4: return selectForces<Yoshida4Scheme>(solver, mode, pinned);
+        // The block stepper reads forceSolver itself, one instantiation covers both solvers
+        case Integrator::BlockLeapfrog: return selectCollisions<BlockScheme, SelectedForces>(mode, pinned);
+    }
+    return nullptr;
+}
+
+void stepSimulation(BodySystem& bodies, double dt) {
+    // A pinned body that merged away releases the pin
+    size_t pinnedIndex = 0;
+    if (!pinnedBody.isNull() && !bodies.find(pinnedBody, pinnedIndex)) pinnedBody = BodyHandle{};
+
+    selectStep(integrator, forceSolver, collisionMode, !pinnedBody.isNull())(bodies, dt);
+}
+
+bool pinBodyByName(const BodySystem& bodies, std::string_view name) {
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        if (std::string_view(bodies.info[i].name.str()) == name) {
+            pinnedBody = bodies.handle(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace SolarSim
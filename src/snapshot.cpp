@@ -0,0 +1,422 @@
+#include "snapshot.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "blocktimestep.h"
+
+namespace SolarSim {
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'O', 'L', 'A', 'R', 'S', 'N', 'P'};
+
+// Bytes staged before each write() call
+constexpr size_t kWriteChunk = 1 << 20;
+
+// The columns are written and mapped as raw host memory
+void requireLittleEndian() {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    throw std::runtime_error("Snapshots are little-endian only, this host is big-endian");
+#endif
+}
+
+size_t alignUp(size_t value) {
+    return (value + kSnapshotAlignment - 1) / kSnapshotAlignment * kSnapshotAlignment;
+}
+
+size_t elementBytes(SnapshotColumn c) {
+    switch (c) {
+        case SnapshotColumn::X: case SnapshotColumn::Y:
+        case SnapshotColumn::VX: case SnapshotColumn::VY:
+        case SnapshotColumn::AX: case SnapshotColumn::AY:
+            return sizeof(double);
+        case SnapshotColumn::Mass: case SnapshotColumn::Radius:
+        case SnapshotColumn::R: case SnapshotColumn::G: case SnapshotColumn::B:
+            return sizeof(float);
+        case SnapshotColumn::StepLevel:
+        case SnapshotColumn::NameChars:
+            return 1;
+        case SnapshotColumn::NameOffsets:
+            return sizeof(uint64_t);
+        case SnapshotColumn::Count:
+            break;
+    }
+    return 0;
+}
+
+size_t elementCount(SnapshotColumn c, size_t bodyCount, size_t nameBytes) {
+    if (c == SnapshotColumn::NameOffsets) return bodyCount + 1;
+    if (c == SnapshotColumn::NameChars) return nameBytes;
+    return bodyCount;
+}
+
+// Buffered writer over a raw file descriptor
+class ChunkWriter {
+public:
+    explicit ChunkWriter(const std::string& path) : path(path) {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Unable to create " + path + ": " + std::strerror(errno));
+        }
+        buffer.reserve(kWriteChunk);
+    }
+
+    ~ChunkWriter() {
+        if (fd >= 0) ::close(fd);
+    }
+
+    void write(const void* data, size_t bytes) {
+        const unsigned char* from = static_cast<const unsigned char*>(data);
+        while (bytes > 0) {
+            size_t take = std::min(bytes, kWriteChunk - buffer.size());
+            buffer.insert(buffer.end(), from, from + take);
+            from += take;
+            bytes -= take;
+            offset += take;
+            if (buffer.size() == kWriteChunk) flush();
+        }
+    }
+
+    template <typename T>
+    void put(const T& value) { write(&value, sizeof(T)); }
+
+    void padTo(size_t target) {
+        static const unsigned char zeros[kSnapshotAlignment] = {};
+        while (offset < target) write(zeros, std::min(target - offset, sizeof(zeros)));
+    }
+
+    void flush() {
+        const unsigned char* from = buffer.data();
+        size_t left = buffer.size();
+        while (left > 0) {
+            ssize_t done = ::write(fd, from, left);
+            if (done < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("Writing " + path + " failed: " + std::strerror(errno));
+            }
+            from += done;
+            left -= static_cast<size_t>(done);
+        }
+        buffer.clear();
+    }
+
+    void finish() {
+        flush();
+        if (::close(fd) != 0) {
+            fd = -1;
+            throw std::runtime_error("Closing " + path + " failed: " + std::strerror(errno));
+        }
+        fd = -1;
+    }
+
+    size_t offset = 0;
+
+private:
+    std::string path;
+    int fd = -1;
+    std::vector<unsigned char> buffer;
+};
+
+} // namespace
+
+void writeSnapshot(const std::string& path, const BodySystem& bodies, long long frame, double seconds) {
+    requireLittleEndian();
+
+    const size_t n = bodies.size();
+    size_t nameBytes = 0;
+    for (const BodyInfo& info : bodies.info) nameBytes += info.name.size();
+
+    // Work out where everything goes before writing a byte, so the file is one forward pass
+    SnapshotHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kSnapshotVersion;
+    header.headerBytes = sizeof(SnapshotHeader);
+    header.bodyCount = n;
+    header.simFrame = frame;
+    header.simSeconds = seconds;
+
+    size_t offset = sizeof(SnapshotHeader);
+    for (size_t c = 0; c < kSnapshotColumnCount; ++c) {
+        SnapshotColumn column = static_cast<SnapshotColumn>(c);
+        offset = alignUp(offset);
+        header.columnOffset[c] = offset;
+        offset += elementBytes(column) * elementCount(column, n, nameBytes);
+    }
+    header.fileBytes = offset;
+
+    ChunkWriter out(path);
+    out.put(header);
+
+    auto column = [&](SnapshotColumn c, const void* data) {
+        out.padTo(header.columnOffset[static_cast<size_t>(c)]);
+        out.write(data, elementBytes(c) * elementCount(c, n, nameBytes));
+    };
+    column(SnapshotColumn::X, bodies.x.data());
+    column(SnapshotColumn::Y, bodies.y.data());
+    column(SnapshotColumn::VX, bodies.vx.data());
+    column(SnapshotColumn::VY, bodies.vy.data());
+    column(SnapshotColumn::AX, bodies.ax.data());
+    column(SnapshotColumn::AY, bodies.ay.data());
+    column(SnapshotColumn::Mass, bodies.mass.data());
+    column(SnapshotColumn::Radius, bodies.radius.data());
+
+    // Colors and names live in BodyInfo, so those columns are gathered as they stream out
+    out.padTo(header.columnOffset[static_cast<size_t>(SnapshotColumn::R)]);
+    for (const BodyInfo& info : bodies.info) out.put(info.r);
+    out.padTo(header.columnOffset[static_cast<size_t>(SnapshotColumn::G)]);
+    for (const BodyInfo& info : bodies.info) out.put(info.g);
+    out.padTo(header.columnOffset[static_cast<size_t>(SnapshotColumn::B)]);
+    for (const BodyInfo& info : bodies.info) out.put(info.b);
+
+    column(SnapshotColumn::StepLevel, bodies.stepLevel.data());
+
+    out.padTo(header.columnOffset[static_cast<size_t>(SnapshotColumn::NameOffsets)]);
+    uint64_t nameOffset = 0;
+    out.put(nameOffset);
+    for (const BodyInfo& info : bodies.info) {
+        nameOffset += info.name.size();
+        out.put(nameOffset);
+    }
+
+    out.padTo(header.columnOffset[static_cast<size_t>(SnapshotColumn::NameChars)]);
+    for (const BodyInfo& info : bodies.info) out.write(info.name.data(), info.name.size());
+
+    out.finish();
+}
+
+MappedSnapshot::~MappedSnapshot() {
+    close();
+}
+
+MappedSnapshot::MappedSnapshot(MappedSnapshot&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedSnapshot& MappedSnapshot::operator=(MappedSnapshot&& other) noexcept {
+    if (this != &other) {
+        close();
+        path = std::move(other.path);
+        base = other.base;
+        mappedBytes = other.mappedBytes;
+        header = other.header;
+        other.base = nullptr;
+        other.mappedBytes = 0;
+        other.header = nullptr;
+    }
+    return *this;
+}
+
+void MappedSnapshot::open(const std::string& file) {
+    close();
+    requireLittleEndian();
+    path = file;
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Unable to open " + path + ": " + std::strerror(errno));
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(SnapshotHeader))) {
+        ::close(fd);
+        throw std::runtime_error(path + " is too small to be a snapshot");
+    }
+
+    const size_t bytes = static_cast<size_t>(info.st_size);
+    void* mapping = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file alive
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Unable to map " + path + ": " + std::strerror(errno));
+    }
+
+    base = static_cast<const unsigned char*>(mapping);
+    mappedBytes = bytes;
+    header = reinterpret_cast<const SnapshotHeader*>(base);
+
+    // Check everything the accessors will trust before handing any of it out
+    auto fail = [&](const std::string& why) {
+        close();
+        throw std::runtime_error(path + ": " + why);
+    };
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0) fail("not a SolarSim snapshot");
+    if (header->version != kSnapshotVersion) fail("unsupported snapshot version " + std::to_string(header->version));
+    if (header->headerBytes != sizeof(SnapshotHeader)) fail("unexpected header size");
+    if (header->fileBytes != bytes) fail("truncated or padded file");
+
+    const size_t n = static_cast<size_t>(header->bodyCount);
+    const size_t offsetsAt = static_cast<size_t>(header->columnOffset[static_cast<size_t>(SnapshotColumn::NameOffsets)]);
+    if (offsetsAt % alignof(uint64_t) != 0 || offsetsAt + (n + 1) * sizeof(uint64_t) > bytes) fail("bad name table");
+    const uint64_t nameBytes = reinterpret_cast<const uint64_t*>(base + offsetsAt)[n];
+
+    for (size_t c = 0; c < kSnapshotColumnCount; ++c) {
+        SnapshotColumn column = static_cast<SnapshotColumn>(c);
+        size_t at = static_cast<size_t>(header->columnOffset[c]);
+        size_t length = elementBytes(column) * elementCount(column, n, static_cast<size_t>(nameBytes));
+        if (at % kSnapshotAlignment != 0 || at > bytes || length > bytes - at) fail("column out of range");
+    }
+    // Individual name offsets and step levels aren't walked here, that would touch every
+    // page of a big file: name() checks its own offsets, copyTo() walks all of them
+}
+
+void MappedSnapshot::close() {
+    if (base) ::munmap(const_cast<unsigned char*>(base), mappedBytes);
+    base = nullptr;
+    mappedBytes = 0;
+    header = nullptr;
+}
+
+void MappedSnapshot::corrupt(const std::string& why) const {
+    throw std::runtime_error(path + ": " + why);
+}
+
+std::string_view MappedSnapshot::name(size_t i) const {
+    const uint64_t* offsets = column<uint64_t>(SnapshotColumn::NameOffsets);
+    const char* chars = column<char>(SnapshotColumn::NameChars);
+    // open() checked the column holds offsets[n] characters, the offsets in between are checked here
+    if (offsets[i] > offsets[i + 1] || offsets[i + 1] > offsets[size()]) corrupt("bad name offset");
+    return std::string_view(chars + offsets[i], static_cast<size_t>(offsets[i + 1] - offsets[i]));
+}
+
+void MappedSnapshot::copyTo(BodySystem& bodies) const {
+    const size_t n = size();
+
+    // Offsets start at 0 and never go backwards, so each one is inside the name column and
+    // the last one is its length; levels are in range for the block integrator's tables
+    const uint64_t* offsets = column<uint64_t>(SnapshotColumn::NameOffsets);
+    if (offsets[0] != 0) corrupt("bad name offset");
+    for (size_t i = 0; i < n; ++i) {
+        if (offsets[i + 1] < offsets[i]) corrupt("bad name offset");
+    }
+    const uint8_t* levels = stepLevel();
+    for (size_t i = 0; i < n; ++i) {
+        if (levels[i] > kMaxStepLevel && levels[i] != BodySystem::kUnsetStepLevel) corrupt("bad step level");
+    }
+
+    bodies.clear();
+    if (n == 0) return;
+
+    // Sizes every column and hands out fresh handles, the data is then copied over the zeros
+    bodies.resize(n);
+    bodies.x.assign(x(), x() + n);
+    bodies.y.assign(y(), y() + n);
+    bodies.vx.assign(vx(), vx() + n);
+    bodies.vy.assign(vy(), vy() + n);
+    bodies.ax.assign(ax(), ax() + n);
+    bodies.ay.assign(ay(), ay() + n);
+    bodies.mass.assign(mass(), mass() + n);
+    bodies.radius.assign(radius(), radius() + n);
+    bodies.stepLevel.assign(stepLevel(), stepLevel() + n);
+
+    const char* chars = column<char>(SnapshotColumn::NameChars);
+    for (size_t i = 0; i < n; ++i) {
+        BodyInfo& info = bodies.info[i];
+        info.name = std::string_view(chars + offsets[i], static_cast<size_t>(offsets[i + 1] - offsets[i]));
+        info.r = r()[i];
+        info.g = g()[i];
+        info.b = b()[i];
+    }
+}
+
+Checkpointer::~Checkpointer() {
+    stop();
+}
+
+void Checkpointer::start(const std::string& file, double intervalSeconds) {
+    stop();
+    path = file;
+    interval = intervalSeconds;
+    lastCheckpoint = std::chrono::steady_clock::now();
+    stopping = false;
+    thread = std::thread(&Checkpointer::run, this);
+}
+
+void Checkpointer::stop() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (thread.joinable()) thread.join();
+}
+
+void Checkpointer::maybeCheckpoint(const BodySystem& bodies, long long frame, double seconds) {
+    if (!enabled() || interval <= 0.0) return;
+
+    auto now = std::chrono::steady_clock::now();
+    if (std::chrono::duration<double>(now - lastCheckpoint).count() < interval) return;
+
+    if (checkpoint(bodies, frame, seconds)) lastCheckpoint = now;
+}
+
+bool Checkpointer::checkpoint(const BodySystem& bodies, long long frame, double seconds) {
+    if (!enabled()) return false;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (busy) return false;
+        busy = true;
+    }
+
+    // Only this thread touches staged until pending is handed over. The vectors keep
+    // their capacity between checkpoints so this is a straight copy, no allocation.
+    staged.x.assign(bodies.x.begin(), bodies.x.end());
+    staged.y.assign(bodies.y.begin(), bodies.y.end());
+    staged.vx.assign(bodies.vx.begin(), bodies.vx.end());
+    staged.vy.assign(bodies.vy.begin(), bodies.vy.end());
+    staged.ax.assign(bodies.ax.begin(), bodies.ax.end());
+    staged.ay.assign(bodies.ay.begin(), bodies.ay.end());
+    staged.mass.assign(bodies.mass.begin(), bodies.mass.end());
+    staged.radius.assign(bodies.radius.begin(), bodies.radius.end());
+    staged.stepLevel.assign(bodies.stepLevel.begin(), bodies.stepLevel.end());
+    staged.info.assign(bodies.info.begin(), bodies.info.end());
+    stagedFrame = frame;
+    stagedSeconds = seconds;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        pending = true;
+    }
+    wake.notify_one();
+    return true;
+}
+
+void Checkpointer::run() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        wake.wait(guard, [&] { return pending || stopping; });
+        if (!pending) return; // stopping with nothing left to write
+
+        pending = false;
+        guard.unlock();
+
+        auto start = std::chrono::steady_clock::now();
+        try {
+            std::string temp = path + ".tmp";
+            writeSnapshot(temp, staged, stagedFrame, stagedSeconds);
+            if (std::rename(temp.c_str(), path.c_str()) != 0) {
+                throw std::runtime_error("Unable to replace " + path + ": " + std::strerror(errno));
+            }
+            writtenCount++;
+            lastWriteTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } catch (const std::exception& e) {
+            // Losing one checkpoint isn't worth taking the simulation down for
+            std::cerr << "Checkpoint failed: " << e.what() << '\n';
+        }
+
+        guard.lock();
+        busy = false;
+    }
+}
+
+} // namespace SolarSim
@@ -0,0 +1,557 @@
+#include "spatialindex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <utility>
+
+#include "bodysystem.h"
+#include "simglobals.h"
+
+namespace SolarSim {
+
+namespace {
+
+// Padding every leaf box gets on each side, in body radii
+constexpr double kPadRadii = 0.5;
+
+// For plain circles, how many updates' worth of their last motion a box is padded by
+constexpr double kPadUpdates = 4.0;
+
+// Past one leaf in this many moving in one update, the tree is rebuilt instead
+constexpr size_t kRebuildShare = 4;
+
+// The pair search is split into about this many subtrees per thread
+constexpr size_t kPairTasksPerThread = 8;
+
+// Half the perimeter: in 2D the chance a random query hits a box grows with it
+double cost(double minX, double minY, double maxX, double maxY) {
+    return (maxX - minX) + (maxY - minY);
+}
+
+} // namespace
+
+template <class Visit>
+void SpatialIndex::visitOverlapping(const Box& box, std::vector<int32_t>& stack, Visit&& visit) const {
+    stack.clear();
+    if (root != kNull) stack.push_back(root);
+    while (!stack.empty()) {
+        const int32_t id = stack.back();
+        stack.pop_back();
+        const Node& node = nodes[id];
+        if (node.box.maxX < box.minX || node.box.minX > box.maxX || node.box.maxY < box.minY ||
+            node.box.minY > box.maxY) {
+            continue;
+        }
+        if (node.left == kNull) {
+            visit(id);
+        } else {
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+}
+
+void SpatialIndex::update(const BodySystem& bodies, double lookAhead) {
+    refit(bodies.size(), bodies.x.data(), bodies.y.data(), bodies.radius.data(), bodies.slotOf.data(), nullptr,
+          nullptr, bodies.vx.data(), bodies.vy.data(), lookAhead);
+    layout = bodies.layoutVersion();
+    fromBodies = true;
+}
+
+void SpatialIndex::update(const BodySystem& bodies, const double* startX, const double* startY, double lookAhead) {
+    refit(bodies.size(), bodies.x.data(), bodies.y.data(), bodies.radius.data(), bodies.slotOf.data(), startX,
+          startY, bodies.vx.data(), bodies.vy.data(), lookAhead);
+    layout = bodies.layoutVersion();
+    fromBodies = true;
+}
+
+void SpatialIndex::update(size_t count, const double* x, const double* y, const float* radius, const uint32_t* keys) {
+    refit(count, x, y, radius, keys, nullptr, nullptr, nullptr, nullptr, 0.0);
+    fromBodies = false;
+}
+
+void SpatialIndex::clear() {
+    nodes.clear();
+    root = kNull;
+    freeList = kNull;
+    leafOfKey.clear();
+    leafOfIndex.clear();
+    fromBodies = false;
+    current = SpatialIndexStats{};
+}
+
+bool SpatialIndex::matches(const BodySystem& bodies) const {
+    return fromBodies && layout == bodies.layoutVersion() && leafOfIndex.size() == bodies.size();
+}
+
+void SpatialIndex::refit(size_t count, const double* x, const double* y, const float* radius, const uint32_t* keys,
+                         const double* startX, const double* startY, const double* vx, const double* vy,
+                         double lookAhead) {
+    stamp++;
+    leafOfIndex.resize(count);
+    moved.clear();
+
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t key = keys ? keys[i] : static_cast<uint32_t>(i);
+        if (key >= leafOfKey.size()) leafOfKey.resize(static_cast<size_t>(key) + 1, kNull);
+
+        const double r = radius[i];
+        Box tight;
+        if (startX) {
+            tight = {std::min(startX[i], x[i]) - r, std::min(startY[i], y[i]) - r, std::max(startX[i], x[i]) + r,
+                     std::max(startY[i], y[i]) + r};
+        } else {
+            tight = {x[i] - r, y[i] - r, x[i] + r, y[i] + r};
+        }
+
+        int32_t leaf = leafOfKey[key];
+        const bool added = leaf == kNull;
+        if (added) {
+            leaf = allocateNode();
+            leafOfKey[key] = leaf;
+        }
+
+        // Expected motion before the box next has to hold the body
+        Node& node = nodes[leaf];
+        double moveX = 0.0, moveY = 0.0;
+        if (vx) {
+            moveX = vx[i] * lookAhead;
+            moveY = vy[i] * lookAhead;
+        } else if (!added) {
+            moveX = (x[i] - node.x) * kPadUpdates;
+            moveY = (y[i] - node.y) * kPadUpdates;
+        }
+
+        node.tight = tight;
+        node.x = x[i];
+        node.y = y[i];
+        node.radius = radius[i];
+        node.index = static_cast<uint32_t>(i);
+        node.seen = stamp;
+        leafOfIndex[i] = leaf;
+
+        const bool inside = !added && tight.minX >= node.box.minX && tight.minY >= node.box.minY &&
+                            tight.maxX <= node.box.maxX && tight.maxY <= node.box.maxY;
+        if (inside) continue;
+
+        // The new box is set straight away; the tree above it catches up below
+        const double pad = kPadRadii * r;
+        node.box = {tight.minX - pad + std::min(moveX, 0.0), tight.minY - pad + std::min(moveY, 0.0),
+                    tight.maxX + pad + std::max(moveX, 0.0), tight.maxY + pad + std::max(moveY, 0.0)};
+        moved.push_back(leaf);
+    }
+    current.reinserted = moved.size();
+
+    // Whatever wasn't seen has gone
+    for (int32_t& leaf : leafOfKey) {
+        if (leaf == kNull || nodes[leaf].seen == stamp) continue;
+        removeLeaf(leaf);
+        freeNode(leaf);
+        leaf = kNull;
+        current.reinserted++;
+    }
+
+    if (moved.size() * kRebuildShare > count) {
+        rebuild();
+    } else {
+        for (int32_t leaf : moved) {
+            // Freshly allocated leaves aren't in the tree yet
+            if (leaf == root || nodes[leaf].parent != kNull) removeLeaf(leaf);
+            insertLeaf(leaf);
+        }
+    }
+
+    current.leaves = count;
+    current.height = root == kNull ? 0 : nodes[root].height;
+}
+
+void SpatialIndex::rebuild() {
+    for (size_t id = 0; id < nodes.size(); ++id) {
+        if (nodes[id].height > 0) freeNode(static_cast<int32_t>(id));
+    }
+    moved.assign(leafOfIndex.begin(), leafOfIndex.end());
+    root = moved.empty() ? kNull : buildRange(moved.data(), moved.data() + moved.size());
+    if (root != kNull) nodes[root].parent = kNull;
+}
+
+// Splits the leaves at the median of their box centres along the wider spread of them
+int32_t SpatialIndex::buildRange(int32_t* first, int32_t* last) {
+    if (last - first == 1) return *first;
+
+    double minX = nodes[*first].box.minX + nodes[*first].box.maxX, maxX = minX;
+    double minY = nodes[*first].box.minY + nodes[*first].box.maxY, maxY = minY;
+    for (const int32_t* leaf = first; leaf != last; ++leaf) {
+        const Box& box = nodes[*leaf].box;
+        minX = std::min(minX, box.minX + box.maxX);
+        maxX = std::max(maxX, box.minX + box.maxX);
+        minY = std::min(minY, box.minY + box.maxY);
+        maxY = std::max(maxY, box.minY + box.maxY);
+    }
+    const bool alongX = maxX - minX >= maxY - minY;
+    int32_t* middle = first + (last - first) / 2;
+    std::nth_element(first, middle, last, [&](int32_t a, int32_t b) {
+        const Box& boxA = nodes[a].box;
+        const Box& boxB = nodes[b].box;
+        return alongX ? boxA.minX + boxA.maxX < boxB.minX + boxB.maxX : boxA.minY + boxA.maxY < boxB.minY + boxB.maxY;
+    });
+
+    const int32_t left = buildRange(first, middle);
+    const int32_t right = buildRange(middle, last);
+    const int32_t parent = allocateNode();
+    Node& node = nodes[parent];
+    node.left = left;
+    node.right = right;
+    nodes[left].parent = parent;
+    nodes[right].parent = parent;
+
+    const Node& l = nodes[left];
+    const Node& r = nodes[right];
+    node.height = 1 + std::max(l.height, r.height);
+    node.box = {std::min(l.box.minX, r.box.minX), std::min(l.box.minY, r.box.minY), std::max(l.box.maxX, r.box.maxX),
+                std::max(l.box.maxY, r.box.maxY)};
+    return parent;
+}
+
+int32_t SpatialIndex::allocateNode() {
+    int32_t id;
+    if (freeList != kNull) {
+        id = freeList;
+        freeList = nodes[id].parent;
+    } else {
+        id = static_cast<int32_t>(nodes.size());
+        nodes.emplace_back();
+    }
+    Node& node = nodes[id];
+    node.parent = kNull;
+    node.left = kNull;
+    node.right = kNull;
+    node.height = 0;
+    node.seen = 0;
+    return id;
+}
+
+void SpatialIndex::freeNode(int32_t id) {
+    nodes[id].parent = freeList;
+    nodes[id].height = -1;
+    freeList = id;
+}
+
+void SpatialIndex::insertLeaf(int32_t leaf) {
+    if (root == kNull) {
+        root = leaf;
+        nodes[leaf].parent = kNull;
+        return;
+    }
+
+    // Walk down towards the cheapest sibling: the node whose box grows the least
+    // (counting the growth of every box above it) when the leaf joins it
+    const Box leafBox = nodes[leaf].box;
+    int32_t sibling = root;
+    while (nodes[sibling].left != kNull) {
+        const Node& node = nodes[sibling];
+        const double area = cost(node.box.minX, node.box.minY, node.box.maxX, node.box.maxY);
+        const double combined = cost(std::min(node.box.minX, leafBox.minX), std::min(node.box.minY, leafBox.minY),
+                                     std::max(node.box.maxX, leafBox.maxX), std::max(node.box.maxY, leafBox.maxY));
+
+        // Pairing with this node: a new parent over both. Going further down: this
+        // node's box grows either way, plus whatever the child's does.
+        const double here = 2.0 * combined;
+        const double inherited = 2.0 * (combined - area);
+
+        auto descend = [&](int32_t child) {
+            const Box& b = nodes[child].box;
+            const double grown = cost(std::min(b.minX, leafBox.minX), std::min(b.minY, leafBox.minY),
+                                      std::max(b.maxX, leafBox.maxX), std::max(b.maxY, leafBox.maxY));
+            if (nodes[child].left == kNull) return grown + inherited;
+            return grown - cost(b.minX, b.minY, b.maxX, b.maxY) + inherited;
+        };
+        const double left = descend(node.left);
+        const double right = descend(node.right);
+
+        if (here < left && here < right) break;
+        sibling = left < right ? node.left : node.right;
+    }
+
+    const int32_t oldParent = nodes[sibling].parent;
+    const int32_t parent = allocateNode();
+    Node& joined = nodes[parent];
+    joined.parent = oldParent;
+    joined.left = sibling;
+    joined.right = leaf;
+    joined.height = nodes[sibling].height + 1;
+    const Box& siblingBox = nodes[sibling].box;
+    joined.box = {std::min(siblingBox.minX, leafBox.minX), std::min(siblingBox.minY, leafBox.minY),
+                  std::max(siblingBox.maxX, leafBox.maxX), std::max(siblingBox.maxY, leafBox.maxY)};
+
+    if (oldParent == kNull) {
+        root = parent;
+    } else if (nodes[oldParent].left == sibling) {
+        nodes[oldParent].left = parent;
+    } else {
+        nodes[oldParent].right = parent;
+    }
+    nodes[sibling].parent = parent;
+    nodes[leaf].parent = parent;
+
+    refitUpwards(parent);
+}
+
+void SpatialIndex::removeLeaf(int32_t leaf) {
+    if (leaf == root) {
+        root = kNull;
+        return;
+    }
+
+    // The leaf's parent goes too; its other child takes the parent's place
+    const int32_t parent = nodes[leaf].parent;
+    const int32_t grandparent = nodes[parent].parent;
+    const int32_t sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+    freeNode(parent);
+    nodes[leaf].parent = kNull;
+
+    if (grandparent == kNull) {
+        root = sibling;
+        nodes[sibling].parent = kNull;
+        return;
+    }
+    if (nodes[grandparent].left == parent) {
+        nodes[grandparent].left = sibling;
+    } else {
+        nodes[grandparent].right = sibling;
+    }
+    nodes[sibling].parent = grandparent;
+    refitUpwards(grandparent);
+}
+
+void SpatialIndex::refitUpwards(int32_t id) {
+    while (id != kNull) {
+        id = balance(id);
+        Node& node = nodes[id];
+        const Node& left = nodes[node.left];
+        const Node& right = nodes[node.right];
+        node.height = 1 + std::max(left.height, right.height);
+        node.box = {std::min(left.box.minX, right.box.minX), std::min(left.box.minY, right.box.minY),
+                    std::max(left.box.maxX, right.box.maxX), std::max(left.box.maxY, right.box.maxY)};
+        id = node.parent;
+    }
+}
+
+// If one child of `a` is two or more levels taller than the other, rotates it up into
+// a's place and hands its shorter child to `a`. Returns whichever node now sits there.
+int32_t SpatialIndex::balance(int32_t a) {
+    Node& nodeA = nodes[a];
+    if (nodeA.left == kNull) return a;
+
+    auto join = [&](Node& node, int32_t first, int32_t second) {
+        const Node& p = nodes[first];
+        const Node& q = nodes[second];
+        node.box = {std::min(p.box.minX, q.box.minX), std::min(p.box.minY, q.box.minY),
+                    std::max(p.box.maxX, q.box.maxX), std::max(p.box.maxY, q.box.maxY)};
+        node.height = 1 + std::max(p.height, q.height);
+    };
+
+    const int32_t b = nodeA.left;
+    const int32_t c = nodeA.right;
+    const int32_t skew = nodes[c].height - nodes[b].height;
+    if (skew >= -1 && skew <= 1) return a;
+
+    // `up` is the taller child, `stay` the other one
+    const bool rightTaller = skew > 1;
+    const int32_t up = rightTaller ? c : b;
+    const int32_t stay = rightTaller ? b : c;
+    Node& nodeUp = nodes[up];
+    const int32_t f = nodeUp.left;
+    const int32_t g = nodeUp.right;
+
+    // `up` replaces `a` under a's parent, with `a` as its first child
+    nodeUp.left = a;
+    nodeUp.parent = nodeA.parent;
+    nodeA.parent = up;
+    if (nodeUp.parent == kNull) {
+        root = up;
+    } else if (nodes[nodeUp.parent].left == a) {
+        nodes[nodeUp.parent].left = up;
+    } else {
+        nodes[nodeUp.parent].right = up;
+    }
+
+    // The taller of up's children stays with it, the shorter one moves under `a`
+    const int32_t keep = nodes[f].height > nodes[g].height ? f : g;
+    const int32_t give = keep == f ? g : f;
+    nodeUp.right = keep;
+    if (rightTaller) {
+        nodeA.right = give;
+    } else {
+        nodeA.left = give;
+    }
+    nodes[give].parent = a;
+
+    join(nodeA, stay, give);
+    join(nodeUp, a, keep);
+    return up;
+}
+
+int SpatialIndex::pick(double x, double y) const {
+    std::vector<int32_t> stack;
+    int best = -1;
+    double bestDistSquared = 0.0;
+    visitOverlapping(Box{x, y, x, y}, stack, [&](int32_t leaf) {
+        const Node& node = nodes[leaf];
+        const double dx = x - node.x;
+        const double dy = y - node.y;
+        const double distSquared = dx * dx + dy * dy;
+        const double r = node.radius;
+        if (distSquared > r * r) return;
+        const int index = static_cast<int>(node.index);
+        if (best < 0 || distSquared < bestDistSquared || (distSquared == bestDistSquared && index < best)) {
+            best = index;
+            bestDistSquared = distSquared;
+        }
+    });
+    return best;
+}
+
+void SpatialIndex::queryBox(double minX, double minY, double maxX, double maxY, std::vector<uint32_t>& out) const {
+    out.clear();
+    std::vector<int32_t> stack;
+    visitOverlapping(Box{minX, minY, maxX, maxY}, stack, [&](int32_t leaf) {
+        // Nearest point of the box to the centre
+        const Node& node = nodes[leaf];
+        const double dx = node.x - std::clamp(node.x, minX, maxX);
+        const double dy = node.y - std::clamp(node.y, minY, maxY);
+        const double r = node.radius;
+        if (dx * dx + dy * dy <= r * r) out.push_back(node.index);
+    });
+    std::sort(out.begin(), out.end());
+}
+
+void SpatialIndex::queryRadius(double x, double y, double range, std::vector<uint32_t>& out) const {
+    out.clear();
+    std::vector<int32_t> stack;
+    visitOverlapping(Box{x - range, y - range, x + range, y + range}, stack, [&](int32_t leaf) {
+        const Node& node = nodes[leaf];
+        const double dx = x - node.x;
+        const double dy = y - node.y;
+        const double reach = range + node.radius;
+        if (dx * dx + dy * dy <= reach * reach) out.push_back(node.index);
+    });
+    std::sort(out.begin(), out.end());
+}
+
+void SpatialIndex::nearest(double x, double y, size_t k, std::vector<uint32_t>& out) const {
+    out.clear();
+    if (k == 0 || root == kNull) return;
+
+    // Best first: nodes come off `open` closest box first, and once k centres are in
+    // hand any box further than the kth can't hold a better one
+    using Entry = std::pair<double, int64_t>; // squared distance, node or circle index
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+    std::priority_queue<Entry> found; // worst of the best k on top
+
+    auto boxDistSquared = [&](const Box& box) {
+        const double dx = x - std::clamp(x, box.minX, box.maxX);
+        const double dy = y - std::clamp(y, box.minY, box.maxY);
+        return dx * dx + dy * dy;
+    };
+
+    open.emplace(boxDistSquared(nodes[root].box), root);
+    while (!open.empty()) {
+        const auto [distSquared, id] = open.top();
+        open.pop();
+        if (found.size() == k && distSquared > found.top().first) break;
+
+        const Node& node = nodes[id];
+        if (node.left != kNull) {
+            open.emplace(boxDistSquared(nodes[node.left].box), node.left);
+            open.emplace(boxDistSquared(nodes[node.right].box), node.right);
+            continue;
+        }
+
+        const double dx = x - node.x;
+        const double dy = y - node.y;
+        const Entry candidate(dx * dx + dy * dy, node.index);
+        if (found.size() < k) {
+            found.push(candidate);
+        } else if (candidate < found.top()) {
+            found.pop();
+            found.push(candidate);
+        }
+    }
+
+    out.resize(found.size());
+    for (size_t n = found.size(); n-- > 0;) {
+        out[n] = static_cast<uint32_t>(found.top().second);
+        found.pop();
+    }
+}
+
+void SpatialIndex::findPairs(std::vector<BodyPair>& pairs) const {
+    pairs.clear();
+    if (root == kNull) return;
+
+    // Every overlapping pair of leaves sits either inside one subtree, or across the two
+    // children of some node. (a, a) stands for the pairs within a, (a, b) for those across.
+    using Task = std::pair<int32_t, int32_t>;
+    auto expand = [&](const Task& task, std::vector<Task>& out, std::vector<BodyPair>& found) {
+        const auto [a, b] = task;
+        const Node& nodeA = nodes[a];
+        if (a == b) {
+            if (nodeA.left == kNull) return;
+            out.emplace_back(nodeA.left, nodeA.left);
+            out.emplace_back(nodeA.right, nodeA.right);
+            out.emplace_back(nodeA.left, nodeA.right);
+            return;
+        }
+
+        const Node& nodeB = nodes[b];
+        if (nodeA.box.maxX < nodeB.box.minX || nodeA.box.minX > nodeB.box.maxX || nodeA.box.maxY < nodeB.box.minY ||
+            nodeA.box.minY > nodeB.box.maxY) {
+            return;
+        }
+        if (nodeA.left == kNull && nodeB.left == kNull) {
+            const Box& p = nodeA.tight;
+            const Box& q = nodeB.tight;
+            if (p.maxX < q.minX || p.minX > q.maxX || p.maxY < q.minY || p.minY > q.maxY) return;
+            found.emplace_back(std::min(nodeA.index, nodeB.index), std::max(nodeA.index, nodeB.index));
+            return;
+        }
+
+        // Open up the taller side
+        if (nodeB.left == kNull || (nodeA.left != kNull && nodeA.height >= nodeB.height)) {
+            out.emplace_back(nodeA.left, b);
+            out.emplace_back(nodeA.right, b);
+        } else {
+            out.emplace_back(a, nodeB.left);
+            out.emplace_back(a, nodeB.right);
+        }
+    };
+
+    // Breadth first until there's enough independent work to go round the pool
+    std::vector<Task> tasks{Task(root, root)};
+    std::vector<Task> next;
+    const size_t wanted = threadPool.size() * kPairTasksPerThread;
+    while (!tasks.empty() && tasks.size() < wanted) {
+        next.clear();
+        for (const Task& task : tasks) expand(task, next, pairs);
+        tasks.swap(next);
+    }
+
+    std::vector<std::vector<BodyPair>> found(tasks.size());
+    threadPool.parallelFor(0, tasks.size(), 1, [&](size_t begin, size_t end) {
+        std::vector<Task> stack;
+        for (size_t t = begin; t < end; ++t) {
+            stack.assign(1, tasks[t]);
+            while (!stack.empty()) {
+                const Task task = stack.back();
+                stack.pop_back();
+                expand(task, stack, found[t]);
+            }
+        }
+    });
+
+    for (const std::vector<BodyPair>& local : found) pairs.insert(pairs.end(), local.begin(), local.end());
+    std::sort(pairs.begin(), pairs.end());
+}
+
+} // namespace SolarSim
@@ -0,0 +1,59 @@
+#include "stepscheduler.h"
+
+#include <algorithm>
+
+namespace SolarSim {
+
+namespace {
+
+// Weight of the newest step in the smoothed step cost
+constexpr double kCostSmoothing = 0.2;
+
+// Shortest stretch the achieved speed is averaged over, wall seconds
+constexpr double kSpeedWindow = 0.5;
+
+// Slack when comparing owed sim time with a step, for rounding in the running sum
+constexpr double kOwedSlack = 1e-9;
+
+} // namespace
+
+double scheduledStepDt(double simSpeed, double maxDt, double ticksPerSecond) {
+    return std::min(maxDt, simSpeed / ticksPerSecond);
+}
+
+void StepScheduler::beginTick(double simSpeed, double maxDt, double ticksPerSecond) {
+    dt = scheduledStepDt(simSpeed, maxDt, ticksPerSecond);
+    owed += simSpeed / ticksPerSecond;
+    steps = 0;
+    current.requestedSpeed = simSpeed;
+    current.stepDt = dt;
+}
+
+bool StepScheduler::wantsStep(double elapsed) const {
+    if (dt <= 0.0 || owed < dt * (1.0 - kOwedSlack)) return false;
+    if (steps == 0) return true;
+    return elapsed + costEstimate <= budget;
+}
+
+void StepScheduler::stepDone(double wallSeconds) {
+    owed -= dt;
+    steps++;
+    windowSim += dt;
+    costEstimate = costEstimate > 0.0 ? costEstimate + kCostSmoothing * (wallSeconds - costEstimate) : wallSeconds;
+}
+
+void StepScheduler::endTick(double tickWallSeconds) {
+    current.budgetLimited = owed >= dt * (1.0 - kOwedSlack);
+    if (current.budgetLimited || owed < 0.0) owed = 0.0;
+    current.stepsLastTick = steps;
+    current.stepCost = costEstimate;
+
+    windowWall += tickWallSeconds;
+    if (windowWall >= kSpeedWindow) {
+        current.achievedSpeed = windowSim / windowWall;
+        windowSim = 0.0;
+        windowWall = 0.0;
+    }
+}
+
+} // namespace SolarSim
@@ -0,0 +1,65 @@
+#include "textformat.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+namespace SolarSim {
+
+namespace {
+
+// Enough for any long long or any double at the precisions the HUD uses
+constexpr size_t kNumberChars = 64;
+
+} // namespace
+
+void appendInt(std::string& out, long long value) {
+    char buffer[kNumberChars];
+    auto result = std::to_chars(buffer, buffer + kNumberChars, value);
+    out.append(buffer, result.ptr);
+}
+
+void appendPadded(std::string& out, long long value, int width) {
+    char buffer[kNumberChars];
+    // Magnitude in unsigned arithmetic, -LLONG_MIN doesn't fit in a long long
+    unsigned long long magnitude = static_cast<unsigned long long>(value);
+    if (value < 0) {
+        out += '-';
+        magnitude = 0 - magnitude;
+    }
+    auto result = std::to_chars(buffer, buffer + kNumberChars, magnitude);
+    for (int digits = static_cast<int>(result.ptr - buffer); digits < width; ++digits) out += '0';
+    out.append(buffer, result.ptr);
+}
+
+void appendFixed(std::string& out, double value, int decimals) {
+    char buffer[kNumberChars];
+    auto result = std::to_chars(buffer, buffer + kNumberChars, value, std::chars_format::fixed, decimals);
+    if (result.ec != std::errc()) {
+        // Too wide for fixed (|value| beyond ~1e40), not worth more than a marker on a HUD
+        out += value < 0.0 ? "-big" : "big";
+        return;
+    }
+    out.append(buffer, result.ptr);
+}
+
+void appendGeneral(std::string& out, double value, int precision) {
+    char buffer[kNumberChars];
+    auto result = std::to_chars(buffer, buffer + kNumberChars, value, std::chars_format::general, precision);
+    out.append(buffer, result.ptr);
+}
+
+void appendSimTime(std::string& out, double seconds) {
+    // Same split the HUD always used: whole days, then hours / minutes / seconds of the day
+    long long total = static_cast<long long>(std::floor(std::max(0.0, seconds)));
+    appendInt(out, total / 86400);
+    out += "d ";
+    appendPadded(out, (total % 86400) / 3600, 2);
+    out += "h ";
+    appendPadded(out, (total % 3600) / 60, 2);
+    out += "m ";
+    appendPadded(out, total % 60, 2);
+    out += 's';
+}
+
+} // namespace SolarSim
@@ -0,0 +1,65 @@
+#include "textmesh.h"
+
+#include <algorithm>
+
+#define STB_EASY_FONT_IMPLEMENTATION
+#include "stb_easy_font.h"
+
+namespace SolarSim {
+
+int buildTextMesh(const std::string& text, float scale, float offsetX, float offsetY,
+                  std::vector<unsigned char>& scratch, std::vector<float>& vertices) {
+    vertices.clear();
+    if (text.empty()) return 0;
+
+    size_t bufferSize = std::max<size_t>(1, text.size()) * kEasyFontBytesPerChar;
+    scratch.resize(bufferSize);
+
+    int quadCount = stb_easy_font_print(0.0f, 0.0f, const_cast<char*>(text.c_str()), nullptr,
+                                        scratch.data(), static_cast<int>(bufferSize));
+    if (quadCount <= 0) return 0;
+
+    struct EasyFontVertex {
+        float x;
+        float y;
+        float z;
+        unsigned char rgba[4];
+    };
+
+    EasyFontVertex* verts = reinterpret_cast<EasyFontVertex*>(scratch.data());
+    vertices.reserve(static_cast<size_t>(quadCount) * 6 * 2);
+
+    for (int i = 0; i < quadCount; ++i) {
+        EasyFontVertex* quad = verts + i * 4;
+        auto emit = [&](int idx) {
+            vertices.push_back(quad[idx].x * scale + offsetX);
+            vertices.push_back(quad[idx].y * scale + offsetY);
+        };
+
+        emit(0); emit(1); emit(2);
+        emit(0); emit(2); emit(3);
+    }
+
+    return static_cast<int>(vertices.size() / 2);
+}
+
+float textWidth(const std::string& text) {
+    return static_cast<float>(stb_easy_font_width(const_cast<char*>(text.c_str())));
+}
+
+const std::vector<float>& TextLayoutCache::layout(std::string_view line, float scale) {
+    key.assign(reinterpret_cast<const char*>(&scale), sizeof(scale));
+    key.append(line.data(), line.size());
+
+    auto found = entries.find(key);
+    if (found != entries.end()) return found->second;
+
+    if (entries.size() >= kMaxEntries) entries.clear();
+
+    std::vector<float>& vertices = entries[key];
+    text.assign(line.data(), line.size());
+    buildTextMesh(text, scale, 0.0f, 0.0f, scratch, vertices);
+    return vertices;
+}
+
+} // namespace SolarSim
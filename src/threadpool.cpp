@@ -0,0 +1,149 @@
+#include "threadpool.h"
+
+#include <algorithm>
+
+namespace SolarSim {
+
+ThreadPool::ThreadPool(unsigned threadCount) {
+    start(threadCount);
+}
+
+ThreadPool::~ThreadPool() {
+    stop();
+}
+
+void ThreadPool::resize(unsigned threadCount) {
+    stop();
+    start(threadCount);
+}
+
+void ThreadPool::start(unsigned threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    queues.reset(new ChunkQueue[threadCount]);
+    {
+        std::lock_guard<std::mutex> guard(wakeMutex);
+        stopping = false;
+    }
+
+    for (unsigned i = 1; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+void ThreadPool::stop() {
+    {
+        std::lock_guard<std::mutex> guard(wakeMutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+void ThreadPool::parallelFor(size_t begin, size_t end, size_t grain,
+                             const std::function<void(size_t, size_t)>& fn) {
+    if (end <= begin) return;
+    grain = std::max<size_t>(1, grain);
+
+    const size_t chunkCount = (end - begin + grain - 1) / grain;
+    const unsigned threads = size();
+
+    // Not worth waking anybody up
+    if (threads == 1 || chunkCount == 1) {
+        for (size_t b = begin; b < end; b += grain) {
+            fn(b, std::min(end, b + grain));
+        }
+        return;
+    }
+
+    job.fn = &fn;
+    job.begin = begin;
+    job.end = end;
+    job.grain = grain;
+    chunksRemaining.store(chunkCount, std::memory_order_relaxed);
+
+    // Hand every thread a contiguous slice of the chunks
+    for (unsigned t = 0; t < threads; ++t) {
+        std::lock_guard<std::mutex> guard(queues[t].lock);
+        queues[t].head = chunkCount * t / threads;
+        queues[t].tail = chunkCount * (t + 1) / threads;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(wakeMutex);
+        ++generation;
+    }
+    wakeCondition.notify_all();
+
+    // The caller works too, then waits for whatever the others are still running
+    size_t chunk;
+    while (popChunk(0, chunk)) {
+        runChunk(chunk);
+    }
+    while (chunksRemaining.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+    }
+}
+
+bool ThreadPool::popChunk(unsigned index, size_t& chunk) {
+    // Own queue first, from the front
+    {
+        ChunkQueue& own = queues[index];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (own.head < own.tail) {
+            chunk = own.head++;
+            return true;
+        }
+    }
+
+    // Then steal from the back of everybody else, starting with our neighbour
+    const unsigned threads = size();
+    for (unsigned offset = 1; offset < threads; ++offset) {
+        ChunkQueue& victim = queues[(index + offset) % threads];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (victim.head < victim.tail) {
+            chunk = --victim.tail;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::runChunk(size_t chunk) {
+    // The queue lock taken in popChunk makes the job written before the queues were filled visible here
+    size_t b = job.begin + chunk * job.grain;
+    size_t e = std::min(job.end, b + job.grain);
+    (*job.fn)(b, e);
+    chunksRemaining.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void ThreadPool::workerLoop(unsigned index) {
+    uint64_t seen = 0;
+    {
+        std::lock_guard<std::mutex> guard(wakeMutex);
+        seen = generation;
+    }
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(wakeMutex);
+            wakeCondition.wait(guard, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+
+        size_t chunk;
+        while (popChunk(index, chunk)) {
+            runChunk(chunk);
+        }
+    }
+}
+
+} // namespace SolarSim
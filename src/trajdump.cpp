@@ -0,0 +1,115 @@
+// Reads a trajectory written by --trajectory and prints it, either as a per-frame
+// summary or as CSV rows for offline analysis. Links only against libsolarsim_core.
+
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include "trajectory.h"
+
+using namespace SolarSim;
+
+namespace {
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " FILE [options]\n"
+              << "  --csv              print frame,seconds,body,slot,generation,x,y,vx,vy for every body and frame\n"
+              << "  --body I           like --csv but only for whichever body is at index I\n"
+              << "  --handle S:G       like --csv but only for the body with handle slot S, generation G,\n"
+              << "                     wherever merges move it\n"
+              << "  (default: one summary line per frame plus totals)\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string path;
+    bool csv = false;
+    long long onlyBody = -1;
+    long long onlySlot = -1;
+    unsigned long onlyGeneration = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strcmp(arg, "--csv") == 0) {
+            csv = true;
+        } else if (std::strcmp(arg, "--body") == 0 && i + 1 < argc) {
+            csv = true;
+            onlyBody = std::atoll(argv[++i]);
+        } else if (std::strcmp(arg, "--handle") == 0 && i + 1 < argc) {
+            const char* text = argv[++i];
+            const char* colon = std::strchr(text, ':');
+            if (!colon) {
+                printUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            csv = true;
+            onlySlot = std::atoll(text);
+            onlyGeneration = std::strtoul(colon + 1, nullptr, 10);
+        } else if (arg[0] != '-' && path.empty()) {
+            path = arg;
+        } else {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (path.empty()) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    try {
+        TrajectoryReader reader(path);
+        TrajectoryFrame frame;
+        size_t frames = 0;
+        size_t keyframes = 0;
+        size_t totalBytes = sizeof(TrajectoryHeader);
+        size_t rawBytes = 0;
+
+        std::cout.precision(17);
+        if (csv) {
+            std::cout << "frame,seconds,body,slot,generation,x,y,vx,vy\n";
+        } else {
+            std::cout << "Position quantum: " << reader.header().positionQuantum << " m\n"
+                      << "Velocity quantum: " << reader.header().velocityQuantum << " m/s\n";
+        }
+
+        while (reader.next(frame)) {
+            frames++;
+            if (frame.keyframe) keyframes++;
+            totalBytes += reader.lastFrameBytes();
+            rawBytes += frame.size() * 4 * sizeof(double);
+
+            if (!csv) {
+                std::cout << "frame " << frame.frame << "  t=" << frame.seconds << " s  bodies=" << frame.size()
+                          << (frame.keyframe ? "  key  " : "  delta  ") << reader.lastFrameBytes() << " bytes\n";
+                continue;
+            }
+
+            for (size_t i = 0; i < frame.size(); ++i) {
+                if (onlyBody >= 0 && static_cast<size_t>(onlyBody) != i) continue;
+                if (onlySlot >= 0 && (frame.slot[i] != onlySlot || frame.generation[i] != onlyGeneration)) continue;
+                std::cout << frame.frame << ',' << frame.seconds << ',' << i << ',' << frame.slot[i] << ','
+                          << frame.generation[i] << ','
+                          << frame.x[i] << ',' << frame.y[i] << ','
+                          << frame.vx[i] << ',' << frame.vy[i] << '\n';
+            }
+        }
+
+        if (!csv) {
+            std::cout.precision(4);
+            std::cout << "Frames: " << frames << " (" << keyframes << " keyframes)\n"
+                      << "File size: " << totalBytes << " bytes, "
+                      << (frames ? static_cast<double>(totalBytes) / frames : 0.0) << " per frame\n"
+                      << "Compression vs raw doubles: "
+                      << (totalBytes ? static_cast<double>(rawBytes) / totalBytes : 0.0) << "x\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to read trajectory: " << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,362 @@
+#include "trajectory.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "bodysystem.h"
+
+namespace SolarSim {
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'O', 'L', 'A', 'R', 'T', 'R', 'J'};
+
+// kind + simFrame + simSeconds + bodyCount + payloadBytes
+constexpr size_t kFrameHeaderBytes = 1 + 8 + 8 + 8 + 8;
+
+void requireLittleEndian() {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    throw std::runtime_error("Trajectories are little-endian only, this host is big-endian");
+#endif
+}
+
+// Small signed numbers map to small unsigned ones: 0, -1, 1, -2, 2 -> 0, 1, 2, 3, 4
+uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// 7 bits per byte, high bit set on every byte but the last
+void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool getVarint(const uint8_t*& at, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && at < end; shift += 7) {
+        uint8_t byte = *at++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+int64_t quantize(double value, double quantum) {
+    return static_cast<int64_t>(std::llround(value / quantum));
+}
+
+template <typename T>
+void putRaw(std::vector<uint8_t>& out, const T& value) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+T getRaw(const uint8_t* at) {
+    T value;
+    std::memcpy(&value, at, sizeof(T));
+    return value;
+}
+
+} // namespace
+
+TrajectoryWriter::~TrajectoryWriter() {
+    stop();
+}
+
+void TrajectoryWriter::start(const std::string& path, const TrajectoryOptions& opts) {
+    stop();
+    requireLittleEndian();
+
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        throw std::runtime_error("Unable to create " + path + ": " + std::strerror(errno));
+    }
+
+    options = opts;
+    if (options.everySteps < 1) options.everySteps = 1;
+    if (options.bufferCount < 1) options.bufferCount = 1;
+    if (options.keyframeInterval < 1) options.keyframeInterval = 1;
+
+    TrajectoryHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kTrajectoryVersion;
+    header.keyframeInterval = options.keyframeInterval;
+    header.positionQuantum = options.positionQuantum;
+    header.velocityQuantum = options.velocityQuantum;
+    if (std::fwrite(&header, sizeof(header), 1, file) != 1 || std::fflush(file) != 0) {
+        const int error = errno;
+        std::fclose(file);
+        file = nullptr;
+        throw std::runtime_error("Unable to write " + path + ": " + std::strerror(error));
+    }
+
+    buffers.assign(options.bufferCount, RawFrame{});
+    freeBuffers.clear();
+    queuedBuffers.clear();
+    for (size_t i = 0; i < buffers.size(); ++i) freeBuffers.push_back(i);
+
+    stepsSeen = 0;
+    previous.clear();
+    framesSinceKey = 0;
+    writeFailed = false;
+    busySeconds = 0.0;
+    totalBytes = 0;
+    current = TrajectoryStats{};
+    stopping = false;
+    thread = std::thread(&TrajectoryWriter::run, this);
+}
+
+void TrajectoryWriter::stop() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (thread.joinable()) thread.join();
+
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+void TrajectoryWriter::record(const BodySystem& bodies, long long frame, double seconds) {
+    if (!enabled()) return;
+    if (stepsSeen++ % options.everySteps != 0) return;
+
+    size_t slot;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (current.failed) return;
+        if (freeBuffers.empty()) {
+            current.framesDropped++;
+            return;
+        }
+        slot = freeBuffers.back();
+        freeBuffers.pop_back();
+    }
+
+    // The buffer belongs to this thread until it's queued; its vectors keep their capacity
+    RawFrame& raw = buffers[slot];
+    raw.frame = frame;
+    raw.seconds = seconds;
+    raw.layout = bodies.layoutVersion();
+    raw.x.assign(bodies.x.begin(), bodies.x.end());
+    raw.y.assign(bodies.y.begin(), bodies.y.end());
+    raw.vx.assign(bodies.vx.begin(), bodies.vx.end());
+    raw.vy.assign(bodies.vy.begin(), bodies.vy.end());
+    raw.slot.resize(bodies.size());
+    raw.generation.resize(bodies.size());
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        const BodyHandle handle = bodies.handle(i);
+        raw.slot[i] = handle.slot;
+        raw.generation[i] = handle.generation;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        queuedBuffers.push_back(slot);
+    }
+    wake.notify_one();
+}
+
+TrajectoryStats TrajectoryWriter::stats() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return current;
+}
+
+void TrajectoryWriter::run() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        wake.wait(guard, [&] { return !queuedBuffers.empty() || stopping; });
+        if (queuedBuffers.empty()) break; // stopping, and everything queued has been written
+
+        size_t slot = queuedBuffers.front();
+        queuedBuffers.erase(queuedBuffers.begin());
+        guard.unlock();
+
+        // After a failed write the rest of the queue is just handed back
+        if (writeFailed) {
+            guard.lock();
+            freeBuffers.push_back(slot);
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        encode(buffers[slot]);
+        if (std::fwrite(encoded.data(), 1, encoded.size(), file) != encoded.size()) {
+            // Keep the simulation going, just stop recording
+            writeFailed = true;
+            std::cerr << "Trajectory write failed: " << std::strerror(errno) << '\n';
+            guard.lock();
+            freeBuffers.push_back(slot);
+            current.failed = true;
+            continue;
+        }
+        busySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        totalBytes += encoded.size();
+
+        guard.lock();
+        freeBuffers.push_back(slot);
+        current.framesWritten++;
+        current.lastFrameBytes = encoded.size();
+        current.averageFrameBytes = static_cast<double>(totalBytes) / current.framesWritten;
+        current.writerMBPerSecond = busySeconds > 0.0 ? totalBytes / busySeconds / 1e6 : 0.0;
+    }
+    if (!writeFailed && std::fflush(file) != 0) {
+        writeFailed = true;
+        std::cerr << "Trajectory write failed: " << std::strerror(errno) << '\n';
+        current.failed = true;
+    }
+}
+
+void TrajectoryWriter::encode(const RawFrame& raw) {
+    const size_t n = raw.x.size();
+
+    // Deltas only make sense against a frame with the same bodies in the same order. A merge
+    // moves the last body into the gap, and a spawn in the same tick keeps the count the same.
+    const bool key = previous.size() != n * 4 || raw.layout != previousLayout ||
+                     framesSinceKey + 1 >= options.keyframeInterval;
+    previousLayout = raw.layout;
+    if (key) {
+        previous.assign(n * 4, 0);
+        framesSinceKey = 0;
+    } else {
+        framesSinceKey++;
+    }
+
+    encoded.clear();
+    encoded.push_back(static_cast<uint8_t>(key ? TrajectoryFrameKind::Key : TrajectoryFrameKind::Delta));
+    putRaw<int64_t>(encoded, raw.frame);
+    putRaw<double>(encoded, raw.seconds);
+    putRaw<uint64_t>(encoded, n);
+    putRaw<uint64_t>(encoded, 0); // payload size, patched below
+
+    // A keyframe is just a delta against all zeros, plus who each body is
+    for (size_t i = 0; i < n; ++i) {
+        if (key) {
+            putVarint(encoded, raw.slot[i]);
+            putVarint(encoded, raw.generation[i]);
+        }
+        const int64_t q[4] = {
+            quantize(raw.x[i], options.positionQuantum),
+            quantize(raw.y[i], options.positionQuantum),
+            quantize(raw.vx[i], options.velocityQuantum),
+            quantize(raw.vy[i], options.velocityQuantum),
+        };
+        int64_t* prev = &previous[i * 4];
+        for (int c = 0; c < 4; ++c) {
+            putVarint(encoded, zigzag(q[c] - prev[c]));
+            prev[c] = q[c];
+        }
+    }
+
+    const uint64_t payloadBytes = encoded.size() - kFrameHeaderBytes;
+    std::memcpy(encoded.data() + kFrameHeaderBytes - sizeof(uint64_t), &payloadBytes, sizeof(payloadBytes));
+}
+
+TrajectoryReader::TrajectoryReader(const std::string& filePath) : path(filePath) {
+    requireLittleEndian();
+
+    file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        throw std::runtime_error("Unable to open " + path + ": " + std::strerror(errno));
+    }
+    if (std::fread(&fileHeader, sizeof(fileHeader), 1, file) != 1 ||
+        std::memcmp(fileHeader.magic, kMagic, sizeof(kMagic)) != 0) {
+        std::fclose(file);
+        throw std::runtime_error(path + " is not a SolarSim trajectory");
+    }
+    if (fileHeader.version != kTrajectoryVersion) {
+        std::fclose(file);
+        throw std::runtime_error(path + ": unsupported trajectory version " + std::to_string(fileHeader.version));
+    }
+}
+
+TrajectoryReader::~TrajectoryReader() {
+    if (file) std::fclose(file);
+}
+
+bool TrajectoryReader::next(TrajectoryFrame& out) {
+    uint8_t head[kFrameHeaderBytes];
+    size_t got = std::fread(head, 1, sizeof(head), file);
+    if (got == 0) return false;
+    if (got != sizeof(head)) throw std::runtime_error(path + ": truncated frame header");
+
+    const auto kind = static_cast<TrajectoryFrameKind>(head[0]);
+    if (kind != TrajectoryFrameKind::Key && kind != TrajectoryFrameKind::Delta) {
+        throw std::runtime_error(path + ": bad frame kind");
+    }
+    out.frame = getRaw<int64_t>(head + 1);
+    out.seconds = getRaw<double>(head + 9);
+    const uint64_t n = getRaw<uint64_t>(head + 17);
+    const uint64_t payloadBytes = getRaw<uint64_t>(head + 25);
+    out.keyframe = kind == TrajectoryFrameKind::Key;
+
+    // Every body takes at least one byte per varint, at most 10 (5 for the handle's two)
+    const uint64_t minBytes = out.keyframe ? 6 : 4;
+    const uint64_t maxBytes = out.keyframe ? 50 : 40;
+    if (payloadBytes / minBytes < n || payloadBytes / maxBytes > n) {
+        throw std::runtime_error(path + ": bad frame size");
+    }
+
+    payload.resize(static_cast<size_t>(payloadBytes));
+    if (std::fread(payload.data(), 1, payload.size(), file) != payload.size()) {
+        throw std::runtime_error(path + ": truncated frame");
+    }
+    frameBytes = kFrameHeaderBytes + payload.size();
+
+    if (out.keyframe) {
+        previous.assign(static_cast<size_t>(n) * 4, 0);
+        keySlot.resize(n);
+        keyGeneration.resize(n);
+    } else if (previous.size() != n * 4) {
+        throw std::runtime_error(path + ": delta frame without a matching keyframe");
+    }
+
+    out.x.resize(n);
+    out.y.resize(n);
+    out.vx.resize(n);
+    out.vy.resize(n);
+
+    const uint8_t* at = payload.data();
+    const uint8_t* end = at + payload.size();
+    for (size_t i = 0; i < n; ++i) {
+        if (out.keyframe) {
+            uint64_t slot, generation;
+            if (!getVarint(at, end, slot) || !getVarint(at, end, generation) || slot > UINT32_MAX ||
+                generation > UINT32_MAX) {
+                throw std::runtime_error(path + ": corrupt frame");
+            }
+            keySlot[i] = static_cast<uint32_t>(slot);
+            keyGeneration[i] = static_cast<uint32_t>(generation);
+        }
+        int64_t* prev = &previous[i * 4];
+        for (int c = 0; c < 4; ++c) {
+            uint64_t value;
+            if (!getVarint(at, end, value)) throw std::runtime_error(path + ": corrupt frame");
+            prev[c] += unzigzag(value);
+        }
+        out.x[i] = prev[0] * fileHeader.positionQuantum;
+        out.y[i] = prev[1] * fileHeader.positionQuantum;
+        out.vx[i] = prev[2] * fileHeader.velocityQuantum;
+        out.vy[i] = prev[3] * fileHeader.velocityQuantum;
+    }
+    out.slot = keySlot;
+    out.generation = keyGeneration;
+    return true;
+}
+
+} // namespace SolarSim
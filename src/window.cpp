@@ -3,6 +3,7 @@
 #include <iostream>
 #include <stdexcept>
 
+#include "bodyrenderer.h"
 #include "globals.h"
 #include "rendering.h"
 #include "shaders.h"
@@ -60,7 +61,7 @@ void initWindow() {
     // Bind the Vertex Buffer Object to target
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
-    // For masses
+    // For masses (instanced, see bodyrenderer.cpp)
     // Create a shader object and save it's ID
     unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
 
@@ -118,11 +119,35 @@ void initWindow() {
     textScreenUniform = glGetUniformLocation(textShaderProgram, "uScreenSize");
     textColorUniform = glGetUniformLocation(textShaderProgram, "uTextColor");
 
+    unsigned int pointVertexShader = glCreateShader(GL_VERTEX_SHADER);
+    const char* pointVertexSrc = Shaders::pointVertexShader;
+    glShaderSource(pointVertexShader, 1, &pointVertexSrc, nullptr);
+    glCompileShader(pointVertexShader);
+
+    unsigned int pointFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    const char* pointFragmentSrc = Shaders::pointFragmentShader;
+    glShaderSource(pointFragmentShader, 1, &pointFragmentSrc, nullptr);
+    glCompileShader(pointFragmentShader);
+
+    pointShaderProgram = glCreateProgram();
+    glAttachShader(pointShaderProgram, pointVertexShader);
+    glAttachShader(pointShaderProgram, pointFragmentShader);
+    glLinkProgram(pointShaderProgram);
+
+    glDeleteShader(pointVertexShader);
+    glDeleteShader(pointFragmentShader);
+
+    glUseProgram(pointShaderProgram);
+    pointScreenUniform = glGetUniformLocation(pointShaderProgram, "uScreenSize");
+
     initTextRenderer();
     glUseProgram(shaderProgram);
+    initBodyRenderer();
 }
 
 void shutdownWindow() {
+    shutdownTextRenderer();
+    shutdownBodyRenderer();
     glfwDestroyWindow(window);
     glfwTerminate();
 }